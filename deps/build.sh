@@ -169,5 +169,17 @@ echo "openblas_lib = \"$OPENBLAS_LIB\"" >> "$CONF_FILE"
 echo "sys_blas = $SYS_BLAS" >> "$CONF_FILE"
 echo "openmp_supported = $OPENMP_SUPPORTED" >> "$CONF_FILE"
 
+# The array runtime also holds the non-template part of the headers that
+# generated code links to instead of compiling it again, so it is built with
+# the same code generation flags CGen uses by default.
+RUNTIME_FLAGS="-std=c++11 -O3 -g -fPIC"
+if [ "$OPENMP_SUPPORTED" -eq "1" ]; then
+    RUNTIME_FLAGS="$RUNTIME_FLAGS -fopenmp"
+fi
+
+# Precompiled runtime headers are built by CGen for the flags of the
+# compiler found above; drop those of an earlier build.
+rm -rf generated/pch-*
+
 echo "Using $CC to build ParallelAccelerator array runtime.";
-$CC -std=c++11 -fPIC -shared -o libj2carray.so.1.0 j2c-array.cpp
+$CC $RUNTIME_FLAGS -shared -o libj2carray.so.1.0 j2c-array.cpp
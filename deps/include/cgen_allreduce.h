@@ -0,0 +1,122 @@
+/*
+Copyright (c) 2015, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+- Redistributions of source code must retain the above copyright notice, 
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice, 
+  this list of conditions and the following disclaimer in the documentation 
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CGEN_ALLREDUCE_H_
+#define CGEN_ALLREDUCE_H_
+
+#include <mpi.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <limits.h>
+#include <algorithm>
+#include <map>
+#include <vector>
+
+/*
+ * Reductions of parfors across the ranks of a distributed program.  The
+ * combination with the partial results of the other ranks is started right
+ * after the parfor and only waited for where the reduction variable is used
+ * next.  Sums, products, maxima and minima of scalars are MPI_Iallreduce'd.
+ * Other operators, and array-valued reduction variables, gather the partial
+ * results of all ranks with MPI_Iallgather; the generated code then folds them
+ * in rank order, so that every rank gets the same result.  Every reduction in
+ * flight is identified by the number of its site in the generated code.
+ */
+struct cgen_reduction {
+    MPI_Request req;
+    int64_t bytes;
+    std::vector<char> parts;   // partial results of all ranks, for the gathering reductions
+};
+
+inline cgen_reduction &cgen_reduction_site(int site) {
+    static std::map<int, cgen_reduction> sites;
+    return sites[site];
+}
+
+inline int cgen_reduction_ranks(void) {
+    int size;
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    return size;
+}
+
+template <typename T> inline MPI_Datatype cgen_mpi_type(void);
+template <> inline MPI_Datatype cgen_mpi_type<float>(void) { return MPI_FLOAT; }
+template <> inline MPI_Datatype cgen_mpi_type<double>(void) { return MPI_DOUBLE; }
+template <> inline MPI_Datatype cgen_mpi_type<int8_t>(void) { return MPI_INT8_T; }
+template <> inline MPI_Datatype cgen_mpi_type<int16_t>(void) { return MPI_INT16_T; }
+template <> inline MPI_Datatype cgen_mpi_type<int32_t>(void) { return MPI_INT32_T; }
+template <> inline MPI_Datatype cgen_mpi_type<int64_t>(void) { return MPI_INT64_T; }
+template <> inline MPI_Datatype cgen_mpi_type<uint8_t>(void) { return MPI_UINT8_T; }
+template <> inline MPI_Datatype cgen_mpi_type<uint16_t>(void) { return MPI_UINT16_T; }
+template <> inline MPI_Datatype cgen_mpi_type<uint32_t>(void) { return MPI_UINT32_T; }
+template <> inline MPI_Datatype cgen_mpi_type<uint64_t>(void) { return MPI_UINT64_T; }
+
+// Starts reducing x across the ranks in place with a predefined MPI operator.
+template <typename T>
+void cgen_allreduce_start(int site, T &x, MPI_Op op) {
+    cgen_reduction &r = cgen_reduction_site(site);
+    MPI_Iallreduce(MPI_IN_PLACE, &x, 1, cgen_mpi_type<T>(), op, MPI_COMM_WORLD, &r.req);
+}
+
+inline void cgen_allgather_post(cgen_reduction &r, void *p, int64_t bytes) {
+    assert(bytes <= INT_MAX);
+    r.bytes = bytes;
+    r.parts.resize(bytes * cgen_reduction_ranks());
+    MPI_Iallgather(p, (int)bytes, MPI_BYTE, r.parts.data(), (int)bytes, MPI_BYTE, MPI_COMM_WORLD, &r.req);
+}
+
+// Starts gathering the partial results x of all ranks, which have the same shape.
+template <typename T>
+void cgen_allgather_start(int site, T &x) {
+    cgen_allgather_post(cgen_reduction_site(site), &x, sizeof(T));
+}
+
+template <typename T>
+void cgen_allgather_start(int site, j2c_array<T> &x) {
+    cgen_allgather_post(cgen_reduction_site(site), x.data, x.ARRAYLEN() * sizeof(T));
+}
+
+inline void cgen_reduction_wait(int site) {
+    MPI_Wait(&cgen_reduction_site(site).req, MPI_STATUS_IGNORE);
+}
+
+// Loads the gathered partial result of the given rank into x, of the same shape as like.
+template <typename T>
+void cgen_reduction_part(int site, int rank, T &x, const T &like) {
+    cgen_reduction &r = cgen_reduction_site(site);
+    memcpy(&x, &r.parts[rank * r.bytes], r.bytes);
+}
+
+template <typename T>
+void cgen_reduction_part(int site, int rank, j2c_array<T> &x, const j2c_array<T> &like) {
+    cgen_reduction &r = cgen_reduction_site(site);
+    if (x.data != like.data) {
+        j2c_reduction_reshape(x, like);
+    }
+    memcpy(x.data, &r.parts[rank * r.bytes], r.bytes);
+}
+
+#endif /* CGEN_ALLREDUCE_H_ */
@@ -0,0 +1,232 @@
+/*
+Copyright (c) 2015, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+- Redistributions of source code must retain the above copyright notice, 
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice, 
+  this list of conditions and the following disclaimer in the documentation 
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CGEN_BATCHED_H_
+#define CGEN_BATCHED_H_
+
+#include <stdint.h>
+#include <cmath>
+#include <algorithm>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/*
+ * Batched kernels for many small matrices.  A batch of nb m x n matrices is
+ * stored batch-fastest: entry (i,j) of matrix b lives at X[b + ld*(i + m*j)],
+ * ld >= nb, which is the layout of an nb x m x n Julia array.  Every kernel
+ * walks CGEN_BATCHED_LANES matrices at a time with the batch index innermost,
+ * so the loops over matrix entries unroll (the 2x2, 3x3 and 4x4 cases are
+ * instantiated with compile-time sizes) and the lane loop vectorizes.
+ */
+
+#ifndef CGEN_BATCHED_LANES
+#define CGEN_BATCHED_LANES 64
+#endif
+
+// Batches smaller than this run on a single thread.
+#ifndef CGEN_BATCHED_PAR_MIN
+#define CGEN_BATCHED_PAR_MIN 4096
+#endif
+
+// C = A*B for each matrix of the batch; A is m x k, B is k x n.  A size
+// template argument of 0 means the size is taken from the run-time argument.
+template <typename T, int M, int N, int K>
+static void cgen_batched_gemm_kernel(int64_t nb, int64_t ld, int m_, int n_, int k_,
+                                     const T *A, const T *B, T *C)
+{
+    const int m = M ? M : m_, n = N ? N : n_, k = K ? K : k_;
+#pragma omp parallel for if(nb >= CGEN_BATCHED_PAR_MIN) schedule(static)
+    for (int64_t b0 = 0; b0 < nb; b0 += CGEN_BATCHED_LANES) {
+        int L = (int)std::min((int64_t)CGEN_BATCHED_LANES, nb - b0);
+        for (int j = 0; j < n; j++) {
+            for (int i = 0; i < m; i++) {
+                T *c = C + b0 + ld * (i + m * j);
+#pragma omp simd
+                for (int l = 0; l < L; l++) c[l] = 0;
+                for (int p = 0; p < k; p++) {
+                    const T *a = A + b0 + ld * (i + m * p);
+                    const T *b = B + b0 + ld * (p + k * j);
+#pragma omp simd
+                    for (int l = 0; l < L; l++) c[l] += a[l] * b[l];
+                }
+            }
+        }
+    }
+}
+
+// Gaussian elimination with partial pivoting on L matrices at once.  a holds
+// the n x n matrices as a[(i + n*j)*LANES + l] and x the n x r right-hand
+// sides in the same way; on return x holds the solutions and det the
+// determinants.  Row swaps are done with selects so the lanes stay in step.
+// R < 0 means the number of right-hand sides is the run-time r_.
+template <typename T, int N, int R>
+static inline void cgen_batched_gauss(int n_, int r_, int L, T *a, T *x, T *det)
+{
+    const int n = N ? N : n_, r = R >= 0 ? R : r_;
+    const int W = CGEN_BATCHED_LANES;
+#pragma omp simd
+    for (int l = 0; l < L; l++) det[l] = 1;
+    for (int k = 0; k < n; k++) {
+        for (int i = k + 1; i < n; i++) {
+#pragma omp simd
+            for (int l = 0; l < L; l++) {
+                bool s = std::abs(a[(i + n * k) * W + l]) > std::abs(a[(k + n * k) * W + l]);
+                for (int j = k; j < n; j++) {
+                    T u = a[(k + n * j) * W + l], v = a[(i + n * j) * W + l];
+                    a[(k + n * j) * W + l] = s ? v : u;
+                    a[(i + n * j) * W + l] = s ? u : v;
+                }
+                for (int c = 0; c < r; c++) {
+                    T u = x[(k + n * c) * W + l], v = x[(i + n * c) * W + l];
+                    x[(k + n * c) * W + l] = s ? v : u;
+                    x[(i + n * c) * W + l] = s ? u : v;
+                }
+                det[l] = s ? -det[l] : det[l];
+            }
+        }
+        for (int i = k + 1; i < n; i++) {
+#pragma omp simd
+            for (int l = 0; l < L; l++) {
+                T f = a[(i + n * k) * W + l] / a[(k + n * k) * W + l];
+                for (int j = k + 1; j < n; j++) a[(i + n * j) * W + l] -= f * a[(k + n * j) * W + l];
+                for (int c = 0; c < r; c++) x[(i + n * c) * W + l] -= f * x[(k + n * c) * W + l];
+            }
+        }
+#pragma omp simd
+        for (int l = 0; l < L; l++) det[l] *= a[(k + n * k) * W + l];
+    }
+    for (int k = n - 1; k >= 0; k--) {
+        for (int c = 0; c < r; c++) {
+#pragma omp simd
+            for (int l = 0; l < L; l++) {
+                T s = x[(k + n * c) * W + l];
+                for (int j = k + 1; j < n; j++) s -= a[(k + n * j) * W + l] * x[(j + n * c) * W + l];
+                x[(k + n * c) * W + l] = s / a[(k + n * k) * W + l];
+            }
+        }
+    }
+}
+
+// Shared driver for det, inv and solve.  B == NULL with r == n solves
+// against the identity (the inverse); X == NULL only computes determinants.
+template <typename T, int N, int R>
+static void cgen_batched_solve_kernel(int64_t nb, int64_t ld, int n_, int r_,
+                                      const T *A, const T *B, T *X, T *D)
+{
+    const int n = N ? N : n_, r = R >= 0 ? R : r_;
+    const int W = CGEN_BATCHED_LANES;
+#pragma omp parallel if(nb >= CGEN_BATCHED_PAR_MIN)
+    {
+        std::vector<T> a((size_t)n * n * W), x((size_t)n * std::max(r, 1) * W), det(W);
+#pragma omp for schedule(static)
+        for (int64_t b0 = 0; b0 < nb; b0 += W) {
+            int L = (int)std::min((int64_t)W, nb - b0);
+            for (int e = 0; e < n * n; e++) {
+                std::copy(A + b0 + ld * e, A + b0 + ld * e + L, &a[e * W]);
+            }
+            for (int c = 0; c < r; c++) {
+                for (int i = 0; i < n; i++) {
+                    T *xe = &x[(i + n * c) * W];
+                    if (B) {
+                        std::copy(B + b0 + ld * (i + n * c), B + b0 + ld * (i + n * c) + L, xe);
+                    } else {
+                        std::fill(xe, xe + L, (T)(i == c));
+                    }
+                }
+            }
+            cgen_batched_gauss<T, N, R>(n, r, L, &a[0], &x[0], &det[0]);
+            if (X) {
+                for (int e = 0; e < n * r; e++) {
+                    std::copy(&x[e * W], &x[e * W] + L, X + b0 + ld * e);
+                }
+            }
+            if (D) {
+                std::copy(&det[0], &det[0] + L, D + b0);
+            }
+        }
+    }
+}
+
+template <typename T>
+void cgen_batched_gemm(int64_t nb, int64_t ld, int m, int n, int k, const T *A, const T *B, T *C)
+{
+    if (m == k && (n == m || n == 1)) {
+        switch (m) {
+        case 2: n == 1 ? cgen_batched_gemm_kernel<T, 2, 1, 2>(nb, ld, m, n, k, A, B, C)
+                       : cgen_batched_gemm_kernel<T, 2, 2, 2>(nb, ld, m, n, k, A, B, C); return;
+        case 3: n == 1 ? cgen_batched_gemm_kernel<T, 3, 1, 3>(nb, ld, m, n, k, A, B, C)
+                       : cgen_batched_gemm_kernel<T, 3, 3, 3>(nb, ld, m, n, k, A, B, C); return;
+        case 4: n == 1 ? cgen_batched_gemm_kernel<T, 4, 1, 4>(nb, ld, m, n, k, A, B, C)
+                       : cgen_batched_gemm_kernel<T, 4, 4, 4>(nb, ld, m, n, k, A, B, C); return;
+        }
+    }
+    cgen_batched_gemm_kernel<T, 0, 0, 0>(nb, ld, m, n, k, A, B, C);
+}
+
+// y = A*x with x and y stored as nb x k and nb x m arrays.
+template <typename T>
+void cgen_batched_gemv(int64_t nb, int64_t ld, int m, int k, const T *A, const T *x, T *y)
+{
+    cgen_batched_gemm(nb, ld, m, 1, k, A, x, y);
+}
+
+template <typename T>
+void cgen_batched_det(int64_t nb, int64_t ld, int n, const T *A, T *d)
+{
+    switch (n) {
+    case 2: cgen_batched_solve_kernel<T, 2, 0>(nb, ld, n, 0, A, NULL, NULL, d); return;
+    case 3: cgen_batched_solve_kernel<T, 3, 0>(nb, ld, n, 0, A, NULL, NULL, d); return;
+    case 4: cgen_batched_solve_kernel<T, 4, 0>(nb, ld, n, 0, A, NULL, NULL, d); return;
+    }
+    cgen_batched_solve_kernel<T, 0, 0>(nb, ld, n, 0, A, NULL, NULL, d);
+}
+
+// Singular matrices give Inf/NaN entries rather than an error.
+template <typename T>
+void cgen_batched_inv(int64_t nb, int64_t ld, int n, const T *A, T *X)
+{
+    switch (n) {
+    case 2: cgen_batched_solve_kernel<T, 2, 2>(nb, ld, n, n, A, NULL, X, NULL); return;
+    case 3: cgen_batched_solve_kernel<T, 3, 3>(nb, ld, n, n, A, NULL, X, NULL); return;
+    case 4: cgen_batched_solve_kernel<T, 4, 4>(nb, ld, n, n, A, NULL, X, NULL); return;
+    }
+    cgen_batched_solve_kernel<T, 0, -1>(nb, ld, n, n, A, NULL, X, NULL);
+}
+
+// X = A\B with B and X stored as nb x n arrays.
+template <typename T>
+void cgen_batched_solve(int64_t nb, int64_t ld, int n, const T *A, const T *B, T *X)
+{
+    switch (n) {
+    case 2: cgen_batched_solve_kernel<T, 2, 1>(nb, ld, n, 1, A, B, X, NULL); return;
+    case 3: cgen_batched_solve_kernel<T, 3, 1>(nb, ld, n, 1, A, B, X, NULL); return;
+    case 4: cgen_batched_solve_kernel<T, 4, 1>(nb, ld, n, 1, A, B, X, NULL); return;
+    }
+    cgen_batched_solve_kernel<T, 0, 1>(nb, ld, n, 1, A, B, X, NULL);
+}
+
+#endif /* CGEN_BATCHED_H_ */
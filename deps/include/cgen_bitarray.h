@@ -0,0 +1,360 @@
+/*
+Copyright (c) 2015, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+- Redistributions of source code must retain the above copyright notice, 
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice, 
+  this list of conditions and the following disclaimer in the documentation 
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CGEN_BITARRAY_H_
+#define CGEN_BITARRAY_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/*
+ * Packed bit arrays.  j2c_bitarray has the layout of Julia's BitArray: element
+ * i (1-based, column-major) is bit (i-1)%64 of chunks[(i-1)/64], and the bits
+ * past the last element are always zero.  An array marshalled from a BitArray
+ * shares its chunks; otherwise the chunks are reference counted as the data
+ * of a j2c_array is.
+ */
+class j2c_bitarray;
+
+// A reference to one bit, so that ARRAYELEM can be assigned to.  Writes are
+// atomic because the threads of a parfor may write to bits of the same word.
+class j2c_bitref {
+    uint64_t *word;
+    uint64_t mask;
+public:
+    j2c_bitref(uint64_t *_word, uint64_t _mask) : word(_word), mask(_mask) {}
+
+    operator bool() const { return (*word & mask) != 0; }
+
+    j2c_bitref & operator=(bool v) {
+        if (v) __sync_fetch_and_or(word, mask);
+        else __sync_fetch_and_and(word, ~mask);
+        return *this;
+    }
+
+    j2c_bitref & operator=(const j2c_bitref &rhs) { return *this = (bool)rhs; }
+};
+
+class j2c_bitarray {
+public:
+    uint64_t *chunks;
+    int64_t len;
+    unsigned num_dim;
+    int64_t dims[MAX_DIM];
+    unsigned *refcount;  // is always NULL if chunks are not owned.
+
+    static int64_t num_chunks(int64_t n) { return (n + 63) >> 6; }
+
+    int64_t num_chunks(void) const { return num_chunks(len); }
+
+    j2c_bitarray() : chunks(NULL), len(0), num_dim(0), refcount(NULL) {}
+
+    // Share _chunks, or allocate zeroed chunks if _chunks is NULL.
+    j2c_bitarray(uint64_t *_chunks, unsigned _num_dim, const int64_t *_dims) {
+        assert(_num_dim <= MAX_DIM);
+        num_dim = _num_dim;
+        len = 1;
+        for (unsigned i = 0; i < _num_dim; i++) { dims[i] = _dims[i]; len *= _dims[i]; }
+        if (_chunks == NULL) {
+            chunks = new uint64_t[num_chunks(len) > 0 ? num_chunks(len) : 1]();
+            refcount = new unsigned;
+            *refcount = 1;
+        } else {
+            chunks = _chunks;
+            refcount = NULL;
+        }
+    }
+
+    j2c_bitarray(const j2c_bitarray &rhs) : chunks(rhs.chunks), len(rhs.len), num_dim(rhs.num_dim), refcount(rhs.refcount) {
+        memcpy(dims, rhs.dims, sizeof(dims));
+        increment();
+    }
+
+    // Pack a Bool array.
+    j2c_bitarray(const j2c_array<bool> &rhs) : j2c_bitarray(NULL, rhs.num_dim, rhs.dims) {
+        const bool *d = rhs.data;
+        int64_t nc = num_chunks();
+#pragma omp parallel for if(nc >= 1024)
+        for (int64_t w = 0; w < nc; w++) {
+            int64_t n = len - (w << 6) < 64 ? len - (w << 6) : 64;
+            uint64_t c = 0;
+            for (int64_t k = 0; k < n; k++) c |= (uint64_t)d[(w << 6) + k] << k;
+            chunks[w] = c;
+        }
+    }
+
+    j2c_bitarray & operator=(const j2c_bitarray &rhs) {
+        if (this != &rhs) {
+            j2c_bitarray tmp(rhs);
+            swap(tmp);
+        }
+        return *this;
+    }
+
+#if __cplusplus >= 201103L
+    j2c_bitarray(j2c_bitarray &&rhs) : chunks(rhs.chunks), len(rhs.len), num_dim(rhs.num_dim), refcount(rhs.refcount) {
+        memcpy(dims, rhs.dims, sizeof(dims));
+        rhs.chunks = NULL;
+        rhs.refcount = NULL;
+    }
+
+    j2c_bitarray & operator=(j2c_bitarray &&rhs) {
+        swap(rhs);
+        return *this;
+    }
+#endif // C++11
+
+    ~j2c_bitarray(void) {
+        decrement();
+    }
+
+    void swap(j2c_bitarray &rhs) {
+        std::swap(chunks, rhs.chunks);
+        std::swap(len, rhs.len);
+        std::swap(num_dim, rhs.num_dim);
+        std::swap(refcount, rhs.refcount);
+        int64_t t[MAX_DIM];
+        memcpy(t, dims, sizeof(dims));
+        memcpy(dims, rhs.dims, sizeof(dims));
+        memcpy(rhs.dims, t, sizeof(dims));
+    }
+
+    void increment(void) {
+        if (refcount) __sync_fetch_and_add(refcount, 1);
+    }
+
+    void decrement(void) {
+        if (refcount && __sync_fetch_and_sub(refcount, 1) == 1) {
+            delete[] chunks;
+            delete refcount;
+        }
+        chunks = NULL;
+        refcount = NULL;
+    }
+
+    // Unpack into a Bool array.
+    operator j2c_array<bool>() const {
+        j2c_array<bool> a(NULL, num_dim, const_cast<int64_t*>(dims));
+        bool *d = a.data;
+        int64_t nc = num_chunks();
+#pragma omp parallel for if(nc >= 1024)
+        for (int64_t w = 0; w < nc; w++) {
+            int64_t n = len - (w << 6) < 64 ? len - (w << 6) : 64;
+            uint64_t c = chunks[w];
+            for (int64_t k = 0; k < n; k++) d[(w << 6) + k] = (c >> k) & 1;
+        }
+        return a;
+    }
+
+    uint64_t ARRAYLEN(void) const { return len; }
+
+    uint64_t ARRAYSIZE(unsigned i) const { return i <= num_dim ? dims[i - 1] : 1; }
+
+    bool get(uint64_t i) const { return (chunks[(i - 1) >> 6] >> ((i - 1) & 63)) & 1; }
+
+    j2c_bitref ARRAYELEM(uint64_t i) {
+        return j2c_bitref(&chunks[(i - 1) >> 6], (uint64_t)1 << ((i - 1) & 63));
+    }
+
+    j2c_bitref ARRAYELEM(uint64_t i, uint64_t j) {
+        return ARRAYELEM((j - 1) * dims[0] + i);
+    }
+
+    j2c_bitref ARRAYELEM(uint64_t i, uint64_t j, uint64_t k) {
+        return ARRAYELEM(((k - 1) * dims[1] + j - 1) * dims[0] + i);
+    }
+
+    bool SAFEARRAYELEM(bool d, uint64_t i) const {
+        return (i >= 1 && i <= (uint64_t)len) ? get(i) : d;
+    }
+
+    bool SAFEARRAYELEM(bool d, uint64_t i, uint64_t j) const {
+        return (i >= 1 && i <= (uint64_t)dims[0] && j >= 1 && j <= (uint64_t)dims[1]) ? get((j - 1) * dims[0] + i) : d;
+    }
+};
+
+// Arrays with fewer words than this are processed on one thread.
+#ifndef CGEN_BITS_PAR_MIN
+#define CGEN_BITS_PAR_MIN 1024
+#endif
+
+/*
+ * Word w of a mask: the chunk of a bit array, or 64 elements of a Bool array
+ * packed on the fly, so that the kernels below take either.
+ */
+static inline uint64_t cgen_bits_word(const j2c_bitarray &m, int64_t w)
+{
+    return m.chunks[w];
+}
+
+static inline uint64_t cgen_bits_word(const j2c_array<bool> &m, int64_t w)
+{
+    const bool *d = m.data + (w << 6);
+    int64_t n = (int64_t)m.ARRAYLEN() - (w << 6);
+    uint64_t c = 0;
+    if (n >= 64) {
+        for (int k = 0; k < 64; k++) c |= (uint64_t)d[k] << k;
+    } else {
+        for (int64_t k = 0; k < n; k++) c |= (uint64_t)d[k] << k;
+    }
+    return c;
+}
+
+template <typename M>
+static inline int64_t cgen_bits_words(const M &m)
+{
+    return j2c_bitarray::num_chunks(m.ARRAYLEN());
+}
+
+// count(m), and sum(m) for a bit array
+template <typename M>
+int64_t cgen_bits_count(const M &m)
+{
+    int64_t nw = cgen_bits_words(m);
+    int64_t c = 0;
+#pragma omp parallel for reduction(+:c) if(nw >= CGEN_BITS_PAR_MIN)
+    for (int64_t w = 0; w < nw; w++) {
+        c += __builtin_popcountll(cgen_bits_word(m, w));
+    }
+    return c;
+}
+
+/*
+ * Calls emit(k, i) for the k-th (0-based) set element i (1-based) of m.  The
+ * words are split into parts whose set bits are counted first, so that the
+ * parts then know where their output starts.  The parts are shared out with
+ * worksharing loops, so every part is done whatever size the team gets.
+ * Returns the number of set elements, and calls alloc with it before any emit.
+ */
+template <typename M, typename A, typename E>
+int64_t cgen_bits_foreach(const M &m, A alloc, E emit)
+{
+    int64_t nw = cgen_bits_words(m);
+    int np = 1;
+#ifdef _OPENMP
+    if (nw >= CGEN_BITS_PAR_MIN) np = omp_get_max_threads();
+#endif
+    std::vector<int64_t> start(np + 1, 0);
+    int64_t total = 0;
+#pragma omp parallel num_threads(np) if(np > 1)
+    {
+#pragma omp for schedule(static)
+        for (int p = 0; p < np; p++) {
+            int64_t c = 0;
+            for (int64_t w = nw * p / np; w < nw * (p + 1) / np; w++) c += __builtin_popcountll(cgen_bits_word(m, w));
+            start[p + 1] = c;
+        }
+#pragma omp single
+        {
+            for (int i = 0; i < np; i++) start[i + 1] += start[i];
+            total = start[np];
+            alloc(total);
+        }
+#pragma omp for schedule(static)
+        for (int p = 0; p < np; p++) {
+            int64_t k = start[p];
+            for (int64_t w = nw * p / np; w < nw * (p + 1) / np; w++) {
+                uint64_t c = cgen_bits_word(m, w);
+                while (c) {
+                    emit(k++, (w << 6) + __builtin_ctzll(c) + 1);
+                    c &= c - 1;
+                }
+            }
+        }
+    }
+    return total;
+}
+
+// find(m): the indices of the set elements
+template <typename M>
+j2c_array<int64_t> cgen_bits_find(const M &m)
+{
+    j2c_array<int64_t> out;
+    cgen_bits_foreach(m,
+        [&](int64_t n) { out = j2c_array<int64_t>::new_j2c_array_1d(NULL, n); },
+        [&](int64_t k, int64_t i) { out.data[k] = i; });
+    return out;
+}
+
+// A[m]: the elements of A where m is set
+template <typename T, typename M>
+j2c_array<T> cgen_bits_select(const j2c_array<T> &A, const M &m)
+{
+    j2c_array<T> out;
+    const T *a = A.data;
+    cgen_bits_foreach(m,
+        [&](int64_t n) { out = j2c_array<T>::new_j2c_array_1d(NULL, n); },
+        [&](int64_t k, int64_t i) { out.data[k] = a[i - 1]; });
+    return out;
+}
+
+/*
+ * Elementwise logical operations, a word at a time.  The result takes the
+ * shape of the first operand, and ~ clears the bits past the last element.
+ */
+template <typename M1, typename M2, typename F>
+j2c_bitarray cgen_bits_map(const M1 &a, const M2 &b, F f)
+{
+    j2c_bitarray out(NULL, a.num_dim, a.dims);
+    int64_t nw = out.num_chunks();
+#pragma omp parallel for if(nw >= CGEN_BITS_PAR_MIN)
+    for (int64_t w = 0; w < nw; w++) {
+        out.chunks[w] = f(cgen_bits_word(a, w), cgen_bits_word(b, w));
+    }
+    return out;
+}
+
+template <typename M1, typename M2>
+j2c_bitarray cgen_bits_and(const M1 &a, const M2 &b)
+{
+    return cgen_bits_map(a, b, [](uint64_t x, uint64_t y) { return x & y; });
+}
+
+template <typename M1, typename M2>
+j2c_bitarray cgen_bits_or(const M1 &a, const M2 &b)
+{
+    return cgen_bits_map(a, b, [](uint64_t x, uint64_t y) { return x | y; });
+}
+
+template <typename M1, typename M2>
+j2c_bitarray cgen_bits_xor(const M1 &a, const M2 &b)
+{
+    return cgen_bits_map(a, b, [](uint64_t x, uint64_t y) { return x ^ y; });
+}
+
+template <typename M>
+j2c_bitarray cgen_bits_not(const M &a)
+{
+    j2c_bitarray out = cgen_bits_map(a, a, [](uint64_t x, uint64_t) { return ~x; });
+    if (out.len & 63) out.chunks[out.num_chunks() - 1] &= ((uint64_t)1 << (out.len & 63)) - 1;
+    return out;
+}
+
+#endif /* CGEN_BITARRAY_H_ */
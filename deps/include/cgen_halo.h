@@ -0,0 +1,121 @@
+/*
+Copyright (c) 2015, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+- Redistributions of source code must retain the above copyright notice, 
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice, 
+  this list of conditions and the following disclaimer in the documentation 
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CGEN_HALO_H_
+#define CGEN_HALO_H_
+
+#include <mpi.h>
+#include <stdint.h>
+#include <assert.h>
+#include <limits.h>
+#include <algorithm>
+#include <vector>
+
+/*
+ * Ghost plane exchange of distributed stencils.  Every rank holds a block of
+ * the outermost dimension of the global buffers, extended by lo ghost planes
+ * before and hi ghost planes after its own ones.  Planes of the outermost
+ * dimension are contiguous, so they are sent and received in place.
+ */
+
+// Requests of the exchanges started since the last cgen_halo_finish().
+static std::vector<MPI_Request> cgen_halo_requests;
+
+inline int cgen_halo_rank(void) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    return rank;
+}
+
+inline int cgen_halo_size(void) {
+    int size;
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    return size;
+}
+
+// Whether this rank holds the start, resp. the end, of the global buffers.
+inline bool cgen_halo_lower_edge(void) {
+    return cgen_halo_rank() == 0;
+}
+
+inline bool cgen_halo_upper_edge(void) {
+    return cgen_halo_rank() == cgen_halo_size() - 1;
+}
+
+inline void cgen_halo_post(bool recv, void *p, int64_t bytes, int peer, int tag) {
+    assert(bytes <= INT_MAX);
+    MPI_Request req;
+    if (recv) {
+        MPI_Irecv(p, (int)bytes, MPI_BYTE, peer, tag, MPI_COMM_WORLD, &req);
+    } else {
+        MPI_Isend(p, (int)bytes, MPI_BYTE, peer, tag, MPI_COMM_WORLD, &req);
+    }
+    cgen_halo_requests.push_back(req);
+}
+
+/*
+ * Starts filling the ghost planes of a from the neighbouring ranks.  Those of
+ * the first and the last rank wrap around if periodic, else they are zero.
+ * The own planes of a must not be written until cgen_halo_finish().
+ */
+template <typename T>
+void cgen_halo_start(j2c_array<T> &a, int64_t lo, int64_t hi, bool periodic) {
+    int rank = cgen_halo_rank(), size = cgen_halo_size();
+    int64_t plane = 1;
+    for (unsigned i = 0; i + 1 < a.num_dim; i++) {
+        plane *= a.dims[i];
+    }
+    int64_t own = a.dims[a.num_dim - 1] - lo - hi;
+    // the neighbours' ghost planes come from the own ones only
+    assert(own >= lo && own >= hi);
+    int below = rank > 0 ? rank - 1 : periodic ? size - 1 : MPI_PROC_NULL;
+    int above = rank < size - 1 ? rank + 1 : periodic ? 0 : MPI_PROC_NULL;
+    T *data = a.data;
+    if (below == MPI_PROC_NULL) {
+        std::fill(data, data + lo * plane, T());
+    }
+    if (above == MPI_PROC_NULL) {
+        std::fill(data + (lo + own) * plane, data + (lo + own + hi) * plane, T());
+    }
+    // tag 0 goes up, to the ghosts before the own planes, tag 1 down
+    if (lo > 0) {
+        cgen_halo_post(true, data, lo * plane * sizeof(T), below, 0);
+        cgen_halo_post(false, data + own * plane, lo * plane * sizeof(T), above, 0);
+    }
+    if (hi > 0) {
+        cgen_halo_post(true, data + (lo + own) * plane, hi * plane * sizeof(T), above, 1);
+        cgen_halo_post(false, data + lo * plane, hi * plane * sizeof(T), below, 1);
+    }
+}
+
+// Waits for the exchanges started before.
+inline void cgen_halo_finish(void) {
+    if (!cgen_halo_requests.empty()) {
+        MPI_Waitall((int)cgen_halo_requests.size(), &cgen_halo_requests[0], MPI_STATUSES_IGNORE);
+        cgen_halo_requests.clear();
+    }
+}
+
+#endif /* CGEN_HALO_H_ */
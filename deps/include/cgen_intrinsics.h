@@ -24,14 +24,35 @@ THE POSSIBILITY OF SUCH DAMAGE.
  */
 
 
-// count trailing zeros with llvm semantics
-int64_t cgen_cttz_int(int64_t n)
+#include <stdint.h>
+#include <type_traits>
+
+/*
+ * Bit counts with llvm semantics: the result has the type of the operand, and
+ * counting the zeros of 0 gives its width in bits.  The builtins work on the
+ * operand zero-extended to 64 bits, so ctlz drops the extra leading zeros.
+ */
+template <typename T>
+inline T cgen_ctpop_int(T n)
+{
+    return (T)__builtin_popcountll((uint64_t)(typename std::make_unsigned<T>::type)n);
+}
+
+template <typename T>
+inline T cgen_cttz_int(T n)
+{
+    if(n==0) return 8*sizeof(T);
+    return (T)__builtin_ctzll((uint64_t)(typename std::make_unsigned<T>::type)n);
+}
+
+template <typename T>
+inline T cgen_ctlz_int(T n)
 {
-    if(n==0) return sizeof(int64_t);
-    return __builtin_ctz(n);
+    if(n==0) return 8*sizeof(T);
+    return (T)(__builtin_clzll((uint64_t)(typename std::make_unsigned<T>::type)n) - (64 - 8*sizeof(T)));
 }
 
-int64_t cgen_flipsign_int(int64_t x, int64_t y)
+inline int64_t cgen_flipsign_int(int64_t x, int64_t y)
 {
     return (y >= 0 ? x : -x);
 }
@@ -0,0 +1,223 @@
+/*
+Copyright (c) 2015, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+- Redistributions of source code must retain the above copyright notice, 
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice, 
+  this list of conditions and the following disclaimer in the documentation 
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CGEN_LAPACK_H_
+#define CGEN_LAPACK_H_
+
+#include <cmath>
+#include "cgen_linalg.h"
+
+/*
+ * LAPACK subset used when MKL is not available: Cholesky (potrf), LU with
+ * partial pivoting (getrf/getrs/gesv) and triangular solves (trsm/trtrs) on
+ * column-major data.  The routines are blocked right-looking versions whose
+ * trailing updates are the packed cgen_gemm, so most of the flops run
+ * multithreaded out of cache; only the narrow panels are factored serially.
+ * Return values follow LAPACK's info convention: 0 on success and k > 0 when
+ * the k-th pivot or leading minor is zero (or not positive for potrf).
+ */
+#ifndef CGEN_LAPACK_NB
+#define CGEN_LAPACK_NB 128
+#endif
+
+// Solves op(A) X = B in place of B, where A is an n x n triangle and B is
+// n x nrhs.  uplo, trans and diag are the LAPACK characters.
+template <typename T>
+void cgen_trsm(char uplo, char trans, char diag, int n, int nrhs, const T *A, int lda, T *B, int ldb)
+{
+    const bool t = trans == 'T' || trans == 'C';
+    const bool unit = diag == 'U';
+    const bool lower = (uplo == 'L') != t;
+    const int NB = CGEN_LAPACK_NB;
+    // Element (i,j) of op(A).
+    auto op = [=](int i, int j) { return t ? Amat(j, i) : Amat(i, j); };
+    if (n <= 0 || nrhs <= 0) return;
+
+    if (lower) {
+        for (int k0 = 0; k0 < n; k0 += NB) {
+            int k1 = std::min(n, k0 + NB);
+#pragma omp parallel for if((int64_t)nrhs * (k1 - k0) * (k1 - k0) >= CGEN_BLAS_PAR_MIN)
+            for (int c = 0; c < nrhs; c++) {
+                for (int i = k0; i < k1; i++) {
+                    T s = Bmat(i, c);
+                    for (int j = k0; j < i; j++) s -= op(i, j) * Bmat(j, c);
+                    Bmat(i, c) = unit ? s : s / op(i, i);
+                }
+            }
+            if (k1 < n) {
+                cgen_gemm<T>(t, false, n - k1, nrhs, k1 - k0, T(-1), t ? &Amat(k0, k1) : &Amat(k1, k0), lda,
+                             &Bmat(k0, 0), ldb, T(1), &Bmat(k1, 0), ldb);
+            }
+        }
+    } else {
+        for (int k1 = n; k1 > 0; k1 -= NB) {
+            int k0 = std::max(0, k1 - NB);
+#pragma omp parallel for if((int64_t)nrhs * (k1 - k0) * (k1 - k0) >= CGEN_BLAS_PAR_MIN)
+            for (int c = 0; c < nrhs; c++) {
+                for (int i = k1 - 1; i >= k0; i--) {
+                    T s = Bmat(i, c);
+                    for (int j = i + 1; j < k1; j++) s -= op(i, j) * Bmat(j, c);
+                    Bmat(i, c) = unit ? s : s / op(i, i);
+                }
+            }
+            if (k0 > 0) {
+                cgen_gemm<T>(t, false, k0, nrhs, k1 - k0, T(-1), t ? &Amat(k0, 0) : &Amat(0, k0), lda,
+                             &Bmat(k0, 0), ldb, T(1), &Bmat(0, 0), ldb);
+            }
+        }
+    }
+}
+
+template <typename T>
+int cgen_trtrs(char uplo, char trans, char diag, int n, int nrhs, const T *A, int lda, T *B, int ldb)
+{
+    if (diag == 'N') {
+        for (int i = 0; i < n; i++) {
+            if (Amat(i, i) == T(0)) return i + 1;
+        }
+    }
+    cgen_trsm(uplo, trans, diag, n, nrhs, A, lda, B, ldb);
+    return 0;
+}
+
+// Cholesky factorization A = U'*U of a symmetric positive definite matrix.
+// Only the upper triangle is read and overwritten with U; the strictly lower
+// triangle is left untouched, as in LAPACK.
+template <typename T>
+int cgen_potrf(int n, T *A, int lda)
+{
+    const int NB = CGEN_LAPACK_NB;
+    for (int k0 = 0; k0 < n; k0 += NB) {
+        int k1 = std::min(n, k0 + NB);
+        for (int j = k0; j < k1; j++) {
+            T d = Amat(j, j);
+            for (int p = k0; p < j; p++) d -= Amat(p, j) * Amat(p, j);
+            if (!(d > T(0))) return j + 1;
+            d = std::sqrt(d);
+            Amat(j, j) = d;
+            for (int i = j + 1; i < k1; i++) {
+                T s = Amat(j, i);
+                for (int p = k0; p < j; p++) s -= Amat(p, j) * Amat(p, i);
+                Amat(j, i) = s / d;
+            }
+        }
+        if (k1 == n) break;
+        // U12 = U11^-T A12
+        cgen_trsm<T>('U', 'T', 'N', k1 - k0, n - k1, &Amat(k0, k0), lda, &Amat(k0, k1), lda);
+        // A22 -= U12'*U12, upper triangle only, one block column at a time.
+#pragma omp parallel for schedule(dynamic)
+        for (int j0 = k1; j0 < n; j0 += NB) {
+            int j1 = std::min(n, j0 + NB);
+            cgen_gemm<T>(true, false, j0 - k1, j1 - j0, k1 - k0, T(-1), &Amat(k0, k1), lda,
+                         &Amat(k0, j0), lda, T(1), &Amat(k1, j0), lda);
+            for (int j = j0; j < j1; j++) {
+                for (int i = j0; i <= j; i++) {
+                    T s = 0;
+                    for (int p = k0; p < k1; p++) s += Amat(p, i) * Amat(p, j);
+                    Amat(i, j) -= s;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+// LU factorization with partial pivoting of the n x n matrix A.  ipiv
+// receives 1-based pivot rows as in LAPACK.  A zero pivot is reported but the
+// factorization is completed.
+template <typename T>
+int cgen_getrf(int n, T *A, int lda, int *ipiv)
+{
+    const int NB = CGEN_LAPACK_NB;
+    int info = 0;
+    for (int k0 = 0; k0 < n; k0 += NB) {
+        int k1 = std::min(n, k0 + NB);
+        for (int j = k0; j < k1; j++) {
+            int p = j;
+            T best = std::abs(Amat(j, j));
+            for (int i = j + 1; i < n; i++) {
+                if (std::abs(Amat(i, j)) > best) {
+                    best = std::abs(Amat(i, j));
+                    p = i;
+                }
+            }
+            ipiv[j] = p + 1;
+            if (Amat(p, j) == T(0)) {
+                if (info == 0) info = j + 1;
+                continue;
+            }
+            if (p != j) {
+                for (int c = k0; c < k1; c++) std::swap(Amat(j, c), Amat(p, c));
+            }
+            T r = T(1) / Amat(j, j);
+            for (int i = j + 1; i < n; i++) Amat(i, j) *= r;
+            for (int c = j + 1; c < k1; c++) {
+                T u = Amat(j, c);
+                for (int i = j + 1; i < n; i++) Amat(i, c) -= Amat(i, j) * u;
+            }
+        }
+        // Apply the panel's row swaps to the columns left and right of it.
+#pragma omp parallel for if((int64_t)n * (k1 - k0) >= CGEN_BLAS_PAR_MIN)
+        for (int c = 0; c < n; c++) {
+            if (c >= k0 && c < k1) continue;
+            for (int j = k0; j < k1; j++) {
+                if (ipiv[j] - 1 != j) std::swap(Amat(j, c), Amat(ipiv[j] - 1, c));
+            }
+        }
+        if (k1 == n) break;
+        // U12 = L11^-1 A12, then A22 -= L21*U12.
+        cgen_trsm<T>('L', 'N', 'U', k1 - k0, n - k1, &Amat(k0, k0), lda, &Amat(k0, k1), lda);
+        cgen_gemm<T>(false, false, n - k1, n - k1, k1 - k0, T(-1), &Amat(k1, k0), lda,
+                     &Amat(k0, k1), lda, T(1), &Amat(k1, k1), lda);
+    }
+    return info;
+}
+
+// Solves A X = B with the factors from cgen_getrf.
+template <typename T>
+void cgen_getrs(int n, int nrhs, const T *A, int lda, const int *ipiv, T *B, int ldb)
+{
+#pragma omp parallel for if((int64_t)n * nrhs >= CGEN_BLAS_PAR_MIN)
+    for (int c = 0; c < nrhs; c++) {
+        for (int i = 0; i < n; i++) {
+            if (ipiv[i] - 1 != i) std::swap(Bmat(i, c), Bmat(ipiv[i] - 1, c));
+        }
+    }
+    cgen_trsm<T>('L', 'N', 'U', n, nrhs, A, lda, B, ldb);
+    cgen_trsm<T>('U', 'N', 'N', n, nrhs, A, lda, B, ldb);
+}
+
+// Solves A X = B, overwriting A with its LU factors and B with X.
+template <typename T>
+int cgen_gesv(int n, int nrhs, T *A, int lda, T *B, int ldb)
+{
+    std::vector<int> ipiv(std::max(n, 1));
+    int info = cgen_getrf(n, A, lda, ipiv.data());
+    if (info > 0) return info;
+    cgen_getrs(n, nrhs, A, lda, ipiv.data(), B, ldb);
+    return 0;
+}
+
+#endif /* CGEN_LAPACK_H_ */
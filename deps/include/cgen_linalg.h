@@ -23,229 +23,547 @@ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
 THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#ifndef CGEN_LINALG_H_
+#define CGEN_LINALG_H_
+
 #include <stdio.h>
 #include <math.h>
+#include <float.h>
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#ifdef __AVX__
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
-void cgen_cblas_dgemm(bool tA, bool tB, int m, int n, int k, double* A, int lda, double* B, int ldb, double* C, int ldc)
-{
-
-    // printf("tA %d tB %d m %d n %d k %d lda %d ldb %d ldc %d\n",tA,tB,m,n,k,lda,ldb,ldc);
+/*
+ * The BLAS fallbacks called by generated code are compiled into libj2carray.
+ * Generated code that is built with J2C_PREBUILT_RUNTIME only sees these
+ * declarations and links to the library instead of compiling them again.
+ */
+void cgen_cblas_dgemm(bool tA, bool tB, int m, int n, int k, double alpha, double* A, int lda, double* B, int ldb, double beta, double* C, int ldc);
+void cgen_cblas_sgemm(bool tA, bool tB, int m, int n, int k, float alpha, float* A, int lda, float* B, int ldb, float beta, float* C, int ldc);
+void cgen_cblas_dgemv(bool tA, int m, int n, double* A, int lda, double* y, double* x);
+void cgen_cblas_sgemv(bool tA, int m, int n, float* A, int lda, float* y, float* x);
+double cgen_cblas_dasum(int n, double* y);
+float cgen_cblas_sasum(int n, float* y);
+double cgen_cblas_dnrm2(int n, double* y);
+float cgen_cblas_snrm2(int n, float* y);
+void cgen_somatcopy(int m, int n, float *A, int lda, float *B, int ldb);
+void cgen_domatcopy(int m, int n, double *A, int lda, double *B, int ldb);
 
 #define Amat(I,J) A[(I) + (J)*(lda)]
 #define Bmat(I,J) B[(I) + (J)*(ldb)]
 #define Cmat(I,J) C[(I) + (J)*(ldc)]
 
-    int i,j,l;
-    double tmp;
+/*
+ * GEMM fallback used when no BLAS library is available.  Computes
+ * C = alpha*op(A)*op(B) + beta*C on column-major data, following the
+ * Goto/BLIS scheme: op(B) is packed into KC x NC blocks of NR-wide panels and
+ * op(A) into MC x KC blocks of MR-tall panels, so that the MR x NR micro-kernel
+ * streams both operands with unit stride out of cache whatever the transpose
+ * flags are.  Threads split the MC blocks of each packed B block.
+ */
+template <typename T> struct cgen_gemm_blocking;
 
-    if (!tA) {
-        if(!tB){
-            for(i=0; i<m; i++) {
-                for(j=0; j<n; j++) {
-                    Cmat(i,j) = tmp = 0.0;
-                    for(l=0; l<k; l++)
-                        tmp += Amat(i,l)* Bmat(l,j);
-                    Cmat(i,j) = tmp;
-                }
+template <> struct cgen_gemm_blocking<double> {
+    enum { MR = 8, NR = 4, MC = 128, KC = 256, NC = 2048 };
+};
+
+template <> struct cgen_gemm_blocking<float> {
+    enum { MR = 16, NR = 4, MC = 128, KC = 384, NC = 2048 };
+};
+
+// Products with fewer multiply-adds than this skip packing.
+#ifndef CGEN_GEMM_SMALL
+#define CGEN_GEMM_SMALL (64 * 64 * 64)
+#endif
+
+template <typename T, int MR>
+static void cgen_gemm_pack_a(bool tA, int mc, int kc, const T *A, int lda, T *Ap)
+{
+    for (int ir = 0; ir < mc; ir += MR) {
+        int mr = std::min(MR, mc - ir);
+        T *dst = Ap + (int64_t)ir * kc;
+        if (!tA) {
+            for (int l = 0; l < kc; l++) {
+                const T *src = &Amat(ir, l);
+                for (int i = 0; i < mr; i++) dst[l * MR + i] = src[i];
+                for (int i = mr; i < MR; i++) dst[l * MR + i] = T(0);
             }
-        }
-        else{
-            for(i=0; i<m; i++) {
-                for(j=0; j<n; j++) {
-                    Cmat(i,j) = tmp = 0.0;
-                    for(l=0; l<k; l++)
-                        tmp += Amat(i,l)* Bmat(j,l);
-                    Cmat(i,j) = tmp;
-                }
+        } else {
+            for (int i = 0; i < mr; i++) {
+                const T *src = &Amat(0, ir + i);
+                for (int l = 0; l < kc; l++) dst[l * MR + i] = src[l];
+            }
+            for (int i = mr; i < MR; i++) {
+                for (int l = 0; l < kc; l++) dst[l * MR + i] = T(0);
             }
         }
     }
-    else {
-        if(!tB){
-            for(i=0; i<m; i++) {
-                for(j=0; j<n; j++) {
-                    Cmat(i,j) = tmp = 0.0;
-                    for(l=0; l<k; l++)
-                        tmp += Amat(l,i)* Bmat(l,j);
-                    Cmat(i,j) = tmp;
-                }
-            }
+}
+
+// Packs the NR-wide panel starting at column jr of op(B).
+template <typename T, int NR>
+static void cgen_gemm_pack_b(bool tB, int jr, int nc, int kc, const T *B, int ldb, T *Bp)
+{
+    int nr = std::min(NR, nc - jr);
+    T *dst = Bp + (int64_t)jr * kc;
+    if (!tB) {
+        for (int j = 0; j < nr; j++) {
+            const T *src = &Bmat(0, jr + j);
+            for (int l = 0; l < kc; l++) dst[l * NR + j] = src[l];
         }
-        else{
-            for(i=0; i<m; i++) {
-                for(j=0; j<n; j++) {
-                    Cmat(i,j) = tmp = 0.0;
-                    for(l=0; l<k; l++)
-                        tmp += Amat(l,i)* Bmat(j,l);
-                    Cmat(i,j) = tmp;
-                }
-            }
+        for (int j = nr; j < NR; j++) {
+            for (int l = 0; l < kc; l++) dst[l * NR + j] = T(0);
+        }
+    } else {
+        for (int l = 0; l < kc; l++) {
+            const T *src = &Bmat(jr, l);
+            for (int j = 0; j < nr; j++) dst[l * NR + j] = src[j];
+            for (int j = nr; j < NR; j++) dst[l * NR + j] = T(0);
         }
     }
-
 }
 
-void cgen_cblas_sgemm(bool tA, bool tB, int m, int n, int k, float* A, int lda, float* B, int ldb, float* C, int ldc)
+// C[0:mr, 0:nr] += alpha * Ap * Bp for one MR x kc panel of A and kc x NR panel of B.
+template <typename T, int MR, int NR>
+static inline void cgen_gemm_micro(int kc, const T * __restrict Ap, const T * __restrict Bp,
+                                   T alpha, T *C, int ldc, int mr, int nr)
 {
+    T acc[NR][MR] = {};
+    for (int l = 0; l < kc; l++) {
+        const T *a = Ap + l * MR;
+        const T *b = Bp + l * NR;
+        for (int j = 0; j < NR; j++) {
+#pragma omp simd
+            for (int i = 0; i < MR; i++) acc[j][i] += a[i] * b[j];
+        }
+    }
+    if (mr == MR && nr == NR) {
+        for (int j = 0; j < NR; j++) {
+#pragma omp simd
+            for (int i = 0; i < MR; i++) Cmat(i, j) += alpha * acc[j][i];
+        }
+    } else {
+        for (int j = 0; j < nr; j++) {
+            for (int i = 0; i < mr; i++) Cmat(i, j) += alpha * acc[j][i];
+        }
+    }
+}
 
-    // printf("tA %d tB %d m %d n %d k %d lda %d ldb %d ldc %d\n",tA,tB,m,n,k,lda,ldb,ldc);
-
-#define Amat(I,J) A[(I) + (J)*(lda)]
-#define Bmat(I,J) B[(I) + (J)*(ldb)]
-#define Cmat(I,J) C[(I) + (J)*(ldc)]
-
-    int i,j,l;
-    float tmp;
-
-    if (!tA) {
-        if(!tB){
-            for(i=0; i<m; i++) {
-                for(j=0; j<n; j++) {
-                    Cmat(i,j) = tmp = 0.0;
-                    for(l=0; l<k; l++)
-                        tmp += Amat(i,l)* Bmat(l,j);
-                    Cmat(i,j) = tmp;
-                }
+template <typename T>
+static void cgen_gemm_small(bool tA, bool tB, int m, int n, int k, T alpha, const T *A, int lda,
+                            const T *B, int ldb, T *C, int ldc)
+{
+    for (int j = 0; j < n; j++) {
+        if (!tA) {
+            for (int l = 0; l < k; l++) {
+                T b = alpha * (tB ? Bmat(j, l) : Bmat(l, j));
+                for (int i = 0; i < m; i++) Cmat(i, j) += Amat(i, l) * b;
             }
-        }
-        else{
-            for(i=0; i<m; i++) {
-                for(j=0; j<n; j++) {
-                    Cmat(i,j) = tmp = 0.0;
-                    for(l=0; l<k; l++)
-                        tmp += Amat(i,l)* Bmat(j,l);
-                    Cmat(i,j) = tmp;
-                }
+        } else {
+            for (int i = 0; i < m; i++) {
+                T tmp = 0;
+                for (int l = 0; l < k; l++) tmp += Amat(l, i) * (tB ? Bmat(j, l) : Bmat(l, j));
+                Cmat(i, j) += alpha * tmp;
             }
         }
     }
-    else {
-        if(!tB){
-            for(i=0; i<m; i++) {
-                for(j=0; j<n; j++) {
-                    Cmat(i,j) = tmp = 0.0;
-                    for(l=0; l<k; l++)
-                        tmp += Amat(l,i)* Bmat(l,j);
-                    Cmat(i,j) = tmp;
-                }
-            }
+}
+
+template <typename T>
+void cgen_gemm(bool tA, bool tB, int m, int n, int k, T alpha, const T *A, int lda,
+               const T *B, int ldb, T beta, T *C, int ldc)
+{
+    const int MR = cgen_gemm_blocking<T>::MR, NR = cgen_gemm_blocking<T>::NR;
+    const int MC = cgen_gemm_blocking<T>::MC, KC = cgen_gemm_blocking<T>::KC, NC = cgen_gemm_blocking<T>::NC;
+    if (m <= 0 || n <= 0) return;
+
+    if (beta != T(1)) {
+#pragma omp parallel for if((int64_t)m * n >= 65536)
+        for (int j = 0; j < n; j++) {
+            for (int i = 0; i < m; i++) Cmat(i, j) = beta == T(0) ? T(0) : beta * Cmat(i, j);
         }
-        else{
-            for(i=0; i<m; i++) {
-                for(j=0; j<n; j++) {
-                    Cmat(i,j) = tmp = 0.0;
-                    for(l=0; l<k; l++)
-                        tmp += Amat(l,i)* Bmat(j,l);
-                    Cmat(i,j) = tmp;
+    }
+    if (k <= 0 || alpha == T(0)) return;
+
+    if ((int64_t)m * n * k <= CGEN_GEMM_SMALL) {
+        cgen_gemm_small(tA, tB, m, n, k, alpha, A, lda, B, ldb, C, ldc);
+        return;
+    }
+
+    int nthreads = 1;
+#ifdef _OPENMP
+    nthreads = omp_get_max_threads();
+#endif
+    // Shrink the row blocks so that every thread gets one when m is small.
+    int mc_blk = std::min(MC, ((m + nthreads - 1) / nthreads + MR - 1) / MR * MR);
+    std::vector<T> Bp((size_t)KC * ((std::min(NC, n) + NR - 1) / NR * NR));
+
+    for (int jc = 0; jc < n; jc += NC) {
+        int nc = std::min(NC, n - jc);
+        for (int pc = 0; pc < k; pc += KC) {
+            int kc = std::min(KC, k - pc);
+            const T *Bblk = tB ? &Bmat(jc, pc) : &Bmat(pc, jc);
+            const T *Ablk = tA ? &Amat(pc, 0) : &Amat(0, pc);
+#pragma omp parallel
+            {
+#pragma omp for schedule(static)
+                for (int jr = 0; jr < nc; jr += NR) {
+                    cgen_gemm_pack_b<T, NR>(tB, jr, nc, kc, Bblk, ldb, Bp.data());
+                }
+                std::vector<T> Ap((size_t)mc_blk * kc);
+#pragma omp for schedule(dynamic)
+                for (int ic = 0; ic < m; ic += mc_blk) {
+                    int mc = std::min(mc_blk, m - ic);
+                    cgen_gemm_pack_a<T, MR>(tA, mc, kc, tA ? &Ablk[(int64_t)ic * lda] : &Ablk[ic], lda, Ap.data());
+                    for (int jr = 0; jr < nc; jr += NR) {
+                        for (int ir = 0; ir < mc; ir += MR) {
+                            cgen_gemm_micro<T, MR, NR>(kc, &Ap[(size_t)ir * kc], &Bp[(size_t)jr * kc], alpha,
+                                                       &Cmat(ic + ir, jc + jr), ldc,
+                                                       std::min(MR, mc - ir), std::min(NR, nc - jr));
+                        }
+                    }
                 }
             }
         }
     }
+}
 
+#ifndef J2C_PREBUILT_RUNTIME
+void cgen_cblas_dgemm(bool tA, bool tB, int m, int n, int k, double alpha, double* A, int lda, double* B, int ldb, double beta, double* C, int ldc)
+{
+    cgen_gemm<double>(tA, tB, m, n, k, alpha, A, lda, B, ldb, beta, C, ldc);
 }
 
+void cgen_cblas_sgemm(bool tA, bool tB, int m, int n, int k, float alpha, float* A, int lda, float* B, int ldb, float beta, float* C, int ldc)
+{
+    cgen_gemm<float>(tA, tB, m, n, k, alpha, A, lda, B, ldb, beta, C, ldc);
+}
+#endif /* J2C_PREBUILT_RUNTIME */
 
 
-void cgen_cblas_dgemv(bool tA, int m, int n, double* A, int lda, double* y, double* x)
-{
-    double tmp;
-    int i,j;
-#define Amat(I,J) A[(I) + (J)*(lda)]
 
-    if(!tA) {
-        for(i=0; i<m; i++) {
-            tmp = 0.0;
-            for(j=0; j<n; j++) {
-                tmp += Amat(i,j)*x[j];
-            }
-            y[i] = tmp;
-        }
-    } else{
-        for(i=0; i<n; i++) {
-            tmp = 0.0;
-            for(j=0; j<m; j++) {
-                tmp += Amat(j,i)*x[j];
-            }
-            y[i] = tmp;
-        }
+/*
+ * Level-1/2 fallbacks.  Reductions keep eight independent partial sums so the
+ * loop vectorizes and is not bound by the latency of one dependency chain,
+ * and vectors longer than CGEN_BLAS_PAR_MIN are split into blocks that OpenMP
+ * threads reduce in parallel.
+ */
+#ifndef CGEN_BLAS_PAR_MIN
+#define CGEN_BLAS_PAR_MIN 32768
+#endif
+
+#define CGEN_BLAS_BLOCK 4096
+
+template <typename ACC, typename T, typename F>
+static inline ACC cgen_blas_sum8(const T *x, int n, F f)
+{
+    ACC s[8] = {};
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        for (int u = 0; u < 8; u++) s[u] += f(x[i + u]);
     }
+    for (; i < n; i++) s[0] += f(x[i]);
+    return ((s[0] + s[1]) + (s[2] + s[3])) + ((s[4] + s[5]) + (s[6] + s[7]));
 }
 
+template <typename ACC, typename T, typename F>
+static ACC cgen_blas_reduce(int n, const T *x, F f)
+{
+    int nblocks = (n + CGEN_BLAS_BLOCK - 1) / CGEN_BLAS_BLOCK;
+    ACC total = 0;
+#pragma omp parallel for reduction(+:total) if(n >= CGEN_BLAS_PAR_MIN) schedule(static)
+    for (int b = 0; b < nblocks; b++) {
+        int i0 = b * CGEN_BLAS_BLOCK;
+        total += cgen_blas_sum8<ACC>(x + i0, std::min(CGEN_BLAS_BLOCK, n - i0), f);
+    }
+    return total;
+}
 
-void cgen_cblas_sgemv(bool tA, int m, int n, float* A, int lda, float* y, float* x)
+template <typename T>
+static inline T cgen_blas_dot(int n, const T *a, const T *x)
 {
-    float tmp;
-    int i,j;
-#define Amat(I,J) A[(I) + (J)*(lda)]
+    T s[8] = {};
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        for (int u = 0; u < 8; u++) s[u] += a[i + u] * x[i + u];
+    }
+    for (; i < n; i++) s[0] += a[i] * x[i];
+    return ((s[0] + s[1]) + (s[2] + s[3])) + ((s[4] + s[5]) + (s[6] + s[7]));
+}
 
-    if(!tA) {
-        for(i=0; i<m; i++) {
-            tmp = 0.0;
-            for(j=0; j<n; j++) {
-                tmp += Amat(i,j)*x[j];
+// y = op(A) * x for column-major A.  Without transpose y is built as a sum of
+// scaled columns over row blocks, so A is read down its columns; with
+// transpose each y[i] is a dot product with column i.
+template <typename T>
+static void cgen_gemv(bool tA, int m, int n, const T *A, int lda, T *y, const T *x)
+{
+    if (!tA) {
+        const int MB = 512;
+        int nblocks = (m + MB - 1) / MB;
+#pragma omp parallel for if((int64_t)m * n >= CGEN_BLAS_PAR_MIN) schedule(static)
+        for (int b = 0; b < nblocks; b++) {
+            int i0 = b * MB, i1 = std::min(m, i0 + MB);
+            T *yb = y + i0;
+            for (int i = 0; i < i1 - i0; i++) yb[i] = T(0);
+            int j = 0;
+            for (; j + 4 <= n; j += 4) {
+                const T *a0 = &Amat(i0, j), *a1 = &Amat(i0, j + 1), *a2 = &Amat(i0, j + 2), *a3 = &Amat(i0, j + 3);
+                T x0 = x[j], x1 = x[j + 1], x2 = x[j + 2], x3 = x[j + 3];
+#pragma omp simd
+                for (int i = 0; i < i1 - i0; i++) yb[i] += a0[i] * x0 + a1[i] * x1 + a2[i] * x2 + a3[i] * x3;
             }
-            y[i] = tmp;
-        }
-    } else{
-        for(i=0; i<n; i++) {
-            tmp = 0.0;
-            for(j=0; j<m; j++) {
-                tmp += Amat(j,i)*x[j];
+            for (; j < n; j++) {
+                const T *a0 = &Amat(i0, j);
+                T x0 = x[j];
+#pragma omp simd
+                for (int i = 0; i < i1 - i0; i++) yb[i] += a0[i] * x0;
             }
-            y[i] = tmp;
+        }
+    } else {
+#pragma omp parallel for if((int64_t)m * n >= CGEN_BLAS_PAR_MIN) schedule(static)
+        for (int i = 0; i < n; i++) {
+            y[i] = cgen_blas_dot(m, &Amat(0, i), x);
         }
     }
 }
 
+#ifndef J2C_PREBUILT_RUNTIME
+void cgen_cblas_dgemv(bool tA, int m, int n, double* A, int lda, double* y, double* x)
+{
+    cgen_gemv<double>(tA, m, n, A, lda, y, x);
+}
 
+void cgen_cblas_sgemv(bool tA, int m, int n, float* A, int lda, float* y, float* x)
+{
+    cgen_gemv<float>(tA, m, n, A, lda, y, x);
+}
 
 double cgen_cblas_dasum(int n, double* y)
 {
-    double tmp = 0.0;
-    for(int i=0; i<n; i++)
-        tmp += y[i];
-    return tmp;
+    return cgen_blas_reduce<double>(n, y, [](double v) { return fabs(v); });
 }
 
 float cgen_cblas_sasum(int n, float* y)
 {
-    float tmp = 0.0;
-    for(int i=0; i<n; i++)
-        tmp += y[i];
-    return tmp;
+    return cgen_blas_reduce<float>(n, y, [](float v) { return fabsf(v); });
 }
 
+// The sum of squares is accumulated directly and only recomputed with the
+// elements scaled by max|y| when it overflowed or fell into the range where
+// squares of small elements underflow.
 double cgen_cblas_dnrm2(int n, double* y)
 {
-    double tmp = 0.0;
-    for(int i=0; i<n; i++)
-        tmp += y[i]*y[i];
-    return sqrt(tmp);
+    double ssq = cgen_blas_reduce<double>(n, y, [](double v) { return v * v; });
+    if (isfinite(ssq) && ssq >= DBL_MIN / DBL_EPSILON) {
+        return sqrt(ssq);
+    }
+    // a NaN element makes the norm NaN; std::max below would drop it
+    if (ssq != ssq) {
+        return ssq;
+    }
+    double scale = 0.0;
+#pragma omp parallel for reduction(max:scale) if(n >= CGEN_BLAS_PAR_MIN)
+    for (int i = 0; i < n; i++) scale = std::max(scale, fabs(y[i]));
+    if (scale == 0.0 || !isfinite(scale)) {
+        return scale;
+    }
+    double inv = 1.0 / scale;
+    ssq = cgen_blas_reduce<double>(n, y, [inv](double v) { return (v * inv) * (v * inv); });
+    return scale * sqrt(ssq);
 }
 
+// Squares of floats cannot overflow or underflow a double accumulator.
 float cgen_cblas_snrm2(int n, float* y)
 {
-    float tmp = 0.0;
-    for(int i=0; i<n; i++)
-        tmp += y[i]*y[i];
-    return sqrt(tmp);
+    return (float)sqrt(cgen_blas_reduce<double>(n, y, [](float v) { return (double)v * v; }));
 }
+#endif /* J2C_PREBUILT_RUNTIME */
 
-void cgen_somatcopy(int m, int n, float *A, int lda, float *B, int ldb)
+/*
+ * Transpose fallback.  The matrix is walked in CGEN_TRANSPOSE_BLOCK square
+ * blocks so that the source columns and destination columns touched by one
+ * block both stay in cache, and each block is moved in 4x4 tiles that are
+ * transposed in SIMD registers.  Blocks are independent and are spread over
+ * the OpenMP threads.
+ */
+#ifndef CGEN_TRANSPOSE_BLOCK
+#define CGEN_TRANSPOSE_BLOCK 64
+#endif
+
+template <typename T>
+static inline void cgen_transpose_4x4(const T *A, int lda, T *B, int ldb)
 {
-    for(int i=0; i<m; i++) {
-        for(int j=0; j<n; j++) {
+    for(int j=0; j<4; j++) {
+        for(int i=0; i<4; i++) {
             Bmat(j, i) = Amat(i, j);
         }
     }
 }
 
-void cgen_domatcopy(int m, int n, double *A, int lda, double *B, int ldb)
+#ifdef __SSE2__
+template <>
+inline void cgen_transpose_4x4<float>(const float *A, int lda, float *B, int ldb)
 {
-    for(int i=0; i<m; i++) {
-        for(int j=0; j<n; j++) {
+    __m128 c0 = _mm_loadu_ps(&Amat(0, 0));
+    __m128 c1 = _mm_loadu_ps(&Amat(0, 1));
+    __m128 c2 = _mm_loadu_ps(&Amat(0, 2));
+    __m128 c3 = _mm_loadu_ps(&Amat(0, 3));
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+    _mm_storeu_ps(&Bmat(0, 0), c0);
+    _mm_storeu_ps(&Bmat(0, 1), c1);
+    _mm_storeu_ps(&Bmat(0, 2), c2);
+    _mm_storeu_ps(&Bmat(0, 3), c3);
+}
+
+template <>
+inline void cgen_transpose_4x4<double>(const double *A, int lda, double *B, int ldb)
+{
+#ifdef __AVX__
+    __m256d c0 = _mm256_loadu_pd(&Amat(0, 0));
+    __m256d c1 = _mm256_loadu_pd(&Amat(0, 1));
+    __m256d c2 = _mm256_loadu_pd(&Amat(0, 2));
+    __m256d c3 = _mm256_loadu_pd(&Amat(0, 3));
+    __m256d t0 = _mm256_unpacklo_pd(c0, c1);
+    __m256d t1 = _mm256_unpackhi_pd(c0, c1);
+    __m256d t2 = _mm256_unpacklo_pd(c2, c3);
+    __m256d t3 = _mm256_unpackhi_pd(c2, c3);
+    _mm256_storeu_pd(&Bmat(0, 0), _mm256_permute2f128_pd(t0, t2, 0x20));
+    _mm256_storeu_pd(&Bmat(0, 1), _mm256_permute2f128_pd(t1, t3, 0x20));
+    _mm256_storeu_pd(&Bmat(0, 2), _mm256_permute2f128_pd(t0, t2, 0x31));
+    _mm256_storeu_pd(&Bmat(0, 3), _mm256_permute2f128_pd(t1, t3, 0x31));
+#else
+    // Four 2x2 transposes; the off-diagonal pairs trade places.
+    for(int j=0; j<4; j+=2) {
+        for(int i=0; i<4; i+=2) {
+            __m128d c0 = _mm_loadu_pd(&Amat(i, j));
+            __m128d c1 = _mm_loadu_pd(&Amat(i, j+1));
+            _mm_storeu_pd(&Bmat(j, i), _mm_unpacklo_pd(c0, c1));
+            _mm_storeu_pd(&Bmat(j, i+1), _mm_unpackhi_pd(c0, c1));
+        }
+    }
+#endif
+}
+#endif
+
+// B(0:n-1, 0:m-1) = A(0:m-1, 0:n-1)' for one block.
+template <typename T>
+static void cgen_transpose_block(int m, int n, const T *A, int lda, T *B, int ldb)
+{
+    int m4 = m & ~3, n4 = n & ~3;
+    for(int j=0; j<n4; j+=4) {
+        for(int i=0; i<m4; i+=4) {
+            cgen_transpose_4x4(&Amat(i, j), lda, &Bmat(j, i), ldb);
+        }
+        for(int i=m4; i<m; i++) {
+            for(int jj=j; jj<j+4; jj++) {
+                Bmat(jj, i) = Amat(i, jj);
+            }
+        }
+    }
+    for(int j=n4; j<n; j++) {
+        for(int i=0; i<m; i++) {
             Bmat(j, i) = Amat(i, j);
         }
     }
 }
 
+// In-place transpose of the n x n column-major matrix A (n a multiple of 4),
+// swapping 4x4 tiles across the diagonal through a small register-sized buffer.
+template <typename T>
+static void cgen_imatcopy_tiles(int n, T *A, int lda)
+{
+    const int nb = CGEN_TRANSPOSE_BLOCK;
+    int nblocks = (n + nb - 1) / nb;
+#pragma omp parallel for schedule(dynamic) if((int64_t)n * n >= CGEN_BLAS_PAR_MIN)
+    for(int bi=0; bi<nblocks; bi++) {
+        T tile[16];
+        int i0 = bi * nb, i1 = std::min(i0 + nb, n);
+        for(int bj=bi; bj<nblocks; bj++) {
+            int j0 = bj * nb, j1 = std::min(j0 + nb, n);
+            for(int j=j0; j<j1; j+=4) {
+                for(int i=i0; i<i1 && (bi != bj || i <= j); i+=4) {
+                    cgen_transpose_4x4(&Amat(i, j), lda, tile, 4);
+                    if(i != j) {
+                        cgen_transpose_4x4(&Amat(j, i), lda, &Amat(i, j), lda);
+                    }
+                    for(int c=0; c<4; c++) {
+                        for(int r=0; r<4; r++) {
+                            Amat(j + r, i + c) = tile[r + 4 * c];
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+template <typename T>
+void cgen_imatcopy_square(int n, T *A, int lda)
+{
+    int n4 = n & ~3;
+    cgen_imatcopy_tiles(n4, A, lda);
+    for(int i=n4; i<n; i++) {
+        for(int j=0; j<i; j++) {
+            std::swap(Amat(i, j), Amat(j, i));
+        }
+    }
+}
+
+// B = A' for the m x n matrix A.  Aliased square operands (transpose!(A, A))
+// are transposed in place.
+template <typename T>
+void cgen_omatcopy(int m, int n, const T *A, int lda, T *B, int ldb)
+{
+    if(A == B && m == n && lda == ldb) {
+        cgen_imatcopy_square(n, B, ldb);
+        return;
+    }
+    const int nb = CGEN_TRANSPOSE_BLOCK;
+    int mblocks = (m + nb - 1) / nb, nblocks = (n + nb - 1) / nb;
+    int64_t blocks = (int64_t)mblocks * nblocks;
+#pragma omp parallel for schedule(static) if((int64_t)m * n >= CGEN_BLAS_PAR_MIN)
+    for(int64_t b=0; b<blocks; b++) {
+        int i0 = (int)(b % mblocks) * nb, j0 = (int)(b / mblocks) * nb;
+        cgen_transpose_block(std::min(nb, m - i0), std::min(nb, n - j0), &Amat(i0, j0), lda, &Bmat(j0, i0), ldb);
+    }
+}
+
+#ifndef J2C_PREBUILT_RUNTIME
+void cgen_somatcopy(int m, int n, float *A, int lda, float *B, int ldb)
+{
+    cgen_omatcopy(m, n, A, lda, B, ldb);
+}
+
+void cgen_domatcopy(int m, int n, double *A, int lda, double *B, int ldb)
+{
+    cgen_omatcopy(m, n, A, lda, B, ldb);
+}
+#endif /* J2C_PREBUILT_RUNTIME */
+
+/*
+ * A map over the result of a matrix product can be fused into the product:
+ * the generated code then computes the product a panel of columns (or, for
+ * gemv, a block of entries) at a time and runs the map on each panel right
+ * after it is produced, while it is still in cache.  Panels are about
+ * CGEN_FUSED_PANEL_BYTES large but never narrower than min_width so the
+ * product keeps its efficiency.
+ */
+#ifndef CGEN_FUSED_PANEL_BYTES
+#define CGEN_FUSED_PANEL_BYTES (2 << 20)
+#endif
+
+static inline int64_t cgen_fused_panel_width(int64_t rows, int64_t elem_size, int64_t min_width)
+{
+    int64_t w = CGEN_FUSED_PANEL_BYTES / (std::max<int64_t>(rows, 1) * elem_size);
+    return std::max(w, min_width);
+}
+
+#endif /* CGEN_LINALG_H_ */
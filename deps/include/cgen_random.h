@@ -0,0 +1,139 @@
+/*
+Copyright (c) 2015, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+- Redistributions of source code must retain the above copyright notice, 
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice, 
+  this list of conditions and the following disclaimer in the documentation 
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CGEN_RANDOM_H_
+#define CGEN_RANDOM_H_
+
+#include <stdint.h>
+#include <math.h>
+
+/*
+ * Counter-based random numbers for rand/randn (Philox4x32-10, Salmon et al.,
+ * SC'11).  A value is a pure function of a 64-bit key and a 128-bit counter,
+ * so there is no generator state to share or to pad between threads.  The
+ * key mixes the seed drawn from Julia's global RNG at each call with a stream,
+ * the call site and the iteration indices of the enclosing parfors; the
+ * counter is the linear iteration index of the innermost parfor and the
+ * number of draws made so far in that iteration.  Streams for outermost
+ * parfors and for draws outside of parfors are taken in program order from the
+ * scope of the thread: the call itself, or the parfor iteration that called
+ * the function drawing.  The numbers produced therefore do not depend on the
+ * number of threads or on how iterations are scheduled, and loops filling an
+ * array with them vectorize.
+ */
+
+// Seed for the current call, set from Julia through cgen_rand_seed().
+static uint64_t cgen_rand_seed_value = 0;
+// Key of the scope this thread draws streams in, and the streams taken in it so far.
+static thread_local uint64_t cgen_rand_scope_key = 0;
+static thread_local uint64_t cgen_rand_scope_streams = 0;
+
+static inline void cgen_rand_set_seed(uint64_t seed) {
+    cgen_rand_seed_value = seed;
+    cgen_rand_scope_key = 0;
+    cgen_rand_scope_streams = 0;
+}
+
+static inline uint64_t cgen_rand_mix(uint64_t x) {
+    // splitmix64 finalizer
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// The next stream of this thread's scope.
+static inline uint64_t cgen_rand_next_stream(void) {
+    return cgen_rand_mix(cgen_rand_scope_key ^ cgen_rand_mix(cgen_rand_scope_streams++));
+}
+
+static inline uint64_t cgen_rand_key(uint64_t stream, uint64_t site, uint64_t outer) {
+    return cgen_rand_mix(cgen_rand_seed_value ^ cgen_rand_mix(stream ^ cgen_rand_mix((site << 48) ^ outer)));
+}
+
+// Makes key the scope of this thread while a parfor iteration calls functions that draw.
+struct cgen_rand_scope {
+    uint64_t key, streams;
+
+    cgen_rand_scope(uint64_t k) : key(cgen_rand_scope_key), streams(cgen_rand_scope_streams) {
+        cgen_rand_scope_key = k;
+        cgen_rand_scope_streams = 0;
+    }
+
+    ~cgen_rand_scope() {
+        cgen_rand_scope_key = key;
+        cgen_rand_scope_streams = streams;
+    }
+};
+
+static inline uint32_t cgen_philox_mulhilo(uint32_t a, uint32_t b, uint32_t *hi) {
+    uint64_t p = (uint64_t)a * b;
+    *hi = (uint32_t)(p >> 32);
+    return (uint32_t)p;
+}
+
+// Ten Philox rounds on the counter (c0, c1, c2, c3); returns the 128-bit
+// result as two 64-bit words.
+static inline void cgen_philox4x32_10(uint64_t key, uint64_t i, uint64_t j, uint64_t *r0, uint64_t *r1) {
+    uint32_t k0 = (uint32_t)key, k1 = (uint32_t)(key >> 32);
+    uint32_t c0 = (uint32_t)i, c1 = (uint32_t)(i >> 32);
+    uint32_t c2 = (uint32_t)j, c3 = (uint32_t)(j >> 32);
+    for (int round = 0; round < 10; round++) {
+        uint32_t hi0, hi1;
+        uint32_t lo0 = cgen_philox_mulhilo(0xD2511F53u, c0, &hi0);
+        uint32_t lo1 = cgen_philox_mulhilo(0xCD9E8D57u, c2, &hi1);
+        c0 = hi1 ^ c1 ^ k0;
+        c1 = lo1;
+        c2 = hi0 ^ c3 ^ k1;
+        c3 = lo0;
+        k0 += 0x9E3779B9u;
+        k1 += 0xBB67AE85u;
+    }
+    *r0 = ((uint64_t)c1 << 32) | c0;
+    *r1 = ((uint64_t)c3 << 32) | c2;
+}
+
+// 53 random bits to a double in [0, 1).
+static inline double cgen_rand_to_double(uint64_t x) {
+    return (double)(x >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Uniform on [0, 1) like Julia's rand().
+static inline double cgen_rand_uniform(uint64_t key, uint64_t i, uint64_t j) {
+    uint64_t r0, r1;
+    cgen_philox4x32_10(key, i, j, &r0, &r1);
+    return cgen_rand_to_double(r0);
+}
+
+// Standard normal like Julia's randn(), by Box-Muller on one counter block.
+static inline double cgen_rand_normal(uint64_t key, uint64_t i, uint64_t j) {
+    uint64_t r0, r1;
+    cgen_philox4x32_10(key, i, j, &r0, &r1);
+    double u1 = 1.0 - cgen_rand_to_double(r0);    // (0, 1], keeps log finite
+    double u2 = cgen_rand_to_double(r1);
+    return sqrt(-2.0 * log(u1)) * cos(6.283185307179586 * u2);
+}
+
+#endif /* CGEN_RANDOM_H_ */
@@ -0,0 +1,180 @@
+/*
+Copyright (c) 2015, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+- Redistributions of source code must retain the above copyright notice, 
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice, 
+  this list of conditions and the following disclaimer in the documentation 
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CGEN_SCAN_H_
+#define CGEN_SCAN_H_
+
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Scans shorter than this run on a single thread.
+#ifndef CGEN_SCAN_PAR_MIN
+#define CGEN_SCAN_PAR_MIN 32768
+#endif
+
+// Associative operators cumsum, cumprod and accumulate are lowered to.
+struct cgen_scan_add {
+    template <typename T> T operator()(const T &a, const T &b) const { return a + b; }
+};
+
+struct cgen_scan_mul {
+    template <typename T> T operator()(const T &a, const T &b) const { return a * b; }
+};
+
+// max and min propagate NaN as Julia's do; x != x is false for non-floating T.
+struct cgen_scan_max {
+    template <typename T> T operator()(const T &a, const T &b) const { return a != a ? a : (b != b || a < b) ? b : a; }
+};
+
+struct cgen_scan_min {
+    template <typename T> T operator()(const T &a, const T &b) const { return a != a ? a : (b != b || b < a) ? b : a; }
+};
+
+// Fold in[0..n) with four independent accumulators so the loop pipelines
+// and vectorizes; n must be at least 1.
+template <typename TI, typename TO, typename OP>
+TO cgen_scan_block_reduce(const TI *in, int64_t n, OP op)
+{
+    if (n < 4) {
+        TO acc = in[0];
+        for (int64_t i = 1; i < n; i++) acc = op(acc, (TO)in[i]);
+        return acc;
+    }
+    TO a0 = in[0], a1 = in[1], a2 = in[2], a3 = in[3];
+    int64_t i = 4;
+    for (; i + 4 <= n; i += 4) {
+        a0 = op(a0, (TO)in[i]);
+        a1 = op(a1, (TO)in[i + 1]);
+        a2 = op(a2, (TO)in[i + 2]);
+        a3 = op(a3, (TO)in[i + 3]);
+    }
+    for (; i < n; i++) a0 = op(a0, (TO)in[i]);
+    return op(op(a0, a1), op(a2, a3));
+}
+
+// Inclusive scan of in[0..n) seeded with carry; out may alias in.
+template <typename TI, typename TO, typename OP>
+void cgen_scan_block(const TI *in, TO *out, int64_t n, TO carry, OP op)
+{
+    for (int64_t i = 0; i < n; i++) {
+        carry = op(carry, (TO)in[i]);
+        out[i] = carry;
+    }
+}
+
+/*
+ * Parallel inclusive scan out[i] = in[0] op ... op in[i].
+ * Two passes: every thread reduces its block, the block totals are scanned
+ * serially, then every thread rescans its block seeded with the total of the
+ * blocks before it.  out may alias in.
+ */
+template <typename TI, typename TO, typename OP>
+void cgen_scan(const TI *in, TO *out, int64_t n, OP op)
+{
+    if (n <= 0) return;
+#ifdef _OPENMP
+    int nthreads = omp_get_max_threads();
+    if (n >= CGEN_SCAN_PAR_MIN && nthreads > 1 && !omp_in_parallel()) {
+        std::vector<TO> totals(nthreads);
+        int nblocks = nthreads;
+        #pragma omp parallel num_threads(nthreads)
+        {
+            int t = omp_get_thread_num();
+            #pragma omp single
+            nblocks = omp_get_num_threads();
+            int64_t chunk = (n + nblocks - 1) / nblocks;
+            int64_t lo = std::min(n, t * chunk);
+            int64_t hi = std::min(n, lo + chunk);
+            // The last block's total is never needed.
+            if (lo < hi && t < nblocks - 1) {
+                totals[t] = cgen_scan_block_reduce<TI, TO>(in + lo, hi - lo, op);
+            }
+            #pragma omp barrier
+            #pragma omp single
+            for (int b = 1; b < nblocks - 1; b++) {
+                totals[b] = op(totals[b - 1], totals[b]);
+            }
+            if (lo < hi) {
+                if (t == 0) {
+                    out[0] = in[0];
+                    cgen_scan_block<TI, TO>(in + 1, out + 1, hi - 1, out[0], op);
+                } else {
+                    cgen_scan_block<TI, TO>(in + lo, out + lo, hi - lo, totals[t - 1], op);
+                }
+            }
+        }
+        return;
+    }
+#endif
+    out[0] = in[0];
+    cgen_scan_block<TI, TO>(in + 1, out + 1, n - 1, out[0], op);
+}
+
+/*
+ * Scan along the middle dimension of an array viewed as inner x len x outer
+ * (column major), as cumsum(A, dim) does.  Lines along a leading dimension are
+ * scanned independently in parallel; otherwise consecutive rows are combined
+ * elementwise, which keeps the inner loop unit-stride and vectorizable.
+ */
+template <typename TI, typename TO, typename OP>
+void cgen_scan_dim(const TI *in, TO *out, int64_t inner, int64_t len, int64_t outer, OP op)
+{
+    if (inner <= 0 || len <= 0 || outer <= 0) return;
+    if (inner == 1 && outer == 1) {
+        cgen_scan<TI, TO>(in, out, len, op);
+        return;
+    }
+    if (inner == 1) {
+        #pragma omp parallel for if(len * outer >= CGEN_SCAN_PAR_MIN)
+        for (int64_t o = 0; o < outer; o++) {
+            const TI *src = in + o * len;
+            TO *dst = out + o * len;
+            dst[0] = src[0];
+            cgen_scan_block<TI, TO>(src + 1, dst + 1, len - 1, dst[0], op);
+        }
+        return;
+    }
+    #pragma omp parallel for collapse(2) if(inner * len * outer >= CGEN_SCAN_PAR_MIN)
+    for (int64_t o = 0; o < outer; o++) {
+        for (int64_t ib = 0; ib < inner; ib += 256) {
+            int64_t ie = std::min(inner, ib + 256);
+            const TI *src = in + o * inner * len;
+            TO *dst = out + o * inner * len;
+            for (int64_t i = ib; i < ie; i++) dst[i] = src[i];
+            for (int64_t k = 1; k < len; k++) {
+                #pragma omp simd
+                for (int64_t i = ib; i < ie; i++) {
+                    dst[k * inner + i] = op(dst[(k - 1) * inner + i], (TO)src[k * inner + i]);
+                }
+            }
+        }
+    }
+}
+
+#endif /* CGEN_SCAN_H_ */
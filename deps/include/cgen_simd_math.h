@@ -0,0 +1,320 @@
+/*
+Copyright (c) 2015, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+- Redistributions of source code must retain the above copyright notice, 
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice, 
+  this list of conditions and the following disclaimer in the documentation 
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CGEN_SIMD_MATH_H_
+#define CGEN_SIMD_MATH_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <limits>
+
+/*
+ * Vectorizable replacements for the libm functions called in parfor bodies.
+ * They are branch-free and fully inlinable, so a loop that calls them can
+ * still be vectorized, which a call into libm prevents.  CGEN_MATH_ULP picks
+ * the accuracy: at 1 (the default) exp and log are within one ulp and sin,
+ * cos and erf within two (three for float erf); at 4 exp and erf use shorter
+ * polynomials with errors of up to three ulps.  sin and cos reduce their
+ * argument with a three-part pi/2, which is accurate for |x| up to about 1e8;
+ * larger arguments lose accuracy.
+ */
+#ifndef CGEN_MATH_ULP
+#define CGEN_MATH_ULP 1
+#endif
+
+static inline uint64_t cgen_math_bits(double x) { uint64_t u; memcpy(&u, &x, sizeof(u)); return u; }
+static inline double cgen_math_double(uint64_t u) { double x; memcpy(&x, &u, sizeof(x)); return x; }
+static inline uint32_t cgen_math_bits(float x) { uint32_t u; memcpy(&u, &x, sizeof(u)); return u; }
+static inline float cgen_math_float(uint32_t u) { float x; memcpy(&x, &u, sizeof(x)); return x; }
+
+// Adding this to a double of magnitude below 2^51 rounds it to an integer
+// held in the low bits of the sum's representation.
+#define CGEN_MATH_ROUND_D 6755399441055744.0
+#define CGEN_MATH_ROUND_F 12582912.0f
+
+static inline double cgen_simd_sqrt(double x) { return sqrt(x); }
+static inline float cgen_simd_sqrt(float x) { return sqrtf(x); }
+
+static inline double cgen_simd_exp(double x)
+{
+    // exp(x) = 2^k exp(r) with |r| <= log(2)/2; 2^k is applied as two factors
+    // so that results in the subnormal range come out right
+    x = x < -746.0 ? -746.0 : x;
+    x = x > 710.0 ? 710.0 : x;
+    double kd = x * 1.4426950408889634 + CGEN_MATH_ROUND_D;
+    double k = kd - CGEN_MATH_ROUND_D;
+    double r = (x - k * 6.93147180369123816490e-01) - k * 1.90821492927058770002e-10;
+#if CGEN_MATH_ULP >= 4
+    double p = 1.0 / 479001600;
+#else
+    double p = 1.0 / 6227020800;
+    p = p * r + 1.0 / 479001600;
+#endif
+    p = p * r + 1.0 / 39916800;
+    p = p * r + 1.0 / 3628800;
+    p = p * r + 1.0 / 362880;
+    p = p * r + 1.0 / 40320;
+    p = p * r + 1.0 / 5040;
+    p = p * r + 1.0 / 720;
+    p = p * r + 1.0 / 120;
+    p = p * r + 1.0 / 24;
+    p = p * r + 1.0 / 6;
+    p = p * r + 0.5;
+    p = p * r * r + r + 1.0;
+    double k1 = (k * 0.5 + CGEN_MATH_ROUND_D);
+    double k2 = (k - (k1 - CGEN_MATH_ROUND_D)) + CGEN_MATH_ROUND_D;
+    double s1 = cgen_math_double((cgen_math_bits(k1) + 1023) << 52);
+    double s2 = cgen_math_double((cgen_math_bits(k2) + 1023) << 52);
+    return p * s1 * s2;
+}
+
+static inline float cgen_simd_exp(float x)
+{
+    x = x < -104.0f ? -104.0f : x;
+    x = x > 89.0f ? 89.0f : x;
+#if CGEN_MATH_ULP < 4
+    // evaluated in double and rounded once, which keeps the float result within one ulp
+    double xd = x;
+    double kd = xd * 1.4426950408889634 + CGEN_MATH_ROUND_D;
+    double k = kd - CGEN_MATH_ROUND_D;
+    double r = xd - k * 6.93147180559945286227e-01;
+    double p = 1.0 / 40320;
+    p = p * r + 1.0 / 5040;
+    p = p * r + 1.0 / 720;
+    p = p * r + 1.0 / 120;
+    p = p * r + 1.0 / 24;
+    p = p * r + 1.0 / 6;
+    p = p * r + 0.5;
+    p = p * r * r + r + 1.0;
+    return (float)(p * cgen_math_double((cgen_math_bits(kd) + 1023) << 52));
+#else
+    float kd = x * 1.44269504f + CGEN_MATH_ROUND_F;
+    float k = kd - CGEN_MATH_ROUND_F;
+    float r = (x - k * 0.693145751953125f) - k * 1.428606765330187045e-06f;
+    float p = 1.0f / 720;
+    p = p * r + 1.0f / 120;
+    p = p * r + 1.0f / 24;
+    p = p * r + 1.0f / 6;
+    p = p * r + 0.5f;
+    p = p * r * r + r + 1.0f;
+    float k1 = (k * 0.5f + CGEN_MATH_ROUND_F);
+    float k2 = (k - (k1 - CGEN_MATH_ROUND_F)) + CGEN_MATH_ROUND_F;
+    float s1 = cgen_math_float((cgen_math_bits(k1) + 127) << 23);
+    float s2 = cgen_math_float((cgen_math_bits(k2) + 127) << 23);
+    return p * s1 * s2;
+#endif
+}
+
+static inline double cgen_simd_log(double x)
+{
+    // log(x) = k log(2) + log(1+f) with sqrt(2)/2 <= 1+f < sqrt(2), as in fdlibm
+    bool sub = x < 2.2250738585072014e-308;
+    double xs = sub ? x * 18014398509481984.0 : x;
+    uint64_t ix = cgen_math_bits(xs) + ((UINT64_C(0x3ff00000) - UINT64_C(0x3fe6a09e)) << 32);
+    double k = cgen_math_double((ix >> 52) | UINT64_C(0x4330000000000000)) - 4503599627371519.0;
+    k = sub ? k - 54.0 : k;
+    ix = (ix & UINT64_C(0x000fffffffffffff)) + (UINT64_C(0x3fe6a09e) << 32);
+    double f = cgen_math_double(ix) - 1.0;
+    double hfsq = 0.5 * f * f;
+    double s = f / (2.0 + f);
+    double z = s * s;
+    double w = z * z;
+    double t1 = w * (3.999999999940941908e-01 + w * (2.222219843214978396e-01 + w * 1.531383769920937332e-01));
+    double t2 = z * (6.666666666666735130e-01 + w * (2.857142874366239149e-01 + w * (1.818357216161805012e-01 + w * 1.479819860511658591e-01)));
+    double r = s * (hfsq + t1 + t2) + k * 1.90821492927058770002e-10 - hfsq + f + k * 6.93147180369123816490e-01;
+    r = x < 0.0 ? std::numeric_limits<double>::quiet_NaN() : r;
+    r = x == 0.0 ? -std::numeric_limits<double>::infinity() : r;
+    r = x == std::numeric_limits<double>::infinity() || x != x ? x : r;
+    return r;
+}
+
+static inline float cgen_simd_log(float x)
+{
+    bool sub = x < 1.17549435e-38f;
+    float xs = sub ? x * 33554432.0f : x;
+    uint32_t ix = cgen_math_bits(xs) + (0x3f800000 - 0x3f3504f3);
+    float k = cgen_math_float((ix >> 23) | 0x4b000000) - 8388735.0f;
+    k = sub ? k - 25.0f : k;
+    ix = (ix & 0x007fffff) + 0x3f3504f3;
+    float f = cgen_math_float(ix) - 1.0f;
+    float hfsq = 0.5f * f * f;
+    float s = f / (2.0f + f);
+    float z = s * s;
+    float w = z * z;
+    float t1 = w * (0.40000972152f + w * 0.24279078841f);
+    float t2 = z * (0.66666662693f + w * 0.28498786688f);
+    float r = s * (hfsq + t1 + t2) + k * 9.0580006145e-06f - hfsq + f + k * 6.9313812256e-01f;
+    r = x < 0.0f ? std::numeric_limits<float>::quiet_NaN() : r;
+    r = x == 0.0f ? -std::numeric_limits<float>::infinity() : r;
+    r = x == std::numeric_limits<float>::infinity() || x != x ? x : r;
+    return r;
+}
+
+// sin (cos_quadrant = 0) or cos (cos_quadrant = 1) of x = q pi/2 + r, |r| <= pi/4
+static inline double cgen_simd_sincos(double x, uint64_t cos_quadrant)
+{
+    double qd = x * 6.36619772367581382433e-01 + CGEN_MATH_ROUND_D;
+    double q = qd - CGEN_MATH_ROUND_D;
+    uint64_t quadrant = cgen_math_bits(qd) + cos_quadrant;
+    double r = ((x - q * 1.57079625129699707031e+00) - q * 7.54978941586159635336e-08) - q * 5.39030285815811905290e-15;
+    double z = r * r;
+    double ps = 1.58962301576546568060e-10;
+    double pc = -1.13585365213876817300e-11;
+    ps = ps * z - 2.50507477628578072866e-08;
+    pc = pc * z + 2.08757008419747316778e-09;
+    ps = ps * z + 2.75573136213857245213e-06;
+    ps = ps * z - 1.98412698295895385996e-04;
+    ps = ps * z + 8.33333333332211858878e-03;
+    ps = ps * z - 1.66666666666666307295e-01;
+    pc = pc * z - 2.75573141792967388112e-07;
+    pc = pc * z + 2.48015872888517045348e-05;
+    pc = pc * z - 1.38888888888730564116e-03;
+    pc = pc * z + 4.16666666666665929218e-02;
+    double s = r + r * z * ps;
+    double c = (1.0 - 0.5 * z) + z * z * pc;
+    double v = (quadrant & 1) ? c : s;
+    return (quadrant & 2) ? -v : v;
+}
+
+static inline float cgen_simd_sincos(float x, uint64_t cos_quadrant)
+{
+    // the reduction is done in double, a float pi/2 loses too much near the zeros
+    double qd = x * 6.36619772367581382433e-01 + CGEN_MATH_ROUND_D;
+    double q = qd - CGEN_MATH_ROUND_D;
+    uint64_t quadrant = cgen_math_bits(qd) + cos_quadrant;
+    float r = (float)(((x - q * 1.57079625129699707031e+00) - q * 7.54978941586159635336e-08) - q * 5.39030285815811905290e-15);
+    float z = r * r;
+    float s = r + r * z * ((-1.9515295891e-4f * z + 8.3321608736e-3f) * z - 1.6666654611e-1f);
+    float c = (1.0f - 0.5f * z) + z * z * ((2.443315711809948e-05f * z - 1.388731625493765e-03f) * z + 4.166664568298827e-02f);
+    float v = (quadrant & 1) ? c : s;
+    return (quadrant & 2) ? -v : v;
+}
+
+static inline double cgen_simd_sin(double x) { return cgen_simd_sincos(x, 0); }
+static inline double cgen_simd_cos(double x) { return cgen_simd_sincos(x, 1); }
+static inline float cgen_simd_sin(float x) { return cgen_simd_sincos(x, 0); }
+static inline float cgen_simd_cos(float x) { return cgen_simd_sincos(x, 1); }
+
+// p[0] + p[1] x + ... + p[N-1] x^(N-1), unrolled at compile time
+template <int N, typename T>
+struct cgen_horner {
+    static inline T eval(const T *p, T x) { return p[0] + x * cgen_horner<N - 1, T>::eval(p + 1, x); }
+};
+
+template <typename T>
+struct cgen_horner<1, T> {
+    static inline T eval(const T *p, T) { return p[0]; }
+};
+
+// c[0] + c[1] T_1(t) + ... + c[N-1] T_{N-1}(t) by Clenshaw's recurrence
+template <int J, typename T>
+struct cgen_clenshaw {
+    static inline void step(const T *c, T t2, T &b1, T &b2) {
+        T b0 = c[J] + t2 * b1 - b2;
+        b2 = b1;
+        b1 = b0;
+        cgen_clenshaw<J - 1, T>::step(c, t2, b1, b2);
+    }
+};
+
+template <typename T>
+struct cgen_clenshaw<0, T> {
+    static inline void step(const T *, T, T &, T &) {}
+};
+
+template <int N, typename T>
+static inline T cgen_chebyshev(const T *c, T t)
+{
+    T b1 = 0, b2 = 0;
+    cgen_clenshaw<N - 1, T>::step(c, 2 * t, b1, b2);
+    return c[0] + t * b1 - b2;
+}
+
+/*
+ * erf(x) is x times a Taylor polynomial in x^2 for |x| <= 1, and
+ * 1 - exp(-x^2) g(1/x) beyond, with g(1/x) = erfc(x) exp(x^2) as a Chebyshev
+ * series in 1/x.
+ */
+static const double cgen_erf_taylor_d[] = {
+    1.12837916709551256e+00, -3.76126389031837538e-01, 1.12837916709551261e-01,
+    -2.68661706451312522e-02, 5.22397762544218793e-03, -8.54832702345085333e-04,
+    1.20553329817896636e-04, -1.49256503584062504e-05, 1.64621143658892485e-06,
+    -1.63658446912349245e-07, 1.48071928158792176e-08, -1.22905553017179284e-09,
+    9.42275906465041125e-11, -6.71136685516411048e-12, 4.46322426328647749e-13,
+    -2.78351620721092150e-14, 1.63426140953671520e-15, -9.06397084280867278e-17,
+    4.76334804051506831e-18 };
+
+// on 1/x in [1/6, 1]
+static const double cgen_erfc_cheb_d[] = {
+    2.74774685897952842e-01, 1.66993291193103965e-01, -1.47784349082012989e-02,
+    4.60766004373487561e-04, 1.76579678354085826e-04, -5.02698406424690835e-05,
+    7.42701335560753317e-06, -3.51881121924770973e-07, -1.71501128859218187e-07,
+    6.70662305301187335e-08, -1.43165892649144145e-08, 1.75955679085615907e-09,
+    7.45212386675568771e-11, -1.15437842386161940e-10, 3.88734942463099245e-11,
+    -8.50487306719872156e-12, 1.12723137166712353e-12, 4.32816559962955262e-14,
+    -8.42206323127883657e-14, 3.20037030053120174e-14, -8.14712541679328550e-15,
+    1.42795999092011635e-15, -8.79306596610583666e-17, -5.55516394061365850e-17,
+    3.02238296239279447e-17, -9.81338491370942232e-18, 2.23108478306782709e-18 };
+
+static const float cgen_erf_taylor_f[] = {
+    1.12837917e+00f, -3.76126389e-01f, 1.12837917e-01f, -2.68661706e-02f,
+    5.22397763e-03f, -8.54832702e-04f, 1.20553330e-04f, -1.49256504e-05f,
+    1.64621144e-06f, -1.63658447e-07f, 1.48071928e-08f };
+
+// on 1/x in [1/4, 1]
+static const float cgen_erfc_cheb_f[] = {
+    2.940421030e-01f, 1.448563815e-01f, -1.183444196e-02f, 4.602584130e-04f,
+    8.017337860e-05f, -2.429155236e-05f, 3.707847188e-06f, -3.045440051e-07f,
+    -2.171216804e-08f, 1.490857293e-08f, -3.582520523e-09f, 5.686631685e-10f };
+
+static inline double cgen_simd_erf(double x)
+{
+    // erf(|x|) rounds to 1 above 6
+    double a = fabs(x);
+    a = a > 6.0 ? 6.0 : a;
+    double z = a * a;
+    double small = a * cgen_horner<CGEN_MATH_ULP >= 4 ? 17 : 19, double>::eval(cgen_erf_taylor_d, z);
+    double t = (2.0 / a - 7.0 / 6.0) * 1.2;
+    double g = cgen_chebyshev<CGEN_MATH_ULP >= 4 ? 23 : 27, double>(cgen_erfc_cheb_d, t);
+    double large = 1.0 - cgen_simd_exp(-z) * g;
+    double r = a <= 1.0 ? small : large;
+    return x != x ? x : copysign(r, x);
+}
+
+static inline float cgen_simd_erf(float x)
+{
+    float a = fabsf(x);
+    a = a > 4.0f ? 4.0f : a;
+    float z = a * a;
+    float small = a * cgen_horner<CGEN_MATH_ULP >= 4 ? 10 : 11, float>::eval(cgen_erf_taylor_f, z);
+    float t = (2.0f / a - 1.25f) * (4.0f / 3.0f);
+    float g = cgen_chebyshev<CGEN_MATH_ULP >= 4 ? 10 : 12, float>(cgen_erfc_cheb_f, t);
+    float large = 1.0f - cgen_simd_exp(-z) * g;
+    float r = a <= 1.0f ? small : large;
+    return x != x ? x : copysignf(r, x);
+}
+
+#endif /* CGEN_SIMD_MATH_H_ */
@@ -0,0 +1,327 @@
+/*
+Copyright (c) 2015, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+- Redistributions of source code must retain the above copyright notice, 
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice, 
+  this list of conditions and the following disclaimer in the documentation 
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CGEN_SORT_H_
+#define CGEN_SORT_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Sorts shorter than this use the STL on a single thread.
+#ifndef CGEN_SORT_PAR_MIN
+#define CGEN_SORT_PAR_MIN 65536
+#endif
+
+/*
+ * Radix keys.  cgen_sort_key<T>::key maps a value to an unsigned integer whose
+ * order is Julia's isless order on T: signed integers get their sign bit
+ * flipped, floats are mapped so that -0.0 < 0.0 and every NaN sorts last.
+ * Types without a specialization are sorted by comparison.
+ */
+template <typename T>
+struct cgen_sort_key {
+    static const bool radix = false;
+};
+
+#define CGEN_SORT_UNSIGNED_KEY(T)                                   \
+template <> struct cgen_sort_key<T> {                               \
+    static const bool radix = true;                                 \
+    typedef T key_type;                                             \
+    static key_type key(T v) { return v; }                          \
+};
+CGEN_SORT_UNSIGNED_KEY(bool)
+CGEN_SORT_UNSIGNED_KEY(uint8_t)
+CGEN_SORT_UNSIGNED_KEY(uint16_t)
+CGEN_SORT_UNSIGNED_KEY(uint32_t)
+CGEN_SORT_UNSIGNED_KEY(uint64_t)
+#undef CGEN_SORT_UNSIGNED_KEY
+
+#define CGEN_SORT_SIGNED_KEY(T, U)                                  \
+template <> struct cgen_sort_key<T> {                               \
+    static const bool radix = true;                                 \
+    typedef U key_type;                                             \
+    static key_type key(T v) {                                      \
+        return (key_type)v ^ ((key_type)1 << (8 * sizeof(U) - 1));  \
+    }                                                               \
+};
+CGEN_SORT_SIGNED_KEY(int8_t, uint8_t)
+CGEN_SORT_SIGNED_KEY(int16_t, uint16_t)
+CGEN_SORT_SIGNED_KEY(int32_t, uint32_t)
+CGEN_SORT_SIGNED_KEY(int64_t, uint64_t)
+#undef CGEN_SORT_SIGNED_KEY
+
+#define CGEN_SORT_FLOAT_KEY(T, U)                                   \
+template <> struct cgen_sort_key<T> {                               \
+    static const bool radix = true;                                 \
+    typedef U key_type;                                             \
+    static key_type key(T v) {                                      \
+        if (v != v) return ~(key_type)0;                            \
+        key_type u;                                                 \
+        memcpy(&u, &v, sizeof(u));                                  \
+        const key_type sign = (key_type)1 << (8 * sizeof(U) - 1);   \
+        return (u & sign) ? ~u : (u | sign);                        \
+    }                                                               \
+};
+CGEN_SORT_FLOAT_KEY(float, uint32_t)
+CGEN_SORT_FLOAT_KEY(double, uint64_t)
+#undef CGEN_SORT_FLOAT_KEY
+
+// Julia's isless on T, via the radix key when there is one.
+template <typename T, bool RADIX = cgen_sort_key<T>::radix>
+struct cgen_sort_less {
+    bool operator()(const T &a, const T &b) const { return a < b; }
+};
+
+template <typename T>
+struct cgen_sort_less<T, true> {
+    bool operator()(const T &a, const T &b) const {
+        return cgen_sort_key<T>::key(a) < cgen_sort_key<T>::key(b);
+    }
+};
+
+inline int cgen_sort_threads(int64_t n)
+{
+#ifdef _OPENMP
+    if (n >= CGEN_SORT_PAR_MIN && !omp_in_parallel()) {
+        return omp_get_max_threads();
+    }
+#endif
+    return 1;
+}
+
+/*
+ * Stable LSD radix sort of a[0..n) on 8-bit digits of keyof(a[i]).  Every pass
+ * builds per-thread digit histograms over contiguous chunks, turns them into
+ * scatter offsets and scatters; passes in which all keys share a digit are
+ * skipped.
+ */
+template <typename E, typename KEYOF>
+void cgen_radix_sort(E *a, int64_t n, KEYOF keyof)
+{
+    typedef typename std::result_of<KEYOF(const E&)>::type K;
+    if (n <= 1) return;
+    int nthreads = cgen_sort_threads(n);
+    std::vector<E> tmp(n);
+    std::vector<int64_t> offsets((size_t)nthreads * 256);
+    E *src = a, *dst = tmp.data();
+    for (unsigned shift = 0; shift < 8 * sizeof(K); shift += 8) {
+        bool skip = false;
+        #pragma omp parallel num_threads(nthreads)
+        {
+#ifdef _OPENMP
+            int t = omp_get_thread_num();
+            int nt = omp_get_num_threads();
+#else
+            int t = 0, nt = 1;
+#endif
+            int64_t chunk = (n + nt - 1) / nt;
+            int64_t lo = std::min(n, t * chunk);
+            int64_t hi = std::min(n, lo + chunk);
+            int64_t *mine = &offsets[(size_t)t * 256];
+            std::fill(mine, mine + 256, 0);
+            for (int64_t i = lo; i < hi; i++) mine[(keyof(src[i]) >> shift) & 0xff]++;
+            #pragma omp barrier
+            #pragma omp single
+            {
+                int64_t pos = 0;
+                for (int d = 0; d < 256; d++) {
+                    int64_t count = 0;
+                    for (int u = 0; u < nt; u++) {
+                        int64_t c = offsets[(size_t)u * 256 + d];
+                        offsets[(size_t)u * 256 + d] = pos;
+                        pos += c;
+                        count += c;
+                    }
+                    if (count == n) skip = true;
+                }
+            }
+            if (!skip) {
+                for (int64_t i = lo; i < hi; i++) dst[mine[(keyof(src[i]) >> shift) & 0xff]++] = src[i];
+            }
+        }
+        if (!skip) std::swap(src, dst);
+    }
+    if (src != a) {
+        #pragma omp parallel for num_threads(nthreads)
+        for (int64_t i = 0; i < n; i++) a[i] = src[i];
+    }
+}
+
+// Number of elements of a[0..la) among the first d elements of the stable
+// merge of a and b (elements of a win ties).
+template <typename T, typename CMP>
+int64_t cgen_merge_corank(int64_t d, const T *a, int64_t la, const T *b, int64_t lb, CMP cmp)
+{
+    int64_t lo = std::max((int64_t)0, d - lb);
+    int64_t hi = std::min(d, la);
+    while (lo < hi) {
+        int64_t i = lo + (hi - lo) / 2;
+        int64_t j = d - i;
+        if (j > 0 && !cmp(b[j - 1], a[i])) lo = i + 1;
+        else hi = i;
+    }
+    return lo;
+}
+
+/*
+ * Stable parallel merge sort.  Blocks are sorted independently with
+ * std::stable_sort, then merged pairwise; every merge round is split into
+ * equal slices of output along merge paths so all threads stay busy even in
+ * the last rounds.
+ */
+template <typename T, typename CMP>
+void cgen_merge_sort(T *a, int64_t n, CMP cmp)
+{
+    int nthreads = cgen_sort_threads(n);
+    if (nthreads <= 1) {
+        std::stable_sort(a, a + n, cmp);
+        return;
+    }
+    int64_t nblocks = 1;
+    while (nblocks < nthreads) nblocks *= 2;
+    int64_t width = (n + nblocks - 1) / nblocks;
+    #pragma omp parallel for num_threads(nthreads) schedule(dynamic, 1)
+    for (int64_t b = 0; b < nblocks; b++) {
+        int64_t lo = std::min(n, b * width);
+        int64_t hi = std::min(n, lo + width);
+        std::stable_sort(a + lo, a + hi, cmp);
+    }
+    std::vector<T> tmp(n);
+    T *src = a, *dst = tmp.data();
+    for (; width < n; width *= 2) {
+        int64_t npairs = (n + 2 * width - 1) / (2 * width);
+        int64_t slices = std::max((int64_t)1, (int64_t)nthreads / npairs);
+        #pragma omp parallel for num_threads(nthreads) collapse(2)
+        for (int64_t p = 0; p < npairs; p++) {
+            for (int64_t s = 0; s < slices; s++) {
+                int64_t lo = p * 2 * width;
+                int64_t mid = std::min(n, lo + width);
+                int64_t hi = std::min(n, lo + 2 * width);
+                const T *x = src + lo, *y = src + mid;
+                int64_t lx = mid - lo, ly = hi - mid;
+                int64_t d0 = (hi - lo) * s / slices;
+                int64_t d1 = (hi - lo) * (s + 1) / slices;
+                int64_t i0 = cgen_merge_corank(d0, x, lx, y, ly, cmp);
+                int64_t i1 = cgen_merge_corank(d1, x, lx, y, ly, cmp);
+                std::merge(x + i0, x + i1, y + (d0 - i0), y + (d1 - i1), dst + lo + d0, cmp);
+            }
+        }
+        std::swap(src, dst);
+    }
+    if (src != a) {
+        #pragma omp parallel for num_threads(nthreads)
+        for (int64_t i = 0; i < n; i++) a[i] = src[i];
+    }
+}
+
+template <typename T>
+struct cgen_sort_keyof {
+    typename cgen_sort_key<T>::key_type operator()(const T &v) const { return cgen_sort_key<T>::key(v); }
+};
+
+template <typename T>
+void cgen_sort_impl(T *a, int64_t n, std::true_type)
+{
+    cgen_radix_sort(a, n, cgen_sort_keyof<T>());
+}
+
+template <typename T>
+void cgen_sort_impl(T *a, int64_t n, std::false_type)
+{
+    cgen_merge_sort(a, n, cgen_sort_less<T>());
+}
+
+// sort!(a): radix sort for numbers, merge sort for everything else.
+template <typename T>
+void cgen_sort(T *a, int64_t n)
+{
+    if (n < CGEN_SORT_PAR_MIN) {
+        std::sort(a, a + n, cgen_sort_less<T>());
+        return;
+    }
+    cgen_sort_impl(a, n, std::integral_constant<bool, cgen_sort_key<T>::radix>());
+}
+
+template <typename K>
+struct cgen_sortperm_item {
+    K key;
+    int64_t index;
+};
+
+template <typename K>
+struct cgen_sortperm_keyof {
+    K operator()(const cgen_sortperm_item<K> &v) const { return v.key; }
+};
+
+template <typename T>
+struct cgen_sortperm_less {
+    const T *a;
+    cgen_sortperm_less(const T *_a) : a(_a) {}
+    bool operator()(int64_t i, int64_t j) const { return cgen_sort_less<T>()(a[i - 1], a[j - 1]); }
+};
+
+template <typename T>
+void cgen_sortperm_impl(const T *a, int64_t n, int64_t *perm, std::true_type)
+{
+    typedef typename cgen_sort_key<T>::key_type K;
+    std::vector<cgen_sortperm_item<K> > items(n);
+    #pragma omp parallel for num_threads(cgen_sort_threads(n))
+    for (int64_t i = 0; i < n; i++) {
+        items[i].key = cgen_sort_key<T>::key(a[i]);
+        items[i].index = i + 1;
+    }
+    cgen_radix_sort(items.data(), n, cgen_sortperm_keyof<K>());
+    #pragma omp parallel for num_threads(cgen_sort_threads(n))
+    for (int64_t i = 0; i < n; i++) perm[i] = items[i].index;
+}
+
+template <typename T>
+void cgen_sortperm_impl(const T *a, int64_t n, int64_t *perm, std::false_type)
+{
+    #pragma omp parallel for num_threads(cgen_sort_threads(n))
+    for (int64_t i = 0; i < n; i++) perm[i] = i + 1;
+    cgen_merge_sort(perm, n, cgen_sortperm_less<T>(a));
+}
+
+// sortperm(a): the stable (1-based) permutation that sorts a.
+template <typename T>
+void cgen_sortperm(const T *a, int64_t n, int64_t *perm)
+{
+    if (n < CGEN_SORT_PAR_MIN) {
+        for (int64_t i = 0; i < n; i++) perm[i] = i + 1;
+        std::stable_sort(perm, perm + n, cgen_sortperm_less<T>(a));
+        return;
+    }
+    cgen_sortperm_impl(a, n, perm, std::integral_constant<bool, cgen_sort_key<T>::radix>());
+}
+
+#endif /* CGEN_SORT_H_ */
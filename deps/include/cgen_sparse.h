@@ -0,0 +1,218 @@
+/*
+Copyright (c) 2015, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+- Redistributions of source code must retain the above copyright notice, 
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice, 
+  this list of conditions and the following disclaimer in the documentation 
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CGEN_SPARSE_H_
+#define CGEN_SPARSE_H_
+
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/*
+ * Compressed sparse column matrices.  j2c_csc has the fields of Julia's
+ * SparseMatrixCSC, with colptr and rowval 1-based as in Julia, and its
+ * arrays share their data with the Julia matrix it was marshalled from.
+ */
+template <typename Tv, typename Ti>
+struct j2c_csc {
+    int64_t m;
+    int64_t n;
+    j2c_array<Ti> colptr;
+    j2c_array<Ti> rowval;
+    j2c_array<Tv> nzval;
+
+    j2c_csc() : m(0), n(0) {}
+
+    j2c_csc(int64_t _m, int64_t _n, const j2c_array<Ti> &_colptr, const j2c_array<Ti> &_rowval, const j2c_array<Tv> &_nzval)
+        : m(_m), n(_n), colptr(_colptr), rowval(_rowval), nzval(_nzval) {}
+
+    int64_t nnz() const { return n > 0 ? (int64_t)colptr.data[n] - 1 : 0; }
+};
+
+// Products with fewer stored entries than this run on one thread.
+#ifndef CGEN_SPARSE_PAR_MIN
+#define CGEN_SPARSE_PAR_MIN 16384
+#endif
+
+/*
+ * Split the columns of A into parts of equal cost, a column costing one plus
+ * its number of entries as in merge-path partitioning, so that a few dense
+ * columns or many empty ones don't unbalance the threads.  Part t covers
+ * columns bounds[t] to bounds[t+1]-1.
+ */
+template <typename Tv, typename Ti>
+static void cgen_csc_split(const j2c_csc<Tv, Ti> &A, int parts, std::vector<int64_t> &bounds)
+{
+    const Ti *colptr = A.colptr.data;
+    int64_t total = A.nnz() + A.n;
+    bounds.resize(parts + 1);
+    bounds[0] = 0;
+    for (int t = 1; t < parts; t++) {
+        int64_t target = total * t / parts;
+        int64_t lo = bounds[t - 1], hi = A.n;
+        while (lo < hi) {
+            int64_t mid = lo + (hi - lo) / 2;
+            if ((int64_t)colptr[mid] - 1 + mid < target) lo = mid + 1;
+            else hi = mid;
+        }
+        bounds[t] = lo;
+    }
+    bounds[parts] = A.n;
+}
+
+// y += A(:, j0:j1-1) * x(j0:j1-1)
+template <typename Tv, typename Ti>
+static inline void cgen_csc_scatter(const j2c_csc<Tv, Ti> &A, int64_t j0, int64_t j1, const Tv *x, Tv *y)
+{
+    const Ti *colptr = A.colptr.data, *rowval = A.rowval.data;
+    const Tv *nzval = A.nzval.data;
+    for (int64_t j = j0; j < j1; j++) {
+        Tv xj = x[j];
+        if (xj == Tv(0)) continue;
+        for (int64_t p = colptr[j] - 1; p < colptr[j + 1] - 1; p++) {
+            y[rowval[p] - 1] += nzval[p] * xj;
+        }
+    }
+}
+
+// dot product of column j of A with x
+template <typename Tv, typename Ti>
+static inline Tv cgen_csc_dot(const j2c_csc<Tv, Ti> &A, int64_t j, const Tv *x)
+{
+    const Ti *colptr = A.colptr.data, *rowval = A.rowval.data;
+    const Tv *nzval = A.nzval.data;
+    Tv s = 0;
+    for (int64_t p = colptr[j] - 1; p < colptr[j + 1] - 1; p++) {
+        s += nzval[p] * x[rowval[p] - 1];
+    }
+    return s;
+}
+
+/*
+ * y = A*x, or y = A'*x when trans is set.  A'*x is a dot product per column
+ * and threads take balanced ranges of columns.  A*x scatters each column
+ * into y, so threads accumulate their columns into private copies of y that
+ * are summed afterwards, or update y atomically when A has too few entries
+ * per row for that to pay off.
+ */
+template <typename Tv, typename Ti>
+void cgen_csc_mv(bool trans, const j2c_csc<Tv, Ti> &A, const Tv *x, Tv *y)
+{
+    int64_t m = A.m, n = A.n, nnz = A.nnz();
+    int nt = 1;
+#ifdef _OPENMP
+    if (nnz >= CGEN_SPARSE_PAR_MIN) nt = omp_get_max_threads();
+#endif
+    if (trans) {
+        std::vector<int64_t> bounds;
+        cgen_csc_split(A, nt, bounds);
+#pragma omp parallel for schedule(static, 1) if(nt > 1) num_threads(nt)
+        for (int t = 0; t < nt; t++) {
+            for (int64_t j = bounds[t]; j < bounds[t + 1]; j++) y[j] = cgen_csc_dot(A, j, x);
+        }
+        return;
+    }
+    if (nt == 1) {
+        std::fill(y, y + m, Tv(0));
+        cgen_csc_scatter(A, 0, n, x, y);
+        return;
+    }
+    std::vector<int64_t> bounds;
+    cgen_csc_split(A, nt, bounds);
+    if (nnz >= 4 * m) {
+        Tv *partial = new Tv[(size_t)(nt - 1) * m];
+#pragma omp parallel num_threads(nt)
+        {
+            int t = omp_get_thread_num(), used = omp_get_num_threads();
+            // with fewer threads than planned, each one takes several parts
+            for (int part = t; part < nt; part += used) {
+                Tv *yt = part == 0 ? y : partial + (size_t)(part - 1) * m;
+                std::fill(yt, yt + m, Tv(0));
+                cgen_csc_scatter(A, bounds[part], bounds[part + 1], x, yt);
+            }
+#pragma omp barrier
+#pragma omp for schedule(static)
+            for (int64_t i = 0; i < m; i++) {
+                Tv s = 0;
+                for (int part = 1; part < nt; part++) s += partial[(size_t)(part - 1) * m + i];
+                y[i] += s;
+            }
+        }
+        delete [] partial;
+    } else {
+        const Ti *colptr = A.colptr.data, *rowval = A.rowval.data;
+        const Tv *nzval = A.nzval.data;
+#pragma omp parallel num_threads(nt)
+        {
+#pragma omp for schedule(static)
+            for (int64_t i = 0; i < m; i++) y[i] = Tv(0);
+#pragma omp for schedule(static, 1)
+            for (int t = 0; t < nt; t++) {
+                for (int64_t j = bounds[t]; j < bounds[t + 1]; j++) {
+                    Tv xj = x[j];
+                    for (int64_t p = colptr[j] - 1; p < colptr[j + 1] - 1; p++) {
+#pragma omp atomic
+                        y[rowval[p] - 1] += nzval[p] * xj;
+                    }
+                }
+            }
+        }
+    }
+}
+
+/*
+ * C = A*B, or C = A'*B when trans is set, for a dense B with p columns.
+ * With at least as many columns as threads, each thread computes whole
+ * columns of C; otherwise every column is a parallel cgen_csc_mv.
+ */
+template <typename Tv, typename Ti>
+void cgen_csc_mm(bool trans, const j2c_csc<Tv, Ti> &A, int64_t p, const Tv *B, int64_t ldb, Tv *C, int64_t ldc)
+{
+    int64_t rows = trans ? A.n : A.m;
+    int nt = 1;
+#ifdef _OPENMP
+    if (A.nnz() * p >= CGEN_SPARSE_PAR_MIN) nt = omp_get_max_threads();
+#endif
+    if (p < nt) {
+        for (int64_t c = 0; c < p; c++) cgen_csc_mv(trans, A, B + c * ldb, C + c * ldc);
+        return;
+    }
+#pragma omp parallel for schedule(dynamic, 1) if(nt > 1)
+    for (int64_t c = 0; c < p; c++) {
+        const Tv *b = B + c * ldb;
+        Tv *y = C + c * ldc;
+        if (trans) {
+            for (int64_t j = 0; j < rows; j++) y[j] = cgen_csc_dot(A, j, b);
+        } else {
+            std::fill(y, y + rows, Tv(0));
+            cgen_csc_scatter(A, 0, A.n, b, y);
+        }
+    }
+}
+
+#endif /* CGEN_SPARSE_H_ */
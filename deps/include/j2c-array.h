@@ -948,6 +948,71 @@ FLUSH();
     }
 };
 
+/*
+ * Reset a per-thread reduction slot to the neutral value "init".  An array
+ * left in the slot by a previous invocation is reused when the slot is its
+ * sole owner and the shape matches; otherwise the slot gets a private copy so
+ * that threads never update a shared buffer.
+ */
+template <typename ELEMENT_TYPE>
+void j2c_reduction_reshape(j2c_array<ELEMENT_TYPE> &slot, const j2c_array<ELEMENT_TYPE> &like) {
+    bool reusable = slot.refcount != NULL && *slot.refcount == 1 && slot.data != like.data && slot.num_dim == like.num_dim;
+    for (unsigned i = 0; reusable && i < like.num_dim; i++) {
+        reusable = slot.dims[i] == like.dims[i];
+    }
+    if (!reusable) {
+        int64_t dims[MAX_DIM];
+        for (unsigned i = 0; i < like.num_dim; i++) dims[i] = like.dims[i];
+        slot = j2c_array<ELEMENT_TYPE>(NULL, like.num_dim, dims);
+    }
+}
+
+template <typename ELEMENT_TYPE>
+void j2c_reduction_reset(j2c_array<ELEMENT_TYPE> &slot, const j2c_array<ELEMENT_TYPE> &init) {
+    j2c_reduction_reshape(slot, init);
+    std::copy(init.data, init.data + init.ARRAYLEN(), slot.data);
+}
+
+/*
+ * Scatter reductions (acc[idx[i]] += v[i] inside a parfor) pick one of three
+ * strategies per invocation.  Each thread accumulates into a zeroed private
+ * copy of the target when a copy is cheap to allocate and merge, i.e. when it
+ * fits in the per-core cache; larger targets are updated in place with atomic
+ * adds.  A single thread updates the target in place without atomics.
+ */
+#ifndef J2C_SCATTER_PRIVATE_MAX_BYTES
+#define J2C_SCATTER_PRIVATE_MAX_BYTES (256 * 1024)
+#endif
+
+enum j2c_scatter_mode {
+    J2C_SCATTER_PRIVATE = 0,
+    J2C_SCATTER_ATOMIC  = 1,
+    J2C_SCATTER_SERIAL  = 2
+};
+
+template <typename ELEMENT_TYPE>
+j2c_scatter_mode j2c_scatter_choose(const j2c_array<ELEMENT_TYPE> &target, unsigned nthreads) {
+    if (nthreads <= 1) return J2C_SCATTER_SERIAL;
+    if (target.ARRAYLEN() * sizeof(ELEMENT_TYPE) <= J2C_SCATTER_PRIVATE_MAX_BYTES) return J2C_SCATTER_PRIVATE;
+    return J2C_SCATTER_ATOMIC;
+}
+
+template <typename ELEMENT_TYPE>
+void j2c_scatter_zero(j2c_array<ELEMENT_TYPE> &slot, const j2c_array<ELEMENT_TYPE> &target) {
+    j2c_reduction_reshape(slot, target);
+    std::fill(slot.data, slot.data + target.ARRAYLEN(), ELEMENT_TYPE(0));
+}
+
+template <typename ELEMENT_TYPE, typename VALUE_TYPE>
+inline void j2c_scatter_add(ELEMENT_TYPE &elem, VALUE_TYPE v, j2c_scatter_mode mode) {
+    if (mode == J2C_SCATTER_ATOMIC) {
+#pragma omp atomic
+        elem += v;
+    } else {
+        elem += v;
+    }
+}
+
 template <typename ELEMENT_TYPE>
 uint64_t TOTALSIZE(j2c_array<ELEMENT_TYPE> &array) {
     return array.ARRAYLEN() * sizeof(ELEMENT_TYPE);
@@ -1184,16 +1249,17 @@ ASCIIString jl_alloc_string(const T &v) {
     return res;
 }
 
-j2c_array<uint8_t> jl_string_to_array(const ASCIIString &s) {
-    j2c_array<uint8_t> res = j2c_array<uint8_t>::new_j2c_array_1d(NULL, s.ARRAYLEN()+1);
-    strncpy((char *)res.data, (const char *)s.data.data, s.ARRAYLEN()+1);
-    return res;
-}
-
-ASCIIString jl_array_to_string(const j2c_array<uint8_t> &s) {
-    ASCIIString res = ASCIIString((const char *)s.data, s.ARRAYLEN());
-    return res;
-}
+/*
+ * The string helpers below are compiled into libj2carray.  Generated code that
+ * is built with J2C_PREBUILT_RUNTIME only sees their declarations and links to
+ * the library instead of compiling them again.
+ */
+j2c_array<uint8_t> jl_string_to_array(const ASCIIString &s);
+ASCIIString jl_array_to_string(const j2c_array<uint8_t> &s);
+ASCIIString BaseString(const char *s);
+ASCIIString BaseString(const ASCIIString &s);
+std::ostream& operator<<(std::ostream& out, ASCIIString& p);
+std::istream& operator>>(std::istream& in, ASCIIString& p);
 
 /*
  * We implement our own BaseString to construct ASCIIString and its constructor that takes an arbitrary 
@@ -1205,6 +1271,27 @@ ASCIIString jl_array_to_string(const j2c_array<uint8_t> &s) {
  * Then, a concact constructor is called for ASCIIString to bring the separate ASCIIStrings for the first
  * and rest arguments together.
  */
+template<typename T, typename... Args>
+ASCIIString BaseString(T s, Args... args) {
+    ASCIIString s1 = BaseString(s);
+    //std::cout << "s1 = " << s1.data.data << " len = " << s1.ARRAYLEN() << std::endl;
+    ASCIIString s2 = BaseString(args...);
+    //std::cout << "s2 = " << s2.data.data << " len = " << s2.ARRAYLEN() << std::endl;
+    return ASCIIString((const char *)s1.data.data, s1.ARRAYLEN()+1, (const char *)s2.data.data, s2.ARRAYLEN()+1);
+}
+
+#ifndef J2C_PREBUILT_RUNTIME
+j2c_array<uint8_t> jl_string_to_array(const ASCIIString &s) {
+    j2c_array<uint8_t> res = j2c_array<uint8_t>::new_j2c_array_1d(NULL, s.ARRAYLEN()+1);
+    strncpy((char *)res.data, (const char *)s.data.data, s.ARRAYLEN()+1);
+    return res;
+}
+
+ASCIIString jl_array_to_string(const j2c_array<uint8_t> &s) {
+    ASCIIString res = ASCIIString((const char *)s.data, s.ARRAYLEN());
+    return res;
+}
+
 ASCIIString BaseString(const char *s) {
     ASCIIString res(s);
     //std::cout << "BaseString const char res = " << res.data.data << " len = " << res.ARRAYLEN() << std::endl;
@@ -1218,15 +1305,6 @@ ASCIIString BaseString(const ASCIIString &s) {
     return res;
 }
 
-template<typename T, typename... Args>
-ASCIIString BaseString(T s, Args... args) {
-    ASCIIString s1 = BaseString(s);
-    //std::cout << "s1 = " << s1.data.data << " len = " << s1.ARRAYLEN() << std::endl;
-    ASCIIString s2 = BaseString(args...);
-    //std::cout << "s2 = " << s2.data.data << " len = " << s2.ARRAYLEN() << std::endl;
-    return ASCIIString((const char *)s1.data.data, s1.ARRAYLEN()+1, (const char *)s2.data.data, s2.ARRAYLEN()+1);
-}
-
 std::ostream& operator<<(std::ostream& out, ASCIIString& p)
 {
     out << std::string((char*)p.data.data, p.data.ARRAYLEN());
@@ -1240,6 +1318,7 @@ std::istream& operator>>(std::istream& in, ASCIIString& p)
     p = s.c_str();
     return in;
 }
+#endif /* J2C_PREBUILT_RUNTIME */
 
 template <typename ELEMENT_TYPE>
 std::fstream & operator<<(std::fstream &out, const j2c_array<ELEMENT_TYPE> &a) {
@@ -35,6 +35,8 @@ THE POSSIBILITY OF SUCH DAMAGE.
 #include <iostream>
 #include <sstream>
 #include <algorithm>
+#include <new>
+#include <utility>
 
 static unsigned cur_threads_used = 1;
 
@@ -119,7 +121,7 @@ public:
     }
 };
 
-unsigned computeNumThreads(uint64_t instruction_count_estimate) {
+inline unsigned computeNumThreads(uint64_t instruction_count_estimate) {
 #ifdef __MIC__
     unsigned est = instruction_count_estimate / 5500000;
 #else
@@ -135,6 +137,70 @@ unsigned computeNumThreads(uint64_t instruction_count_estimate) {
     return ret;
 }
 
+#ifndef J2C_CACHE_LINE_SIZE
+#define J2C_CACHE_LINE_SIZE 64
+#endif
+
+// Below this many threads a scalar reduction is combined serially; the
+// per-level parallel regions of the tree combine cost more than they save.
+#ifndef J2C_REDUCTION_TREE_MIN_THREADS
+#define J2C_REDUCTION_TREE_MIN_THREADS 32
+#endif
+
+/*
+ * Per-thread partial results of a parallel reduction.  Every slot sits on its
+ * own cache line so that threads updating their partial result do not
+ * false-share.  Generated code keeps one instance per parfor site and calling
+ * thread, so the slots (and any arrays they hold) survive across invocations
+ * and are only reallocated when the thread count grows.
+ */
+template <typename T>
+class j2c_reduction_slots {
+protected:
+    struct alignas(J2C_CACHE_LINE_SIZE) padded_slot {
+        T v;
+        padded_slot() : v() {}
+    };
+    padded_slot *m_slots;
+    unsigned m_size;
+
+    j2c_reduction_slots(const j2c_reduction_slots &);
+    j2c_reduction_slots & operator=(const j2c_reduction_slots &);
+public:
+    j2c_reduction_slots(void) : m_slots(NULL), m_size(0) {}
+
+    ~j2c_reduction_slots() {
+        for (unsigned i = 0; i < m_size; i++) m_slots[i].~padded_slot();
+        free(m_slots);
+    }
+
+    void reserve(unsigned n) {
+        if (n <= m_size) return;
+        void *p = NULL;
+        if (posix_memalign(&p, J2C_CACHE_LINE_SIZE, sizeof(padded_slot) * n) != 0) {
+            assert(0);
+        }
+        padded_slot *slots = (padded_slot*)p;
+        for (unsigned i = 0; i < m_size; i++) {
+            new (&slots[i]) padded_slot();
+            slots[i].v = std::move(m_slots[i].v);
+            m_slots[i].~padded_slot();
+        }
+        for (unsigned i = m_size; i < n; i++) new (&slots[i]) padded_slot();
+        free(m_slots);
+        m_slots = slots;
+        m_size = n;
+    }
+
+    unsigned size(void) const {
+        return m_size;
+    }
+
+    T & operator[](unsigned i) {
+        return m_slots[i].v;
+    }
+};
+
 #define ALLOC alloc_if(1) free_if(0)
 #define FREE  alloc_if(0) free_if(1)
 #define REUSE alloc_if(0) free_if(0)
@@ -154,7 +220,7 @@ static double timestamp ()
 #define julia_Base__assert(x) assert(x)
 #define julia_Base__StepRange(x,y,z) StepRange{x,y,z}
 
-int64_t checked_sadd(int64_t a, int64_t b) {
+inline int64_t checked_sadd(int64_t a, int64_t b) {
     if (a > 0 && b > LLONG_MAX - a) {
         /* handle overflow */
         assert(0);
@@ -167,4 +233,42 @@ int64_t checked_sadd(int64_t a, int64_t b) {
 
 #define checked_ssub(a, b) checked_sadd(a,-b)
 
+/* The highest x86-64 micro-architecture level, 1 to 4, that the running CPU
+   supports.  Generated code with parfors picks its version of the root function
+   with it. */
+inline int cgen_isa_level(void) {
+#if defined(__GNUC__) && !defined(__INTEL_COMPILER) && defined(__x86_64__)
+    static const int level = [] {
+        __builtin_cpu_init();
+        if (!__builtin_cpu_supports("popcnt") || !__builtin_cpu_supports("sse4.2")) {
+            return 1;
+        }
+        if (!__builtin_cpu_supports("avx2") || !__builtin_cpu_supports("fma") ||
+            !__builtin_cpu_supports("bmi") || !__builtin_cpu_supports("bmi2")) {
+            return 2;
+        }
+        if (!__builtin_cpu_supports("avx512f") || !__builtin_cpu_supports("avx512bw") ||
+            !__builtin_cpu_supports("avx512dq") || !__builtin_cpu_supports("avx512vl") ||
+            !__builtin_cpu_supports("avx512cd")) {
+            return 3;
+        }
+        return 4;
+    }();
+    return level;
+#else
+    return 1;
+#endif
+}
+
+#ifdef CGEN_PROFILE_GENERATE
+extern "C" void __gcov_dump(void);
+extern "C" void __gcov_reset(void);
+
+/* Writes the profile recorded so far by an instrumented build and restarts it. */
+extern "C" void cgen_profile_dump(void) {
+    __gcov_dump();
+    __gcov_reset();
+}
+#endif
+
 #endif /* PSE_TYPES_H_ */
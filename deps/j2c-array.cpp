@@ -24,3 +24,4 @@ THE POSSIBILITY OF SUCH DAMAGE.
  */
 
 #include "include/j2c-array.h"
+#include "include/cgen_linalg.h"
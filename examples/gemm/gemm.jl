@@ -0,0 +1,84 @@
+#=
+Copyright (c) 2015, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+- Redistributions of source code must retain the above copyright notice, 
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice, 
+  this list of conditions and the following disclaimer in the documentation 
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+THE POSSIBILITY OF SUCH DAMAGE.
+=#
+
+using ParallelAccelerator
+using DocOpt
+
+#ParallelAccelerator.set_debug_level(3)
+#ParallelAccelerator.DomainIR.set_debug_level(3)
+#ParallelAccelerator.CGen.set_debug_level(3)
+
+@acc function matmul(A, B)
+    return A * B
+end
+
+@acc function matmul_tn(A, B)
+    return A' * B
+end
+
+function main()
+    doc = """gemm.jl
+
+Time matrix multiplication and report GFLOP/s. Without MKL or OpenBLAS this
+measures the built-in fallback GEMM.
+
+Usage:
+  gemm.jl -h | --help
+  gemm.jl [--size=<size>] [--iterations=<iterations>]
+
+Options:
+  -h --help                  Show this screen.
+  --size=<size>              Specify the order of the square matrices [default: 2048].
+  --iterations=<iterations>  Specify number of multiplications to time [default: 5].
+"""
+    arguments = docopt(doc)
+
+    n = parse(Int, arguments["--size"])
+    iterations = parse(Int, arguments["--iterations"])
+
+    println("size = ", n)
+    println("iterations = ", iterations)
+
+    tic()
+    matmul(rand(64, 64), rand(64, 64))
+    matmul_tn(rand(64, 64), rand(64, 64))
+    println("SELFPRIMED ", toq())
+
+    A = rand(n, n)
+    B = rand(n, n)
+    flops = 2.0 * n * n * n * iterations
+
+    for (name, f) in [("A*B", matmul), ("A'*B", matmul_tn)]
+        tic()
+        for i = 1:iterations
+            f(A, B)
+        end
+        time = toq()
+        println(name, " GFLOP/s = ", flops / time / 1e9)
+        println("SELFTIMED ", time)
+    end
+end
+
+main()
@@ -0,0 +1,92 @@
+#=
+Copyright (c) 2015, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+- Redistributions of source code must retain the above copyright notice, 
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice, 
+  this list of conditions and the following disclaimer in the documentation 
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+THE POSSIBILITY OF SUCH DAMAGE.
+=#
+
+using ParallelAccelerator
+using DocOpt
+
+#ParallelAccelerator.set_debug_level(3)
+#ParallelAccelerator.DomainIR.set_debug_level(3)
+#ParallelAccelerator.CGen.set_debug_level(3)
+
+@acc function sortFloats(A)
+    return sort(A)
+end
+
+@acc function sortInts(A)
+    return sort(A)
+end
+
+@acc function sortpermFloats(A)
+    return sortperm(A)
+end
+
+function timeit(name, f, A)
+    tic()
+    B = f(A)
+    time = toq()
+    println(name, " SELFTIMED ", time)
+    return B
+end
+
+function main()
+    doc = """sort.jl
+
+Compare accelerated sort and sortperm against Base.
+
+Usage:
+  sort.jl -h | --help
+  sort.jl [--size=<size>]
+
+Options:
+  -h --help      Show this screen.
+  --size=<size>  Specify number of elements to sort [default: 100000000].
+"""
+    arguments = docopt(doc)
+
+    N = parse(Int, arguments["--size"])
+
+    println("size = ", N)
+
+    tic()
+    sortFloats(rand(100))
+    sortInts(rand(Int, 100))
+    sortpermFloats(rand(100))
+    println("SELFPRIMED ", toq())
+
+    A = rand(N)
+    I = rand(Int, N)
+
+    B = timeit("sort Float64 acc", sortFloats, A)
+    C = timeit("sort Float64 Base", sort, A)
+    @assert B == C
+    B = timeit("sort Int64 acc", sortInts, I)
+    C = timeit("sort Int64 Base", sort, I)
+    @assert B == C
+    B = timeit("sortperm Float64 acc", sortpermFloats, A)
+    C = timeit("sortperm Float64 Base", sortperm, A)
+    @assert B == C
+end
+
+main()
@@ -371,6 +371,8 @@ import .API.@par
 import .API.runStencil
 import .API.cartesianarray
 import .API.parallel_for
+import .API: batched_mul, batched_det, batched_inv, batched_solve
 export accelerate, @acc, @noacc, @par, runStencil, cartesianarray, parallel_for
+export batched_mul, batched_det, batched_inv, batched_solve
 
 end
@@ -0,0 +1,85 @@
+#=
+Copyright (c) 2015, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+- Redistributions of source code must retain the above copyright notice,
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+THE POSSIBILITY OF SUCH DAMAGE.
+=#
+
+module Batched
+
+export batched_mul, batched_det, batched_inv, batched_solve
+
+# Batched small-matrix operations.  A batch of nb m x n matrices is passed as
+# an nb x m x n array (and a batch of vectors as an nb x m matrix), so that the
+# same entry of every matrix is contiguous.  Inside @acc these calls are
+# lowered to the unrolled, batch-vectorized kernels in cgen_batched.h; the
+# definitions below are the plain Julia versions.  Unlike Base.inv and Base.\,
+# the accelerated versions return Inf/NaN entries for singular matrices
+# instead of throwing.
+
+const batched_operators = Symbol[:batched_mul, :batched_det, :batched_inv, :batched_solve]
+
+# C[b,:,:] = A[b,:,:] * B[b,:,:]
+@noinline function batched_mul{T<:Union{Float32,Float64}}(A::Array{T,3}, B::Array{T,3})
+  nb, m, k = size(A)
+  (size(B, 1) == nb && size(B, 2) == k) || throw(DimensionMismatch())
+  n = size(B, 3)
+  C = zeros(T, nb, m, n)
+  for j = 1:n, p = 1:k, i = 1:m, b = 1:nb
+    C[b, i, j] += A[b, i, p] * B[b, p, j]
+  end
+  return C
+end
+
+# y[b,:] = A[b,:,:] * x[b,:]
+@noinline function batched_mul{T<:Union{Float32,Float64}}(A::Array{T,3}, x::Array{T,2})
+  nb, m, k = size(A)
+  size(x) == (nb, k) || throw(DimensionMismatch())
+  y = zeros(T, nb, m)
+  for p = 1:k, i = 1:m, b = 1:nb
+    y[b, i] += A[b, i, p] * x[b, p]
+  end
+  return y
+end
+
+@noinline function batched_det{T<:Union{Float32,Float64}}(A::Array{T,3})
+  T[ det(A[b, :, :]) for b = 1:size(A, 1) ]
+end
+
+@noinline function batched_inv{T<:Union{Float32,Float64}}(A::Array{T,3})
+  X = similar(A)
+  for b = 1:size(A, 1)
+    X[b, :, :] = inv(A[b, :, :])
+  end
+  return X
+end
+
+# X[b,:] = A[b,:,:] \ B[b,:]
+@noinline function batched_solve{T<:Union{Float32,Float64}}(A::Array{T,3}, B::Array{T,2})
+  size(B) == (size(A, 1), size(A, 2)) || throw(DimensionMismatch())
+  X = similar(B)
+  for b = 1:size(A, 1)
+    X[b, :] = A[b, :, :] \ B[b, :]
+  end
+  return X
+end
+
+end
@@ -110,6 +110,11 @@ end
 
 
 function process_operator(node::Expr, opr::Symbol)
+    if opr == :* && length(node.args) == 3 && isa(node.args[2], Expr) && node.args[2].head == Symbol("'")
+        # A'*B without materializing A'
+        node.args = Any[GlobalRef(API, :Ac_mul_B), node.args[2].args[1], node.args[3]]
+        return
+    end
     rename_opr = rename_if_needed(opr)
     api_opr = GlobalRef(API, rename_opr)
     if in(opr, operators)
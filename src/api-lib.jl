@@ -29,7 +29,7 @@ using Base
 import Base: (==), copy
 #import Base: call, (==), copy
 
-using ..cartesianmapreduce, ..cartesianarray, ..sum, ..(.*), ..map, ..map!
+using ..cartesianmapreduce, ..cartesianarray, ..sum, ..(.*), ..map, ..map!, ..pa_api_mul
 
 type MT{T}
   val :: T
@@ -204,9 +204,170 @@ end
   Base.Random.rand(args...)
 end
 
+@noinline function cumsum(args...)
+  Base.cumsum(args...)
+end
+
+@noinline function cumprod(args...)
+  Base.cumprod(args...)
+end
+
+@noinline function accumulate(args...)
+  Base.accumulate(args...)
+end
+
+@noinline function sort(args...)
+  Base.sort(args...)
+end
+
+@noinline function sort!(args...)
+  Base.sort!(args...)
+end
+
+@noinline function sortperm(args...)
+  Base.sortperm(args...)
+end
+
+@noinline function (\)(args...)
+  Base.:\(args...)
+end
+
+@noinline function (*)(args...)
+  Base.:*(args...)
+end
+
+@noinline function Ac_mul_B(args...)
+  Base.Ac_mul_B(args...)
+end
+
+@noinline function count(args...)
+  Base.count(args...)
+end
+
+@noinline function find(args...)
+  Base.find(args...)
+end
+
+@noinline function sum(args...)
+  Base.sum(args...)
+end
+
+@noinline function (&)(args...)
+  Base.:&(args...)
+end
+
+@noinline function (|)(args...)
+  Base.:|(args...)
+end
+
+@noinline function xor(args...)
+  Base.xor(args...)
+end
+
+@noinline function (~)(args...)
+  Base.:~(args...)
+end
+
 end
 import .NoInline
 
+# scans are left as calls for CGen to lower to its parallel scan kernel
+@inline function cumsum{T<:Number}(A::DenseArray{T}, dims::Int...)
+  NoInline.cumsum(A, dims...)
+end
+
+@inline function cumprod{T<:Number}(A::DenseArray{T}, dims::Int...)
+  NoInline.cumprod(A, dims...)
+end
+
+@inline function accumulate{T<:Number}(op::Function, A::DenseArray{T}, dims::Int...)
+  NoInline.accumulate(op, A, dims...)
+end
+
+@inline function cumsum(args...)
+  Base.cumsum(args...)
+end
+
+@inline function cumprod(args...)
+  Base.cumprod(args...)
+end
+
+@inline function accumulate(args...)
+  Base.accumulate(args...)
+end
+
+# sorts of numeric vectors are left as calls for CGen to lower to its parallel sort kernels
+@inline function sort{T<:Real}(A::DenseVector{T})
+  NoInline.sort(A)
+end
+
+@inline function sort!{T<:Real}(A::DenseVector{T})
+  NoInline.sort!(A)
+end
+
+@inline function sortperm{T<:Real}(A::DenseVector{T})
+  NoInline.sortperm(A)
+end
+
+@inline function sort(args...; kws...)
+  Base.sort(args...; kws...)
+end
+
+@inline function sort!(args...; kws...)
+  Base.sort!(args...; kws...)
+end
+
+@inline function sortperm(args...; kws...)
+  Base.sortperm(args...; kws...)
+end
+
+# square dense linear solves are left as calls for CGen to lower to gesv; other
+# systems keep Base's least-squares solution
+@inline function (\){T<:Union{Float32,Float64}}(A::Matrix{T}, B::VecOrMat{T})
+  size(A, 1) == size(A, 2) ? NoInline.:\(A, B) : Base.:\(A, B)
+end
+
+@inline function (\)(args...)
+  Base.:\(args...)
+end
+
+# products with the adjoint of a sparse matrix are left as calls for CGen to lower
+# to its CSC kernels; the capture pass turns A'*B into Ac_mul_B(A, B)
+@inline function Ac_mul_B{T<:Union{Float32,Float64}}(A::SparseMatrixCSC{T}, B::VecOrMat{T})
+  NoInline.Ac_mul_B(A, B)
+end
+
+# other operands keep the transpose and gemm/gemv lowering of A'*B
+@inline function Ac_mul_B(A, B)
+  pa_api_mul(Base.ctranspose(A), B)
+end
+
+# counts, finds and complements of BitArrays are left as calls for CGen to lower
+# to its word-at-a-time kernels
+@inline function count(A::BitArray)
+  NoInline.count(A)
+end
+
+@inline function find(A::BitArray)
+  NoInline.find(A)
+end
+
+@inline function (~)(A::BitArray)
+  NoInline.:~(A)
+end
+
+@inline function count(args...)
+  Base.count(args...)
+end
+
+@inline function find(args...)
+  Base.find(args...)
+end
+
+@inline function (~)(args...)
+  Base.:~(args...)
+end
+
 @inline function rand(dims::Int...)
   _pa_rand_gen_arr = Array{Float64}(dims...)
   map!(x -> NoInline.rand(Float64)::Float64, _pa_rand_gen_arr)
@@ -295,5 +456,8 @@ end
 
 export indmin, indmax, sumabs2
 export diag, diagm, trace, scale, eye, repmat, rand, randn, rand!, randn!
+export cumsum, cumprod, accumulate, sort, sort!, sortperm
+export \, Ac_mul_B
+export count, find, ~
 
 end
@@ -269,6 +269,28 @@ function nestedLoop(dim, indices, iters, body)
   mkLoop(1, body)
 end
 
+# The border region of a stencil over arrays of the given sizes, i.e., where the kernel would read out of bounds,
+# as the ranges of one box per dimension d and side.  Index d is within the band at that side, the indices after d
+# are within the inner region and the indices before d range over the whole array, so the boxes do not overlap.
+function borderIters(stat, sizeSym)
+  local n = stat.dimension
+  local boxes = Array{Expr,1}[]
+  for d = 1:n
+    if stat.shapeMin[d] < 0
+      band = :(1 : min($(-stat.shapeMin[d]), $(sizeSym[d])))
+      push!(boxes, Expr[ i < d ? :(1:$(sizeSym[i])) : i == d ? band :
+                         :((1-$(stat.shapeMin[i])) : ($(sizeSym[i]) - $(stat.shapeMax[i]))) for i = 1:n ])
+    end
+    if stat.shapeMax[d] > 0
+      # starts after the lower band, should they overlap in a small array
+      band = :((max($(sizeSym[d]) - $(stat.shapeMax[d]), $(-stat.shapeMin[d])) + 1) : $(sizeSym[d]))
+      push!(boxes, Expr[ i < d ? :(1:$(sizeSym[i])) : i == d ? band :
+                         :((1-$(stat.shapeMin[i])) : ($(sizeSym[i]) - $(stat.shapeMax[i]))) for i = 1:n ])
+    end
+  end
+  return boxes
+end
+
 # turn an array of Expr blocks into an a single block of Exprs
 function liftQuote(exprs::Array{Expr,1})
   args = vcat([ (expr.head === :block) ? expr.args : expr for expr in exprs ]...)
@@ -349,12 +371,12 @@ function translateStencil(krn, args::Array, esc)
   # border region
   local innerIterExpr = [ :((1-$(stat.shapeMin[i])) : ($(sizeSym[i]) - $(stat.shapeMax[i]))) for i = 1:stat.dimension ]
   local borderIterExpr = [ :(1:$(sizeSym[i])) for i = 1:stat.dimension ]
-  local innerCheckF(idx) = Expr(:call, GlobalRef(Base,:&), [ Expr(:call, GlobalRef(Base,:in), idx[i], innerIterExpr[i]) for i = 1:stat.dimension ]...)
   local borderCheckF(idx) = Expr(:call, GlobalRef(Base,:&), [ Expr(:call, GlobalRef(Base,:in), idx[i], borderIterExpr[i]) for i = 1:stat.dimension ]...)
   local modF(idx) = [ :((($(idx[i]) + $(sizeSym[i]) - 1) % $(sizeSym[i])) + 1) for i = 1:stat.dimension ]
   local borderKrnExpr = specializeBorder(borderSty, borderCheckF, modF, krnExpr)
-  local borderExpr = borderSty == :oob_skip ? :() : 
-                    nestedLoop(stat.dimension, idxSym, borderIterExpr, :(if $(innerCheckF(idxSym)) else $(borderKrnExpr) end))
+  # only the border region pays for the bounds handling, the inner region needs no checks
+  local borderExpr = borderSty == :oob_skip ? :() :
+                    liftQuote(Expr[ nestedLoop(stat.dimension, idxSym, iters, copy(borderKrnExpr)) for iters in borderIters(stat, sizeSym) ])
   # inner region
   local loopExpr = nestedLoop(stat.dimension, stat.idxSym, innerIterExpr, krnExpr)
   local swapExpr = (swapSym === nothing) ? :() :
@@ -427,6 +427,33 @@ end
 
 enableLib()
 
+# sparse products are left as calls for CGen to lower to its CSC kernels
+@inline function pa_api_mul{T<:Union{Float32,Float64}}(A::SparseMatrixCSC{T}, B::VecOrMat{T})
+  Lib.NoInline.:*(A, B)
+end
+
+# logical operations and sums on BitArrays are left as calls; DomainIR turns
+# them back into maps and reductions unless the operands are packed arguments,
+# which CGen lowers to its word-at-a-time kernels
+@inline function pa_api_ampersand(A::BitArray, B::BitArray)
+  Lib.NoInline.:&(A, B)
+end
+
+@inline function pa_api_pipe(A::BitArray, B::BitArray)
+  Lib.NoInline.:|(A, B)
+end
+
+@inline function pa_api_dollar(A::BitArray, B::BitArray)
+  Lib.NoInline.xor(A, B)
+end
+
+@inline function sum(A::BitArray)
+  Lib.NoInline.sum(A)
+end
+
+include("api-batched.jl")
+using .Batched
+export batched_mul, batched_det, batched_inv, batched_solve
 include("api-capture.jl")
 
 end
@@ -26,6 +26,11 @@ THE POSSIBILITY OF SUCH DAMAGE.
 
 # math functions
 libm_math_functions = Set([:sin, :cos, :tan, :asin, :acos, :acosh, :atanh, :log, :log2, :log10, :lgamma, :log1p,:asinh,:atan,:cbrt,:cosh,:erf,:exp,:expm1,:sinh,:sqrt,:tanh, :isnan])
+
+# math functions with a vectorizable version in cgen_simd_math.h, used in parfor bodies when fastmathlevel > 0
+simd_math_functions = Set([:exp, :log, :sin, :cos, :erf, :sqrt])
+simd_math_ccalls = Dict{String,String}(vcat([string(f) => "cgen_simd_$f" for f in simd_math_functions],
+                                            [string(f, "f") => "cgen_simd_$f" for f in simd_math_functions]))
 #using Debug
 
 function pattern_match_call_math(fun::Symbol, input::AbstractString, typ::Type, linfo)
@@ -34,7 +39,10 @@ function pattern_match_call_math(fun::Symbol, input::AbstractString, typ::Type,
     isFloat = typ == Float32
     isComplex = typ <: Complex
     isInt = typ <: Integer
-    if in(fun,libm_math_functions) && (isFloat || isDouble || isComplex)
+    if in(fun,simd_math_functions) && (isFloat || isDouble) && fastmathlevel > 0 && lstate.ompdepth > 0
+        @dprintln(3,"FOUND ", fun, " in parfor, using cgen_simd_math.h")
+        s = "cgen_simd_"*string(fun)*"("*input*");"
+    elseif in(fun,libm_math_functions) && (isFloat || isDouble || isComplex)
         @dprintln(3,"FOUND ", fun)
         s = string(fun)*"("*input*");"
     end
@@ -98,15 +106,30 @@ function pattern_match_call_powersq(fun::ANY, x::ANY, y::ANY,linfo)
     return ""
 end
 
+"""
+A draw from the counter-based generator in cgen_random.h.  Each call site gets its own key, which also folds in
+the linear iteration indices of the enclosing parfors but the innermost one.  The counter is the linear iteration
+index of the innermost parfor and the number of draws so far in that iteration, so results do not depend on the
+number of threads.  Draws outside of any parfor take the next stream of the thread's scope: the call, or the
+parfor iteration that called this function.
+"""
+function from_rand_draw(dist)
+    global include_rand = true
+    lstate.rand_ids += 1
+    site = lstate.rand_ids
+    if isempty(lstate.rand_index)
+        return "$dist(cgen_rand_key(cgen_rand_next_stream(), $site, 0), 0, 0)"
+    end
+    (stream, index, draws, scope) = lstate.rand_index[end]
+    outer = foldl((h, r) -> "cgen_rand_mix($h ^ $(r[2]))", "0", lstate.rand_index[1:end-1])
+    return "$dist(cgen_rand_key($stream, $site, $outer), $index, $draws++)"
+end
+
 function pattern_match_call_rand(linfo, fun, args...)
     @dprintln(3,"pattern_match_call_rand ", fun)
     res = ""
     if isBaseFunc(fun, :rand)
-        if USE_OMP==1
-            res = "cgen_distribution(cgen_rand_generator[omp_get_thread_num()]);\n"
-        else
-            res = "cgen_distribution(cgen_rand_generator);\n"
-        end
+        res = from_rand_draw("cgen_rand_uniform")
     end
     @dprintln(3,"pattern_match_call_rand res = ", res)
     return res
@@ -116,11 +139,7 @@ function pattern_match_call_randn(linfo, fun, args...)
     @dprintln(3,"pattern_match_call_randn ", fun)
     res = ""
     if isBaseFunc(fun, :randn)
-        if USE_OMP==1
-            res = "cgen_n_distribution(cgen_rand_generator[omp_get_thread_num()]);\n"
-        else
-            res = "cgen_n_distribution(cgen_rand_generator);\n"
-        end
+        res = from_rand_draw("cgen_rand_normal")
     end
     @dprintln(3,"pattern_match_call_randn res = ", res)
     return res
@@ -146,6 +165,11 @@ function pattern_match_call_reshape(fun::ANY, inp::ANY, shape::ANY,linfo)
     return ""
 end
 
+# Pointer to column (or entry) p0 of an operand with leading dimension ld.
+function panelOffset(ptr, p0, ld)
+    return p0 == "0" ? ptr : "$ptr + ($p0) * $ld"
+end
+
 function getSymType(a, linfo)
     return lstate.symboltable[lookupVariableName(a, linfo)]
 end
@@ -174,7 +198,10 @@ function pattern_match_call_gemm(fun::GlobalRef, C::RHSVar, tA::Char, tB::Char,
     else
         return ""
     end
-    s = "$(from_expr(C,linfo)); "
+    cA = from_expr(A,linfo)
+    cB = from_expr(B,linfo)
+    cC = from_expr(C,linfo)
+    s = "$cC; "
     # GEMM wants dimensions after possible transpose
     m = (tA == 'N') ? from_arraysize(A,1,linfo) : from_arraysize(A,2,linfo)
     k = (tA == 'N') ? from_arraysize(A,2,linfo) : from_arraysize(A,1,linfo)
@@ -190,17 +217,24 @@ function pattern_match_call_gemm(fun::GlobalRef, C::RHSVar, tA::Char, tB::Char,
     _tB = tB == 'N' ? CblasNoTrans : CblasTrans
     CblasColMajor = 102
 
-
+    # The product for columns p0 to p0+np-1 of C, which is all of C for p0 = 0 and np = n.
+    Bp = p0 -> panelOffset("$cB.data", p0, tB == 'N' ? ldb : "1")
+    Cp = p0 -> panelOffset("$cC.data", p0, ldc)
     if ParallelAccelerator.getMklLib()!="" || ParallelAccelerator.getOpenblasLib()!="" || ParallelAccelerator.getSysBlas()==1
-        s *= "$(cblas_fun)((CBLAS_ORDER)$(CblasColMajor),(CBLAS_TRANSPOSE)$(_tA),(CBLAS_TRANSPOSE)$(_tB),$m,$n,$k,$calpha,
-        $(from_expr(A,linfo)).data, $lda, $(from_expr(B,linfo)).data, $ldb, $cbeta, $(from_expr(C,linfo)).data, $ldc)"
+        kernel = (p0, np) -> "$(cblas_fun)((CBLAS_ORDER)$(CblasColMajor),(CBLAS_TRANSPOSE)$(_tA),(CBLAS_TRANSPOSE)$(_tB),$m,$np,$k,$calpha,
+        $cA.data, $lda, $(Bp(p0)), $ldb, $cbeta, $(Cp(p0)), $ldc)"
     else
         println("WARNING: MKL and OpenBLAS not found. Matrix multiplication might be slow.
         Please install MKL or OpenBLAS and rebuild ParallelAccelerator for better performance.")
-        s *= "cgen_$(cblas_fun)($(from_expr(tA!='N',linfo)), $(from_expr(tB!='N',linfo)), $m,$n,$k, $(from_expr(A,linfo)).data, $lda, $(from_expr(B,linfo)).data, $ldb, $(from_expr(C,linfo)).data, $ldc)"
+        kernel = (p0, np) -> "cgen_$(cblas_fun)($(from_expr(tA!='N',linfo)), $(from_expr(tB!='N',linfo)), $m,$np,$k, $calpha, $cA.data, $lda, $(Bp(p0)), $ldb, $cbeta, $(Cp(p0)), $ldc)"
+    end
+    if lstate.defer_gemm
+        # Panels of at least 64 columns keep the cost of packing A for each of them small.
+        lstate.fused_gemm[cC] = (kernel, n, m, toCtype(typ), 64)
+        return s
     end
 
-    return s
+    return s * kernel("0", n)
 end
 
 function pattern_match_call_gemm(fun::ANY, C::ANY, tA::ANY, tB::ANY, A::ANY, B::ANY,alpha::ANY,beta::ANY,linfo)
@@ -222,7 +256,9 @@ function pattern_match_call_gemv(fun::GlobalRef, y::RHSVar, tA::Char, A::RHSVar,
         return ""
     end
 
-    s = "$(from_expr(y,linfo)); "
+    cA = from_expr(A,linfo)
+    cy = from_expr(y,linfo)
+    s = "$cy; "
 
     m = from_arraysize(A,1,linfo)
     n = from_arraysize(A,2,linfo)
@@ -235,17 +271,25 @@ function pattern_match_call_gemv(fun::GlobalRef, y::RHSVar, tA::Char, A::RHSVar,
     _tA = tA == 'N' ? CblasNoTrans : CblasTrans
     CblasColMajor = 102
 
-
+    # The product for entries p0 to p0+np-1 of y, i.e., for a block of rows of op(A).
+    Ap = p0 -> panelOffset("$cA.data", p0, tA == 'N' ? "1" : lda)
+    yp = p0 -> panelOffset("$cy.data", p0, "1")
+    rows = np -> tA == 'N' ? np : m
+    cols = np -> tA == 'N' ? n : np
     if ParallelAccelerator.getMklLib()!="" || ParallelAccelerator.getOpenblasLib()!="" || ParallelAccelerator.getSysBlas()==1
-        s *= "$(cblas_fun)((CBLAS_ORDER)$(CblasColMajor),(CBLAS_TRANSPOSE)$(_tA),$m,$n, 1.0,
-        $(from_expr(A,linfo)).data, $lda, $(from_expr(x,linfo)).data, 1, 0.0, $(from_expr(y,linfo)).data, 1)"
+        kernel = (p0, np) -> "$(cblas_fun)((CBLAS_ORDER)$(CblasColMajor),(CBLAS_TRANSPOSE)$(_tA),$(rows(np)),$(cols(np)), 1.0,
+        $(Ap(p0)), $lda, $(from_expr(x,linfo)).data, 1, 0.0, $(yp(p0)), 1)"
     else
         println("WARNING: MKL and OpenBLAS not found. Matrix-vector multiplication might be slow.
         Please install MKL or OpenBLAS and rebuild ParallelAccelerator for better performance.")
-        s *= "cgen_$(cblas_fun)($(from_expr(tA!='N',linfo)), $m,$n, $(from_expr(A,linfo)).data, $lda, $(from_expr(y,linfo)).data, $(from_expr(x,linfo)).data)"
+        kernel = (p0, np) -> "cgen_$(cblas_fun)($(from_expr(tA!='N',linfo)), $(rows(np)),$(cols(np)), $(Ap(p0)), $lda, $(yp(p0)), $(from_expr(x,linfo)).data)"
+    end
+    if lstate.defer_gemm
+        lstate.fused_gemm[cy] = (kernel, tA == 'N' ? m : n, "1", toCtype(typ), 4096)
+        return s
     end
 
-    return s
+    return s * kernel("0", tA == 'N' ? m : n)
 end
 
 function pattern_match_call_gemv(fun::ANY, C::ANY, tA::ANY, A::ANY, B::ANY,linfo)
@@ -280,13 +324,11 @@ function pattern_match_call_chol(fun::GlobalRef, A::RHSVar, linfo)
     uplo = 'U' #vUL==Val{:U} ? 'U' : 'L'
 
 
-    if ParallelAccelerator.getMklLib()!="" || ParallelAccelerator.getOpenblasLib()!="" || ParallelAccelerator.getSysBlas()==1
+    if ParallelAccelerator.getMklLib()!=""
         s *= "$(lapack_fun)($(LAPACK_COL_MAJOR), '$uplo', $n, $(from_expr(A,linfo)).data, $lda)"
     else
-        println("WARNING: MKL and OpenBLAS not found. Matrix multiplication might be slow.
-        Please install MKL or OpenBLAS and rebuild ParallelAccelerator for better performance.")
-        error("MKL LAPACK required for cholesky (TODO: support other lapack libraries and include a sequential implementation)")
-        #s *= "cgen_$(cblas_fun)($(from_expr(tA!='N',linfo)), $m,$n, $(from_expr(A,linfo)).data, $lda, $(from_expr(y,linfo)).data, $(from_expr(x,linfo)).data)"
+        # blocked, multithreaded fallback in cgen_lapack.h
+        s *= "cgen_potrf<$(toCtype(typ))>($n, $(from_expr(A,linfo)).data, $lda)"
     end
 
     return s
@@ -359,13 +401,10 @@ function pattern_match_call_trtrs(fun::GlobalRef, uplo::Char, trans::Char, diag:
 
     LAPACK_COL_MAJOR = 102
 
-    if ParallelAccelerator.getMklLib()!="" || ParallelAccelerator.getOpenblasLib()!="" || ParallelAccelerator.getSysBlas()==1
+    if ParallelAccelerator.getMklLib()!=""
         s *= "$(lapack_fun)($(LAPACK_COL_MAJOR), '$uplo', '$trans', '$diag', $n, $nrhs, $(from_expr(A,linfo)).data, $lda, $(from_expr(B,linfo)).data, $ldb)"
     else
-        println("WARNING: MKL and OpenBLAS not found. Matrix multiplication might be slow.
-        Please install MKL or OpenBLAS and rebuild ParallelAccelerator for better performance.")
-        error("MKL LAPACK required for triangular solution (TODO: support other lapack libraries and include a sequential implementation)")
-        #s *= "cgen_$(cblas_fun)($(from_expr(tA!='N',linfo)), $m,$n, $(from_expr(A,linfo)).data, $lda, $(from_expr(y,linfo)).data, $(from_expr(x,linfo)).data)"
+        s *= "cgen_trtrs<$(toCtype(typ))>('$uplo', '$trans', '$diag', $n, $nrhs, $(from_expr(A,linfo)).data, $lda, $(from_expr(B,linfo)).data, $ldb)"
     end
 
     return s
@@ -388,6 +427,21 @@ function pattern_match_call_copy!(linfo, fun, A, i, B, j, n)
     end
 end
 
+# ghost plane exchange of distributed stencils, see ParallelIR.mk_stencil_distributed
+const stencil_halo_calls = Dict{Symbol,String}(
+    :stencil_halo_start => "cgen_halo_start",
+    :stencil_halo_finish => "cgen_halo_finish",
+    :stencil_halo_lower_edge => "cgen_halo_lower_edge",
+    :stencil_halo_upper_edge => "cgen_halo_upper_edge")
+
+function pattern_match_call_stencil_halo(linfo, fun, args...)
+    if isa(fun, GlobalRef) && fun.mod == ParallelAccelerator.ParallelIR && haskey(stencil_halo_calls, fun.name)
+        stencil_halo_calls[fun.name] * "(" * join([from_expr(a, linfo) for a in args], ", ") * ")"
+    else
+        ""
+    end
+end
+
 function pattern_match_call_transpose(linfo, fun::GlobalRef, fun1::GlobalRef, B::RHSVar, A::RHSVar)
     pattern_match_call_transpose(linfo, fun, B, A)
 end
@@ -418,22 +472,30 @@ function pattern_match_call_transpose(linfo, fun::GlobalRef, B::RHSVar, A::RHSVa
     lda = from_arraysize(A,1,linfo)
     ldb = from_arraysize(A,2,linfo)
 
+    # transpose!(A, A) on a square matrix is done in place
+    inplace = fun.name != :transpose && from_expr(A,linfo) == from_expr(B,linfo)
+
     if ParallelAccelerator.getMklLib()!="" && blas_fun!=""
-        s *= "mkl_$(blas_fun)('C','T',$m,$n, 1.0,
-             $(from_expr(A,linfo)).data, $lda, $(from_expr(B,linfo)).data, $ldb)"
+        if inplace
+            s *= "mkl_$(replace(blas_fun, "omat", "imat"))('C','T',$m,$n, 1.0,
+                 $(from_expr(A,linfo)).data, $lda, $ldb)"
+        else
+            s *= "mkl_$(blas_fun)('C','T',$m,$n, 1.0,
+                 $(from_expr(A,linfo)).data, $lda, $(from_expr(B,linfo)).data, $ldb)"
+        end
     elseif (ParallelAccelerator.getOpenblasLib()!="" || ParallelAccelerator.getSysBlas()==1) && blas_fun!=""
-        s *= "cblas_$(blas_fun)(CblasColMajor,CblasTrans,$m,$n, 1.0,
-             $(from_expr(A,linfo)).data, $lda, $(from_expr(B,linfo)).data, $ldb)"
+        if inplace
+            s *= "cblas_$(replace(blas_fun, "omat", "imat"))(CblasColMajor,CblasTrans,$m,$n, 1.0,
+                 $(from_expr(A,linfo)).data, $lda, $ldb)"
+        else
+            s *= "cblas_$(blas_fun)(CblasColMajor,CblasTrans,$m,$n, 1.0,
+                 $(from_expr(A,linfo)).data, $lda, $(from_expr(B,linfo)).data, $ldb)"
+        end
     else
-        #println("""WARNING: MKL and OpenBLAS not found. Matrix-vector multiplication might be slow.
-        #Please install MKL or OpenBLAS and rebuild ParallelAccelerator for better performance.""")
-        #s *= "cgen_$(blas_fun)($m,$n,
-        #     $(from_expr(A,linfo)).data, $lda, $(from_expr(B,linfo)).data, $ldb)"
-        s *= "for(int i=0; i<$m; i++) {\n"
-        s *= "    for(int j=0; j<$n; j++) {\n"
-        s *= "     $(from_expr(B,linfo)).data[j+i*$ldb] = $(from_expr(A,linfo)).data[i+j*$lda];\n"
-        s *= "    }\n"
-        s *= "}\n"
+        # blocked, parallel fallback in cgen_linalg.h; it also detects the
+        # in-place case, so any element type goes through the same kernel
+        s *= "cgen_omatcopy<$ctyp>($m,$n,
+             $(from_expr(A,linfo)).data, $lda, $(from_expr(B,linfo)).data, $ldb)"
     end
     s = (fun.name == :transpose ? (from_expr(B,linfo) * " = j2c_array<$ctyp>::new_j2c_array_2d(NULL, $n, $m);\n"): "") * s
     s = from_expr(B,linfo)*"; "*s
@@ -550,6 +612,28 @@ end
 
 pattern_match_call_set_zeros(func::ANY, arr::ANY, size, linfo) = ""
 
+function pattern_match_call_scatter_add!(linfo, func::GlobalRef, acc::RHSVar, v, idx...)
+    if func==GlobalRef(ParallelAccelerator.ParallelIR,:scatter_add!) && length(idx) > 0
+        cacc = from_expr(acc, linfo)
+        cv = from_expr(v, linfo)
+        cidx = mapfoldl(x->from_expr(x,linfo), (a, b) -> "$a, $b", idx)
+        # a raw pointer carries no shape to linearize several indices with
+        if CGEN_RAW_ARRAY_MODE && length(idx) > 1
+            throw(string("CGen Error: scatter_add! on a ", length(idx), "-dimensional array is not supported in raw array mode"))
+        end
+        elem = CGEN_RAW_ARRAY_MODE ? "$cacc[$cidx - 1]" : "$cacc.ARRAYELEM($cidx)"
+        # outside of a parallel scatter reduction the update is an ordinary increment
+        if in(cacc, lstate.scatter_vars)
+            return "j2c_scatter_add($elem, $cv, $(cacc)_scatter)"
+        else
+            return "$elem += $cv"
+        end
+    end
+    return ""
+end
+
+pattern_match_call_scatter_add!(linfo, args...) = ""
+
 function pattern_match_call(ast::Array{Any, 1},linfo)
     @dprintln(3,"pattern matching ",ast)
     s = ""
@@ -559,6 +643,7 @@ function pattern_match_call(ast::Array{Any, 1},linfo)
         s *= pattern_match_call_math(ast[1],ast[2],linfo)
         s *= pattern_match_call_linalgtypeof(ast[1],ast[2],linfo)
         s *= pattern_match_call_chol(ast[1],ast[2],linfo)
+        s *= pattern_match_call_sort!(ast[1],ast[2],linfo)
     end
 
     if s=="" && (length(ast)==3) # randn! call has 3 args
@@ -570,10 +655,14 @@ function pattern_match_call(ast::Array{Any, 1},linfo)
         s *= pattern_match_call_reduce_oprs(ast[1],ast[2],ast[3],linfo)
         s *= pattern_match_call_subarray_lastdim(ast[1],ast[2],ast[3], linfo)
     end
+    if s=="" && (length(ast)>=4) # scatter_add! has the accumulator, the value and at least one index
+        s *= pattern_match_call_scatter_add!(linfo, ast...)
+    end
     if s=="" && (length(ast)>=1) # rand can have 1 or more arg
         s *= pattern_match_call_transpose(linfo, ast...)
         s *= pattern_match_call_randn(linfo, ast...)
         s *= pattern_match_call_rand(linfo, ast...)
+        s *= pattern_match_call_stencil_halo(linfo, ast...)
     end
     # gemv calls have 5 args
     if s=="" && (length(ast)==5)
@@ -754,6 +843,333 @@ function from_assignment_match_vcat(lhs, rhs::ANY, linfo)
     return ""
 end
 
+# scan operators provided by cgen_scan.h
+scan_operators = Dict{Symbol,String}(:+ => "cgen_scan_add()", :* => "cgen_scan_mul()",
+                                     :max => "cgen_scan_max()", :min => "cgen_scan_min()")
+
+function scan_operator_name(op::GlobalRef)
+    return ParallelAccelerator.API.rename_back_if_needed(op.name)
+end
+
+function scan_operator_name(op::Function)
+    return typeof(op).name.mt.name
+end
+
+function scan_operator_name(op::ANY)
+    return nothing
+end
+
+# cumsum(A[, dim]), cumprod(A[, dim]) and accumulate(op, A[, dim]) become a parallel scan
+function from_assignment_match_scan(lhs, rhs::Expr, linfo)
+    s = ""
+    if !(isCall(rhs) || isInvoke(rhs))
+        return s
+    end
+    fun = getCallFunction(rhs)
+    args = getCallArguments(rhs)
+    if isBaseFunc(fun, :cumsum)
+        op = :+
+    elseif isBaseFunc(fun, :cumprod)
+        op = :*
+    elseif isBaseFunc(fun, :accumulate) && length(args) >= 2
+        op = scan_operator_name(args[1])
+        args = args[2:end]
+    else
+        return s
+    end
+    if !haskey(scan_operators, op) || length(args) > 2
+        return s
+    end
+    arr = args[1]
+    in_typ = getType(arr, linfo)
+    out_typ = getType(lhs, linfo)
+    if !isArrayOfPrimitiveJuliaType(in_typ) || !isArrayOfPrimitiveJuliaType(out_typ) || ndims(in_typ) > 4
+        return s
+    end
+    dim = length(args) == 2 ? args[2] : 1
+    if !isa(dim, Int) || dim < 1
+        return s
+    end
+    @dprintln(3,"Found scan assignment: ", lhs, " ", rhs)
+    num_dims = ndims(in_typ)
+    sizes = [ from_arraysize(arr, i, linfo) for i in 1:num_dims ]
+    inner = dim > 1 ? join(sizes[1:min(dim-1, num_dims)], "*") : "1"
+    len = dim <= num_dims ? sizes[dim] : "1"
+    outer = dim < num_dims ? join(sizes[dim+1:end], "*") : "1"
+    ctyp_in = toCtype(eltype(in_typ))
+    ctyp_out = toCtype(eltype(out_typ))
+    carr = from_expr(arr, linfo)
+    # scan into a fresh array first since lhs may be the input
+    s *= "{\n"
+    s *= "j2c_array<$ctyp_out> __cgen_scan_out = j2c_array<$ctyp_out>::new_j2c_array_$(num_dims)d(NULL, " * join(sizes, ", ") * ");\n"
+    s *= "cgen_scan_dim<$ctyp_in, $ctyp_out>($carr.data, __cgen_scan_out.data, $inner, $len, $outer, $(scan_operators[op]));\n"
+    s *= from_expr(lhs, linfo) * " = __cgen_scan_out;\n"
+    s *= "}\n"
+    return s
+end
+
+function from_assignment_match_scan(lhs, rhs::ANY, linfo)
+    return ""
+end
+
+function is_sortable_vector(typ)
+    return isArrayOfPrimitiveJuliaType(typ) && ndims(typ) == 1 && eltype(typ) <: Real
+end
+
+# sort(A) and sortperm(A) of numeric vectors use the parallel sorts in cgen_sort.h
+function from_assignment_match_sort(lhs, rhs::Expr, linfo)
+    s = ""
+    if !(isCall(rhs) || isInvoke(rhs))
+        return s
+    end
+    fun = getCallFunction(rhs)
+    args = getCallArguments(rhs)
+    if !(isBaseFunc(fun, :sort) || isBaseFunc(fun, :sortperm)) || length(args) != 1
+        return s
+    end
+    arr = args[1]
+    typ = getType(arr, linfo)
+    if !is_sortable_vector(typ)
+        return s
+    end
+    @dprintln(3,"Found sort assignment: ", lhs, " ", rhs)
+    ctyp = toCtype(eltype(typ))
+    carr = from_expr(arr, linfo)
+    len = from_arraysize(arr, 1, linfo)
+    s *= "{\n"
+    if isBaseFunc(fun, :sort)
+        s *= "j2c_array<$ctyp> __cgen_sort_out = j2c_array<$ctyp>::new_j2c_array_1d(NULL, $len);\n"
+        s *= "memcpy(__cgen_sort_out.data, $carr.data, sizeof($ctyp)*$len);\n"
+        s *= "cgen_sort(__cgen_sort_out.data, $len);\n"
+    else
+        s *= "j2c_array<int64_t> __cgen_sort_out = j2c_array<int64_t>::new_j2c_array_1d(NULL, $len);\n"
+        s *= "cgen_sortperm($carr.data, $len, __cgen_sort_out.data);\n"
+    end
+    s *= from_expr(lhs, linfo) * " = __cgen_sort_out;\n"
+    s *= "}\n"
+    return s
+end
+
+function from_assignment_match_sort(lhs, rhs::ANY, linfo)
+    return ""
+end
+
+function pattern_match_call_sort!(fun, arr::RHSVar, linfo)
+    if isBaseFunc(fun, :sort!) && is_sortable_vector(getType(arr, linfo))
+        carr = from_expr(arr, linfo)
+        return "(cgen_sort($carr.data, $(from_arraysize(arr, 1, linfo))), $carr)"
+    end
+    return ""
+end
+
+function pattern_match_call_sort!(fun::ANY, arr::ANY, linfo)
+    return ""
+end
+
+function from_assignment_match_ldiv(lhs, rhs::Expr, linfo)
+    s = ""
+    if !(isCall(rhs) || isInvoke(rhs))
+        return s
+    end
+    fun = getCallFunction(rhs)
+    args = getCallArguments(rhs)
+    if !isBaseFunc(fun, :\) || length(args) != 2 || !isa(args[1], RHSVar) || !isa(args[2], RHSVar)
+        return s
+    end
+    A, B = args
+    atyp = getType(A, linfo)
+    btyp = getType(B, linfo)
+    if !(atyp <: Matrix) || !(eltype(atyp) in [Float32, Float64]) || !(btyp <: VecOrMat) || eltype(btyp) != eltype(atyp)
+        return s
+    end
+    @dprintln(3,"Found linear solve assignment: ", lhs, " ", rhs)
+    ctyp = toCtype(eltype(atyp))
+    cA = from_expr(A, linfo)
+    cB = from_expr(B, linfo)
+    nrhs = ndims(btyp) == 1 ? "1" : from_arraysize(B, 2, linfo)
+    s *= "{\n"
+    s *= "int64_t __cgen_n = $(from_arraysize(A, 1, linfo));\n"
+    s *= "if (__cgen_n != $(from_arraysize(A, 2, linfo)) || __cgen_n != $(from_arraysize(B, 1, linfo))) throw(\"DimensionMismatch: only square systems are supported.\");\n"
+    s *= "j2c_array<$ctyp> __cgen_lu = j2c_array<$ctyp>::new_j2c_array_2d(NULL, __cgen_n, __cgen_n);\n"
+    s *= "memcpy(__cgen_lu.data, $cA.data, sizeof($ctyp)*__cgen_n*__cgen_n);\n"
+    if ndims(btyp) == 1
+        s *= "j2c_array<$ctyp> __cgen_x = j2c_array<$ctyp>::new_j2c_array_1d(NULL, __cgen_n);\n"
+    else
+        s *= "j2c_array<$ctyp> __cgen_x = j2c_array<$ctyp>::new_j2c_array_2d(NULL, __cgen_n, $nrhs);\n"
+    end
+    s *= "memcpy(__cgen_x.data, $cB.data, sizeof($ctyp)*__cgen_n*$nrhs);\n"
+    if ParallelAccelerator.getMklLib()!=""
+        lapack_fun = eltype(atyp) == Float32 ? "LAPACKE_sgesv" : "LAPACKE_dgesv"
+        s *= "std::vector<lapack_int> __cgen_ipiv(__cgen_n);\n"
+        s *= "int __cgen_info = $lapack_fun(102, __cgen_n, $nrhs, __cgen_lu.data, __cgen_n, __cgen_ipiv.data(), __cgen_x.data, __cgen_n);\n"
+    else
+        s *= "int __cgen_info = cgen_gesv<$ctyp>(__cgen_n, $nrhs, __cgen_lu.data, __cgen_n, __cgen_x.data, __cgen_n);\n"
+    end
+    s *= "if (__cgen_info > 0) throw(\"SingularException\");\n"
+    s *= from_expr(lhs, linfo) * " = __cgen_x;\n"
+    s *= "}\n"
+    return s
+end
+
+function from_assignment_match_ldiv(lhs, rhs::ANY, linfo)
+    return ""
+end
+
+function from_assignment_match_sparse(lhs, rhs::Expr, linfo)
+    s = ""
+    if !(isCall(rhs) || isInvoke(rhs))
+        return s
+    end
+    fun = getCallFunction(rhs)
+    args = getCallArguments(rhs)
+    if !(isBaseFunc(fun, :*) || isBaseFunc(fun, :Ac_mul_B)) || length(args) != 2 || !isa(args[1], RHSVar) || !isa(args[2], RHSVar)
+        return s
+    end
+    A, B = args
+    atyp = getType(A, linfo)
+    btyp = getType(B, linfo)
+    if !isSparseMatrixType(atyp) || !(eltype(atyp) in [Float32, Float64]) || !(btyp <: VecOrMat) || eltype(btyp) != eltype(atyp)
+        return s
+    end
+    @dprintln(3,"Found sparse product assignment: ", lhs, " ", rhs)
+    trans = isBaseFunc(fun, :Ac_mul_B)
+    ctyp = toCtype(eltype(atyp))
+    cA = from_expr(A, linfo)
+    cB = from_expr(B, linfo)
+    rows = trans ? "$cA.n" : "$cA.m"
+    inner = trans ? "$cA.m" : "$cA.n"
+    s *= "{\n"
+    s *= "if ($(from_arraysize(B, 1, linfo)) != $inner) throw(\"DimensionMismatch\");\n"
+    if ndims(btyp) == 1
+        s *= "j2c_array<$ctyp> __cgen_y = j2c_array<$ctyp>::new_j2c_array_1d(NULL, $rows);\n"
+        s *= "cgen_csc_mv($trans, $cA, $cB.data, __cgen_y.data);\n"
+    else
+        p = from_arraysize(B, 2, linfo)
+        s *= "j2c_array<$ctyp> __cgen_y = j2c_array<$ctyp>::new_j2c_array_2d(NULL, $rows, $p);\n"
+        s *= "cgen_csc_mm($trans, $cA, $p, $cB.data, $inner, __cgen_y.data, $rows);\n"
+    end
+    s *= from_expr(lhs, linfo) * " = __cgen_y;\n"
+    s *= "}\n"
+    return s
+end
+
+function from_assignment_match_sparse(lhs, rhs::ANY, linfo)
+    return ""
+end
+
+function isBitMaskType(t::ANY)
+    isPackedBitArrayType(t) || (isa(t, DataType) && t <: Array && eltype(t) === Bool)
+end
+
+const bits_operators = Dict{Symbol,String}(:count => "count", :find => "find", :~ => "not",
+                                           :& => "and", :| => "or", :xor => "xor")
+
+function from_assignment_match_bits(lhs, rhs::Expr, linfo)
+    s = ""
+    if !(isCall(rhs) || isInvoke(rhs))
+        return s
+    end
+    fun = getCallFunction(rhs)
+    args = getCallArguments(rhs)
+    if !all(a -> isa(a, RHSVar), args)
+        return s
+    end
+    typs = [getType(a, linfo) for a in args]
+    ops = filter(op -> isBaseFunc(fun, op), collect(keys(bits_operators)))
+    if isBaseFunc(fun, :getindex)
+        # masked selection A[m] of a numeric vector
+        if length(args) != 2 || !(typs[1] <: Vector) || !(eltype(typs[1]) <: Number) || !isBitMaskType(typs[2]) || ndims(typs[2]) != 1
+            return s
+        end
+        kernel = "select"
+    elseif !isempty(ops)
+        nargs = in(ops[1], [:&, :|, :xor]) ? 2 : 1
+        if length(args) != nargs || !all(isBitMaskType, typs)
+            return s
+        end
+        kernel = bits_operators[ops[1]]
+    else
+        return s
+    end
+    @dprintln(3,"Found bit array assignment: ", lhs, " ", rhs)
+    cargs = map(a -> from_expr(a, linfo), args)
+    if length(args) == 2
+        s *= "if ($(cargs[1]).ARRAYLEN() != $(cargs[2]).ARRAYLEN()) throw(\"DimensionMismatch\");\n"
+    end
+    s *= from_expr(lhs, linfo) * " = cgen_bits_$kernel(" * join(cargs, ", ") * ")"
+    return s
+end
+
+function from_assignment_match_bits(lhs, rhs::ANY, linfo)
+    return ""
+end
+
+function isBatchedFunc(fun::GlobalRef)
+    fun.mod == ParallelAccelerator.API.Batched && in(fun.name, ParallelAccelerator.API.Batched.batched_operators)
+end
+
+isBatchedFunc(fun::ANY) = false
+
+function from_assignment_match_batched(lhs, rhs::Expr, linfo)
+    s = ""
+    if !(isCall(rhs) || isInvoke(rhs))
+        return s
+    end
+    fun = getCallFunction(rhs)
+    args = getCallArguments(rhs)
+    if !isBatchedFunc(fun) || !all(a -> isa(a, RHSVar), args)
+        return s
+    end
+    A = args[1]
+    typ = getType(A, linfo)
+    if !(typ <: Array) || ndims(typ) != 3 || !(eltype(typ) in [Float32, Float64])
+        return s
+    end
+    @dprintln(3,"Found batched assignment: ", lhs, " ", rhs)
+    ctyp = toCtype(eltype(typ))
+    cA = from_expr(A, linfo) * ".data"
+    nb = from_arraysize(A, 1, linfo)
+    m = from_arraysize(A, 2, linfo)
+    k = from_arraysize(A, 3, linfo)
+    out = "__cgen_batched_out"
+    s *= "{\n"
+    if fun.name != :batched_mul
+        s *= "if ($m != $k) throw(\"DimensionMismatch: only square matrices are supported.\");\n"
+    end
+    if length(args) == 2
+        B = args[2]
+        inner = fun.name == :batched_solve ? m : k
+        s *= "if ($(from_arraysize(B, 1, linfo)) != $nb || $(from_arraysize(B, 2, linfo)) != $inner) throw(\"DimensionMismatch\");\n"
+    end
+    if fun.name == :batched_det
+        s *= "j2c_array<$ctyp> $out = j2c_array<$ctyp>::new_j2c_array_1d(NULL, $nb);\n"
+        s *= "cgen_batched_det<$ctyp>($nb, $nb, $m, $cA, $out.data);\n"
+    elseif fun.name == :batched_inv
+        s *= "j2c_array<$ctyp> $out = j2c_array<$ctyp>::new_j2c_array_3d(NULL, $nb, $m, $m);\n"
+        s *= "cgen_batched_inv<$ctyp>($nb, $nb, $m, $cA, $out.data);\n"
+    elseif fun.name == :batched_solve
+        cB = from_expr(args[2], linfo) * ".data"
+        s *= "j2c_array<$ctyp> $out = j2c_array<$ctyp>::new_j2c_array_2d(NULL, $nb, $m);\n"
+        s *= "cgen_batched_solve<$ctyp>($nb, $nb, $m, $cA, $cB, $out.data);\n"
+    elseif ndims(getType(args[2], linfo)) == 3
+        cB = from_expr(B, linfo) * ".data"
+        n = from_arraysize(B, 3, linfo)
+        s *= "j2c_array<$ctyp> $out = j2c_array<$ctyp>::new_j2c_array_3d(NULL, $nb, $m, $n);\n"
+        s *= "cgen_batched_gemm<$ctyp>($nb, $nb, $m, $n, $k, $cA, $cB, $out.data);\n"
+    else
+        cx = from_expr(args[2], linfo) * ".data"
+        s *= "j2c_array<$ctyp> $out = j2c_array<$ctyp>::new_j2c_array_2d(NULL, $nb, $m);\n"
+        s *= "cgen_batched_gemv<$ctyp>($nb, $nb, $m, $k, $cA, $cx, $out.data);\n"
+    end
+    s *= from_expr(lhs, linfo) * " = $out;\n"
+    s *= "}\n"
+    return s
+end
+
+function from_assignment_match_batched(lhs, rhs::ANY, linfo)
+    return ""
+end
+
 function from_assignment_match_iostream(lhs, rhs::GlobalRef, linfo)
     s = ""
     ltype = getType(lhs, linfo)
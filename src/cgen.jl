@@ -40,7 +40,7 @@ using Core: IntrinsicFunction
 import ..ParallelIR
 import ..ParallelIR.DelayedFunc
 import CompilerTools
-export setvectorizationlevel, from_root, writec, compile, link, set_include_blas, set_include_lapack
+export setvectorizationlevel, setfastmathlevel, setcachedir, setpgo, setisalevel, setlineinfo, setvecreport, from_root, writec, compile, link, set_include_blas, set_include_lapack
 import ParallelAccelerator, ..getPackageRoot
 import ParallelAccelerator.H5SizeArr_t
 import ParallelAccelerator.SizeArr_t
@@ -69,6 +69,19 @@ type LambdaGlobalData
     all_loop_exits::Set{Int}
     follow_set::Dict{Int,Int}
     cond_jump_targets::Set{Int}
+    scatter_vars::Set{String}           # scatter reductions of the enclosing OpenMP parfor
+    rand_index::Array{Tuple{String,String,String,String},1} # (stream, linear index, draw counter, scope marker) of each enclosing parfor
+    rand_ids::Int                       # numbers rand/randn call sites, parfor streams and rand markers
+    rand_markers::Dict{String,String}   # code of the rand markers that are kept, see resolveRandMarkers
+    defer_gemm::Bool                    # the gemm/gemv being translated is fused into the parfor that follows it
+    fused_gemm::Dict{String,Any}        # deferred gemm/gemv panel kernels, keyed by the output array
+    fused_panels::Array{Bool,1}         # whether each enclosing parfor runs inside a gemm/gemv panel loop
+    parfors::Int                        # outermost parfors translated, which decide whether to multi-version
+    line_file::String                   # Julia file of the statements being translated, for #line
+    line_files::Array{String,1}         # files of the functions that inlined code came from
+    shapes::Dict{Symbol,Array{Int,1}}   # sizes of parameter arrays that the root function is specialized for, 0 if not
+    pending_reductions::Array{Tuple{Symbol,String},1} # cross-rank reductions in flight, with the code that finishes them
+    reduction_sites::Int                # numbers the cross-rank reductions
 
     function LambdaGlobalData()
         _j = Dict(
@@ -91,7 +104,7 @@ type LambdaGlobalData
     )
 
         #new(ASTDispatcher(), [], Dict(), Dict(), [], [])
-        new([], Dict(), Dict(), [], Dict(), Dict(), [], [], _j, 0, Set{Int}(), Set{Int}(), Set{Int}(), Set{Int}(), Dict{Int,Int}(), Set{Int}())
+        new([], Dict(), Dict(), [], Dict(), Dict(), [], [], _j, 0, Set{Int}(), Set{Int}(), Set{Int}(), Set{Int}(), Dict{Int,Int}(), Set{Int}(), Set{String}(), Tuple{String,String,String,String}[], 0, Dict{String,String}(), false, Dict{String,Any}(), Bool[], 0, "", String[], Dict{Symbol,Array{Int,1}}(), Tuple{Symbol,String}[], 0)
     end
 end
 
@@ -185,6 +198,58 @@ function setvectorizationlevel(x)
     global vectorizationlevel = x
 end
 
+# Accuracy in ulps, 1 or 4, of the vectorizable functions from cgen_simd_math.h
+# that replace libm math calls in parfor bodies.  0 keeps libm.
+fastmathlevel = haskey(ENV, "CGEN_FAST_MATH") ? parse(Int, ENV["CGEN_FAST_MATH"]) : 0
+function setfastmathlevel(x)
+    global fastmathlevel = x
+end
+
+# Directory of the persistent cache of compiled generated code, which is shared
+# by sessions and processes.  Empty disables the cache.
+cache_dir = haskey(ENV, "CGEN_CACHE_DIR") ? ENV["CGEN_CACHE_DIR"] : ""
+function setcachedir(x)
+    global cache_dir = x
+end
+
+# With pgo_mode, generated code is first built with profiling instrumentation
+# and is rebuilt with the recorded profile by Driver.optimizeProfiled; g++ only.
+pgo_mode = haskey(ENV, "CGEN_PGO") && ENV["CGEN_PGO"] == "1"
+function setpgo(x)
+    global pgo_mode = x
+end
+
+# With line_info, generated functions carry #line directives that map their
+# statements and parfors back to the Julia source, for compiler messages,
+# profilers and debuggers.
+line_info = !haskey(ENV, "CGEN_LINE_INFO") || ENV["CGEN_LINE_INFO"] != "0"
+function setlineinfo(x)
+    global line_info = x
+end
+
+# With vec_report, every compile prints for each loop of the Julia source
+# whether the compiler vectorized it, and why not.
+vec_report = haskey(ENV, "CGEN_VEC_REPORT") && ENV["CGEN_VEC_REPORT"] == "1"
+function setvecreport(x)
+    global vec_report = x
+end
+
+# x86-64 micro-architecture level that the functions with parfors are compiled
+# for.  -1 compiles levels 2, 3 and 4 besides the baseline and runs the highest
+# one the CPU supports, 0 compiles the baseline only, and 2, 3 or 4 compile and
+# always run that level.  g++ on x86-64 only.
+isa_level = haskey(ENV, "CGEN_ISA") ? parse(Int, ENV["CGEN_ISA"]) : -1
+function setisalevel(x)
+    global isa_level = x
+end
+
+# g++ target attributes of the x86-64 micro-architecture levels, limited to the
+# features cgen_isa_level() checks for
+const isa_targets = Dict{Int,String}(
+    2 => "popcnt,sse4.2",
+    3 => "popcnt,avx2,fma,bmi,bmi2",
+    4 => "popcnt,avx2,fma,bmi,bmi2,avx512f,avx512bw,avx512dq,avx512vl,avx512cd")
+
 include_blas = false
 function set_include_blas(val::Bool=true)
     global include_blas = val
@@ -198,6 +263,34 @@ end
 # include random number generator?
 include_rand = false
 
+# does the last entry point compiled draw random numbers, i.e., need to be seeded from Julia before each call?
+entry_uses_rand = false
+
+# include parallel scan kernels for cumsum/cumprod/accumulate?
+include_scan = false
+
+# include parallel sort kernels for sort/sort!/sortperm?
+include_sort = false
+
+# include batched small-matrix kernels?
+include_batched = false
+
+# include sparse matrix type and kernels?
+include_sparse = false
+
+# include packed bit array type and kernels?
+include_bitarray = false
+
+# include ghost plane exchange of distributed stencils?
+include_halo = false
+
+# in distributed mode, combine the reductions of outermost parfors across the ranks?
+distributed_reductions = false
+
+function set_distributed_reductions(val::Bool=true)
+    global distributed_reductions = val
+end
+
 insertAliasCheck = true
 function set_alias_check(val)
     @dprintln(3, "set_alias_check =", val)
@@ -222,6 +315,31 @@ function resetLambdaState(l::LambdaGlobalData)
     empty!(l.all_loop_exits)
     empty!(l.follow_set)
     empty!(l.cond_jump_targets)
+    empty!(l.scatter_vars)
+    empty!(l.rand_index)
+    l.rand_ids = 0
+    empty!(l.rand_markers)
+    l.parfors = 0
+    l.line_file = ""
+    empty!(l.line_files)
+    empty!(l.shapes)
+end
+
+# A placeholder in the generated code for code that random draws need, which resolveRandMarkers
+# replaces with code once the whole compilation unit is translated.
+function randMarker(code = "")
+    lstate.rand_ids += 1
+    marker = "/*cgen_rand_$(lstate.rand_ids)*/"
+    if !isempty(code)
+        lstate.rand_markers[marker] = code
+    end
+    return marker
+end
+
+# Fills in the rand markers when some function of the unit draws random numbers, or drops them.
+function resolveRandMarkers(c)
+    drawn = contains(c, "cgen_rand_key(")
+    return replace(c, r"/\*cgen_rand_\d+\*/", m -> drawn ? get(lstate.rand_markers, String(m), "") : "")
 end
 
 
@@ -355,19 +473,21 @@ function from_includes()
             blas_include = "#include <mkl.h>\n"
         elseif ParallelAccelerator.getOpenblasLib()!="" || ParallelAccelerator.getSysBlas()==1
             blas_include = "#include <cblas.h>\n"
-        else
-            blas_include = "#include \"$packageroot/deps/include/cgen_linalg.h\"\n"
         end
+        # the transpose kernels cover element types BLAS does not
+        blas_include *= "#include \"$packageroot/deps/include/cgen_linalg.h\"\n"
     end
     if include_lapack == true
         if ParallelAccelerator.getMklLib()!=""
-            blas_include = "#include <mkl.h>\n"
+            if !contains(blas_include, "mkl.h")
+                blas_include = "#include <mkl.h>\n" * blas_include
+            end
+        else
+            # potrf, getrf/getrs and trsm fallbacks
+            blas_include *= "#include \"$packageroot/deps/include/cgen_lapack.h\"\n"
         end
     end
     s = ""
-    if include_rand==true
-        s *= "#include <random>\n"
-    end
     if isDistributedMode()
         s *= "#include <mpi.h>\n"
     end
@@ -389,19 +509,16 @@ function from_includes()
     end
     s *= reduce(*, "", (
     blas_include,
-    "#include <stdint.h>\n",
-    "#include <float.h>\n",
-    "#include <limits.h>\n",
-    "#include <complex>\n",
-    "#include <math.h>\n",
-    "#include <stdio.h>\n",
-    "#include <iostream>\n",
-    "#include \"$packageroot/deps/include/j2c-array.h\"\n",
-    "#include \"$packageroot/deps/include/pse-types.h\"\n",
-    "#include \"$packageroot/deps/include/cgen_intrinsics.h\"\n",
-    "#include <sstream>\n",
-    "#include <vector>\n",
-    "#include <string>\n")
+    "#include \"$packageroot/deps/include/cgen_runtime.h\"\n",
+    include_rand ? "#include \"$packageroot/deps/include/cgen_random.h\"\n" : "",
+    include_scan ? "#include \"$packageroot/deps/include/cgen_scan.h\"\n" : "",
+    include_sort ? "#include \"$packageroot/deps/include/cgen_sort.h\"\n" : "",
+    include_batched ? "#include \"$packageroot/deps/include/cgen_batched.h\"\n" : "",
+    include_sparse ? "#include \"$packageroot/deps/include/cgen_sparse.h\"\n" : "",
+    include_bitarray ? "#include \"$packageroot/deps/include/cgen_bitarray.h\"\n" : "",
+    include_halo ? "#include \"$packageroot/deps/include/cgen_halo.h\"\n" : "",
+    isDistributedMode() && distributed_reductions ? "#include \"$packageroot/deps/include/cgen_allreduce.h\"\n" : "",
+    fastmathlevel > 0 ? "#define CGEN_MATH_ULP $fastmathlevel\n#include \"$packageroot/deps/include/cgen_simd_math.h\"\n" : "")
     )
     for userOption in userOptions
         s *= userOption.includeStatements
@@ -553,6 +670,12 @@ function from_decl(k::DataType, linfo)
     elseif issubtype(k, AbstractString)
         # Strings are handled by a speciall class in j2c-array.h.
         return ""
+    elseif isSparseMatrixType(k) || isPackedBitArrayType(k)
+        # Sparse matrices are handled by j2c_csc in cgen_sparse.h, and bit arrays by j2c_bitarray in cgen_bitarray.h.
+        if haskey(lstate.globalUDTs, k)
+            lstate.globalUDTs[k] = 0
+        end
+        return ""
     elseif issubtype(k, Base.LibuvStream)
         # Stream type support is limited to STDOUT now
         return "typedef FILE *" * canonicalize(k.name) * ";\n"
@@ -583,6 +706,14 @@ function from_decl(k, linfo)
     return toCtype(lookupSymbolType(k, linfo)) * " " * canonicalize(k) * ";\n"
 end
 
+function isSparseMatrixType(t::ANY)
+    isa(t, DataType) && t <: SparseMatrixCSC
+end
+
+function isPackedBitArrayType(t::ANY)
+    isa(t, DataType) && t <: BitArray
+end
+
 function isCompositeType(t::Type)
     # TODO: Expand this to real UDTs
     b = (t<:Tuple) || (t === UnitRange{Int64}) || (t === StepRange{Int64, Int64})
@@ -826,7 +957,13 @@ function from_lambda(linfo :: LambdaVarInfo, body)
 
     getLoopInfo(body)
 
+    lstate.line_file = ""
+    empty!(lstate.line_files)
     bod = from_expr(body, linfo)
+    if contains(bod, "\n#line ")
+        # hand the lines after the function back to the generated file
+        bod *= "\n$line_reset\n"
+    end
     @dprintln(3,"lambda params = ", params)
     @dprintln(3,"lambda vars = ", vars)
     dumpSymbolTable(lstate.symboltable)
@@ -842,16 +979,128 @@ end
 
 function from_exprs(args::Array, linfo)
     s = ""
-    for a in args
+    fused = fusedGemmStatements(args, linfo)
+    for i in 1:length(args)
+        a = args[i]
         @dprintln(3, "from_exprs working on = ", a)
+        lstate.defer_gemm = in(i, fused)
+        s *= from_reduction_waits(args, i, linfo)
         se = from_expr(a, linfo)
+        lstate.defer_gemm = false
         if se != "nothing" # skip nothing statement
-          s *= se * (!isempty(se) ? ";\n" : "")
+          s *= se * (!isempty(se) && !isLineDirective(se) ? ";\n" : "")
         end
     end
     s
 end
 
+# Names of the arrays a gemm/gemv statement reads and writes, or nothing if "node" isn't one.
+function gemmOperands(node, linfo)
+    call = isa(node, Expr) && node.head == :(=) ? node.args[2] : node
+    if !isa(call, Expr) || !(isCall(call) || isInvoke(call))
+        return nothing
+    end
+    fun = getCallFunction(call)
+    if !isBaseFunc(fun, :gemm_wrapper!) && !isBaseFunc(fun, :gemv!)
+        return nothing
+    end
+    vars = Set{Symbol}([lookupVariableName(x, linfo) for x in getCallArguments(call) if isa(x, RHSVar)])
+    if call !== node
+        push!(vars, lookupVariableName(node.args[1], linfo))
+    end
+    return vars
+end
+
+# Name of the output array of a gemm/gemv statement.
+function gemmOutput(node, linfo)
+    call = isa(node, Expr) && node.head == :(=) ? node.args[2] : node
+    return from_expr(getCallArguments(call)[1], linfo)
+end
+
+# Whether "node" uses the data of any of the arrays "vars"; their sizes don't count.
+function referencesArrayData(node::Expr, vars, linfo)
+    args = node.args
+    if (isCall(node) || isInvoke(node)) && (isBaseFunc(getCallFunction(node), :arraysize) || isBaseFunc(getCallFunction(node), :arraylen))
+        args = getCallArguments(node)[2:end]
+    end
+    return any(x -> referencesArrayData(x, vars, linfo), args)
+end
+
+referencesArrayData(node::RHSVar, vars, linfo) = in(lookupVariableName(node, linfo), vars)
+referencesArrayData(node::ANY, vars, linfo) = false
+
+# Indices of the gemm/gemv statements whose product is computed by the following parfor, which parallel IR marked as
+# an elementwise epilogue of it.  Only the pre-statements of that parfor may come in between and they must not use the
+# data of the product's operands since the product is deferred past them.
+function fusedGemmStatements(args::Array, linfo)
+    fused = Set{Int}()
+    for i in 1:length(args)
+        a = args[i]
+        if !isa(a, Expr) || a.head != :parfor_start || a.args[1].fused_gemm == nothing
+            continue
+        end
+        vars = gemmOperands(a.args[1].fused_gemm, linfo)
+        if vars == nothing
+            continue
+        end
+        for j in i-1:-1:1
+            b = args[j]
+            if isa(b, LabelNode) || isa(b, GotoNode) || (isa(b, Expr) && in(b.head, [:gotoifnot, :return, :parfor_start, :parfor_end]))
+                break
+            elseif gemmOperands(b, linfo) == vars
+                push!(fused, j)
+                break
+            elseif referencesArrayData(b, vars, linfo)
+                break
+            end
+        end
+    end
+    return fused
+end
+
+# Whether "node" uses the variable v.
+referencesVar(node::Expr, v, linfo) = referencesVar(node.args, v, linfo)
+referencesVar(node::Array, v, linfo) = any(x -> referencesVar(x, v, linfo), node)
+referencesVar(node::RHSVar, v, linfo) = lookupVariableName(node, linfo) == v
+referencesVar(node::ParallelIR.PIRLoopNest, v, linfo) = referencesVar(Any[node.indexVariable, node.lower, node.upper, node.step], v, linfo)
+referencesVar(node::Union{ParallelIR.PIRParForAst,ParallelIR.PIRParForStartEnd}, v, linfo) =
+    referencesVar(node.loopNests, v, linfo) || any(rd -> referencesVar(rd.reductionVar, v, linfo), node.reductions)
+referencesVar(node::ANY, v, linfo) = false
+
+# Finishes the cross-rank reductions in flight that statement i of "args" uses, or all of them before control flow.
+# A parfor is checked as a whole at its parfor_start, so that no reduction is finished inside of it.
+function from_reduction_waits(args::Array, i, linfo)
+    if isempty(lstate.pending_reductions) || lstate.ompdepth > 0
+        return ""
+    end
+    a = args[i]
+    stmts = Any[a]
+    if isa(a, Expr) && a.head == :parfor_start
+        depth = 0
+        for j in i+1:length(args)
+            b = args[j]
+            if isa(b, Expr) && b.head == :parfor_end
+                depth == 0 && break
+                depth -= 1
+            elseif isa(b, Expr) && b.head == :parfor_start
+                depth += 1
+            end
+            push!(stmts, b)
+        end
+    end
+    control = isa(a, LabelNode) || isa(a, GotoNode) || (isa(a, Expr) && in(a.head, [:gotoifnot, :return, :loophead, :loopend]))
+    s = ""
+    pending = Tuple{Symbol,String}[]
+    for (v, finish) in lstate.pending_reductions
+        if control || referencesVar(stmts, v, linfo)
+            s *= finish
+        else
+            push!(pending, (v, finish))
+        end
+    end
+    lstate.pending_reductions = pending
+    return s
+end
 
 function dumpSymbolTable(a::Dict{Any, Any})
     @dprintln(3,"SymbolTable: ")
@@ -950,6 +1199,36 @@ function from_assignment(args::Array{Any,1}, linfo)
         return match_transpose
     end
 
+    match_scan = from_assignment_match_scan(lhs, rhs, linfo)
+    if match_scan!=""
+        return match_scan
+    end
+
+    match_sort = from_assignment_match_sort(lhs, rhs, linfo)
+    if match_sort!=""
+        return match_sort
+    end
+
+    match_batched = from_assignment_match_batched(lhs, rhs, linfo)
+    if match_batched!=""
+        return match_batched
+    end
+
+    match_ldiv = from_assignment_match_ldiv(lhs, rhs, linfo)
+    if match_ldiv!=""
+        return match_ldiv
+    end
+
+    match_sparse = from_assignment_match_sparse(lhs, rhs, linfo)
+    if match_sparse!=""
+        return match_sparse
+    end
+
+    match_bits = from_assignment_match_bits(lhs, rhs, linfo)
+    if match_bits!=""
+        return match_bits
+    end
+
     lhsO = from_expr(lhs, linfo)
     rhsO = from_expr(rhs, linfo)
     if lhsO == rhsO # skip x = x due to issue with j2c_array
@@ -1030,6 +1309,8 @@ end
 function toCtype(typ::DataType)
     if haskey(lstate.jtypes, typ)
         return lstate.jtypes[typ]
+    elseif isPackedBitArrayType(typ)
+        return "j2c_bitarray "
     elseif isArrayType(typ)
         atyp, dims = parseArrayType(typ)
         atyp = toCtype(atyp)
@@ -1041,6 +1322,8 @@ function toCtype(typ::DataType)
         end
     elseif isPtrType(typ)
         return "$(toCtype(eltype(typ))) *"
+    elseif isSparseMatrixType(typ)
+        return "j2c_csc< $(toCtype(typ.parameters[1])), $(toCtype(typ.parameters[2])) > "
     elseif typ == Complex64
         return "std::complex<float>"
     elseif typ == Complex128
@@ -1230,7 +1513,22 @@ function from_tuple(args, linfo)
     "{" * mapfoldl(x->from_expr(x, linfo), (a, b) -> "$a, $b", args) * "}"
 end
 
+# The size of dimension dim (the length for 0) of a parameter array, as a constant when
+# the root function is specialized for it, or nothing.
+function shapeConstant(arr, dim, linfo)
+    if isempty(lstate.shapes) || !isa(arr, RHSVar) || !isa(dim, Int)
+        return nothing
+    end
+    dims = get(lstate.shapes, lookupVariableName(arr, linfo), Int[])
+    n = dim == 0 ? (!isempty(dims) && all(d -> d > 0, dims) ? prod(dims) : 0) : (dim <= length(dims) ? dims[dim] : 0)
+    return n > 0 ? "((uint64_t)$n)" : nothing
+end
+
 function from_arraysize(args, linfo)
+    c = shapeConstant(args[1], length(args) == 1 ? 0 : args[2], linfo)
+    if c != nothing
+        return c
+    end
     s = from_expr(args[1], linfo)
     if length(args) == 1
         s *= ".ARRAYLEN()"
@@ -1284,6 +1582,9 @@ function from_foreigncall(args, linfo, call_ret_typ)
     else
         throw("Invalid ccall format...")
     end
+    if fastmathlevel > 0 && lstate.ompdepth > 0 && haskey(simd_math_ccalls, s)
+        s = simd_math_ccalls[s]
+    end
     s *= "("
 #    numInputs = length(args[3].args)-1
     argsStart = 4
@@ -1333,6 +1634,9 @@ function from_ccall(args, linfo, call_ret_typ)
     else
         throw("Invalid ccall format...")
     end
+    if fastmathlevel > 0 && lstate.ompdepth > 0 && haskey(simd_math_ccalls, s)
+        s = simd_math_ccalls[s]
+    end
     s *= "("
 #    numInputs = length(args[3].args)-1
     argsStart = 4
@@ -1710,7 +2014,7 @@ function from_intrinsic(f :: ANY, args, linfo, call_ret_typ)
     elseif intr == "sext_int"
         return "($(toCtype(args[1]))) ($(from_expr(args[2], linfo)))"
     elseif intr == "ctlz_int"
-        return " (uint64_t)(__builtin_clzll($(from_expr(args[1], linfo))))"
+        return "cgen_ctlz_int" * "(" * from_expr(args[1], linfo) * ")"
     elseif intr == "smod_int"
         m = from_expr(args[1], linfo)
         n = from_expr(args[2], linfo)
@@ -1739,7 +2043,7 @@ function from_intrinsic(f :: ANY, args, linfo, call_ret_typ)
     elseif intr == "not_int"
         return "!" * "(" * from_expr(args[1], linfo) * ")"
     elseif intr == "ctpop_int"
-        return "__builtin_popcount" * "(" * from_expr(args[1], linfo) * ")"
+        return "cgen_ctpop_int" * "(" * from_expr(args[1], linfo) * ")"
     elseif intr == "cttz_int"
         return "cgen_cttz_int" * "(" * from_expr(args[1], linfo) * ")"
     elseif intr == "ashr_int" || intr == "lshr_int"
@@ -1819,7 +2123,8 @@ function from_inlineable(f, args, linfo, call_ret_typ)
     if has(_primitive_builtins, s) || has(_builtins, s)
         return from_builtins(f, args, linfo, call_ret_typ)
     elseif isBaseFunc(f, :length) && length(args) > 0 && (isArrayType(lookupType(args[1], linfo)) || isStringType(lookupType(args[1], linfo)))
-        return "(" * from_expr(args[1], linfo) * ".ARRAYLEN())"
+        c = shapeConstant(args[1], 0, linfo)
+        return c != nothing ? c : "(" * from_expr(args[1], linfo) * ".ARRAYLEN())"
     elseif has(_Intrinsics, s)
         return from_intrinsic(f, args, linfo, call_ret_typ)
     else
@@ -1857,8 +2162,21 @@ function from_symbol(ast, linfo)
     hasfield(ast, :name) ? canonicalize(string(ast.name)) : canonicalize(ast)
 end
 
+# Placeholder that writec replaces with a #line directive naming the generated file.
+const line_reset = "#line cgen_reset"
+
+# Maps the statements that follow to a line of the current Julia file.
+function lineDirective(line)
+    if !line_info || lstate.line_file == "" || line <= 0
+        return ""
+    end
+    return "\n#line $line \"$(escape_string(lstate.line_file))\"\n"
+end
+
+isLineDirective(s) = startswith(s, "\n#line ")
+
 function from_linenumbernode(ast, linfo)
-    ""
+    lineDirective(ast.line)
 end
 
 function from_labelnode(ast, linfo)
@@ -2143,6 +2461,12 @@ function from_call(ast::Array{Any, 1},linfo, call_ret_typ)
         #end
     end
     s = funStr * "(" * s * ")"
+    # the callee may draw random numbers, keyed by the iteration of the innermost enclosing parfor
+    if !isempty(lstate.rand_index)
+        (stream, index, draws, scope) = lstate.rand_index[end]
+        outer = foldl((h, r) -> "cgen_rand_mix($h ^ $(r[2]))", "0", lstate.rand_index)
+        lstate.rand_markers[scope] = "cgen_rand_scope cgen_rand_iteration(cgen_rand_key($stream, 0, $outer));\n"
+    end
 
     # If we have previously compiled this function
     # we fallthru and simply emit the call.
@@ -2315,6 +2639,21 @@ function from_quotenode(ast,linfo)
 end
 
 function from_line(args,linfo)
+    if length(args) > 1 && isa(args[2], Symbol)
+        lstate.line_file = string(args[2])
+    end
+    lineDirective(args[1])
+end
+
+# Code inlined from other functions is enclosed in push_loc and pop_loc, with
+# its lines in the file of the function it came from.
+function from_meta(args, linfo)
+    if length(args) > 1 && args[1] == :push_loc && isa(args[2], Symbol)
+        push!(lstate.line_files, lstate.line_file)
+        lstate.line_file = string(args[2])
+    elseif length(args) > 0 && args[1] == :pop_loc && !isempty(lstate.line_files)
+        lstate.line_file = pop!(lstate.line_files)
+    end
     ""
 end
 
@@ -2332,8 +2671,12 @@ function from_parforend(args,linfo)
     if parallel_reduction && length(rds) > 0
         @dprintln(3,"from_parforend: parallel_reduction")
         nthreadsvar = "_num_threads"
-        rdsepilog = "for (unsigned i = 0; i < $nthreadsvar; i++) {\n"
-        rdscleanup = ""
+        # Combine the per-thread slots pairwise in log2(nthreads) rounds, then fold slot 0 into the
+        # reduction variable.  Each round is a parallel loop when some reduction is array-valued or
+        # there are enough threads for it to pay off.
+        rdstree = rdsfinal = ""
+        rdsprivates = Set{String}()
+        tree_in_par = false
         for rd in rds
             rdv = rd.reductionVar
             rdvt = getSymType(rdv, linfo)
@@ -2343,23 +2686,49 @@ function from_parforend(args,linfo)
             @dprintln(3,"from_parforend: rdvar = ", rdvar)
             # this is now handled either in pre_statements, or by user (in the case of explicit parfor loop).
             #rdsinit *= from_reductionVarInit(rd.reductionVarInit, rdv,linfo)
+            rdvar_a = addLocalVariable(gensym(string(rdvar, "_a")), rdvt, 0, linfo)
+            setSymbolType(rdvar_a, rdvt, linfo)
             rdvar_i = addLocalVariable(gensym(string(rdvar, "_i")), rdvt, 0, linfo)
             setSymbolType(rdvar_i, rdvt, linfo)
-            @dprintln(3,"from_parforend: rdvar_i = ", rdvar_i)
-            rdsepilog *= "$rdvtyp &" * from_expr(rdvar_i, linfo) * " = $(rdvar)_vec[i];\n"
-            @dprintln(3,"from_parforend: rdsepilog = ", rdsepilog);
-            rdsepilog *= from_reductionFunc(rd.reductionFunc, rdv, rdvar_i,linfo) * ";\n"
-            @dprintln(3,"from_parforend: after reductionFunc rdsepilog = ", rdsepilog);
-            if isPrimitiveJuliaType(rdvt)
-                rdscleanup *= "free($(rdvar)_vec);\n";
+            @dprintln(3,"from_parforend: rdvar_a = ", rdvar_a, " rdvar_i = ", rdvar_i)
+            # Scatter reductions only have per-thread slots to combine when they were privatized.
+            scatter = in(rdvar, lstate.scatter_vars)
+            rdsguard = scatter ? "if ($(rdvar)_scatter == J2C_SCATTER_PRIVATE) {\n" : "{\n"
+            rdstree *= rdsguard
+            rdstree *= "$rdvtyp &" * from_expr(rdvar_a, linfo) * " = $(rdvar)_vec[i];\n"
+            rdstree *= "$rdvtyp &" * from_expr(rdvar_i, linfo) * " = $(rdvar)_vec[i + rds_stride];\n"
+            rdstree *= from_reductionFunc(rd.reductionFunc, rdvar_a, rdvar_i, linfo) * ";\n}\n"
+            union!(rdsprivates, reductionFuncPrivates(rd.reductionFunc, rdvar_a, rdvar_i, linfo))
+            tree_in_par = tree_in_par || !isPrimitiveJuliaType(rdvt)
+            rdsfinal *= rdsguard
+            rdsfinal *= "$rdvtyp &" * from_expr(rdvar_i, linfo) * " = $(rdvar)_vec[0];\n"
+            rdsfinal *= from_reductionFunc(rd.reductionFunc, rdv, rdvar_i, linfo) * ";\n}\n"
+            @dprintln(3,"from_parforend: after reductionFunc rdstree = ", rdstree, " rdsfinal = ", rdsfinal)
+            if !scatter
+                rdscopy *= "shared_$(rdvar) = $(rdvar);\n"
             end
-            rdscopy *= "shared_$(rdvar) = $(rdvar);\n"
         end
-        rdsepilog *= "}\n" * rdscleanup
-
+        ifclause = tree_in_par ? "" : "if($nthreadsvar >= J2C_REDUCTION_TREE_MIN_THREADS) "
+        privateclause = isempty(rdsprivates) ? "" : "private(" * join(sort(collect(rdsprivates)), ", ") * ")"
+        rdsepilog = "for (unsigned rds_stride = 1; rds_stride < $nthreadsvar; rds_stride *= 2) {\n"
+        rdsepilog *= "#pragma omp parallel for $ifclause$privateclause\n"
+        rdsepilog *= "for (unsigned i = 0; i < $nthreadsvar - rds_stride; i += 2 * rds_stride) {\n"
+        rdsepilog *= rdstree * "}\n}\n"
+        rdsepilog *= rdsfinal
+        empty!(lstate.scatter_vars)
     end
     s *= USE_OMP==1 && lstate.ompdepth <=1 ? "$rdscopy }\n$rdsinit $rdsepilog }/*parforend*/\n" : "" # end block introduced by private list
     @dprintln(3,"Parforend = ", s)
+    # close the panel loop of a fused gemm/gemv
+    if pop!(lstate.fused_panels)
+        s *= "}\n}\n"
+    end
+    if isDistributedMode() && distributed_reductions && lstate.ompdepth == 1
+        for rd in rds
+            s *= from_reduction_start(rd, linfo)
+        end
+    end
+    pop!(lstate.rand_index)
     lstate.ompdepth -= 1
     s
 end
@@ -2413,6 +2782,41 @@ function from_reductionFunc(reductionFunc :: Any, a, b, linfo)
     throw(string("CGen Error: Unsupported redunction function: ", reductionFunc, " :: ", typeof(reductionFunc)))
 end
 
+"""
+Names of the variables a reduction function assigns to, other than its two operands.  These
+must be private when the per-thread partial results are combined in parallel.
+"""
+function reductionFuncPrivates(reductionFunc :: ParallelIR.DelayedFunc, a, b, linfo)
+    privates = Set{String}()
+    collectAssignedVars(ParallelIR.callDelayedFuncWith(reductionFunc, a, b), privates, linfo)
+    setdiff!(privates, [from_expr(a, linfo), from_expr(b, linfo)])
+    return privates
+end
+
+function reductionFuncPrivates(reductionFunc :: Any, a, b, linfo)
+    return Set{String}()
+end
+
+function collectAssignedVars(x :: Expr, privates :: Set{String}, linfo)
+    if x.head == :(=)
+        push!(privates, from_expr(x.args[1], linfo))
+    elseif x.head == :parfor_start
+        for ln in x.args[1].loopNests
+            push!(privates, from_expr(ln.indexVariable, linfo))
+        end
+    end
+    collectAssignedVars(x.args, privates, linfo)
+end
+
+function collectAssignedVars(x :: Array, privates :: Set{String}, linfo)
+    for a in x
+        collectAssignedVars(a, privates, linfo)
+    end
+end
+
+function collectAssignedVars(x :: ANY, privates :: Set{String}, linfo)
+end
+
 # If the parfor body is too complicated then DomainIR or ParallelIR will set
 # instruction_count_expr = nothing
 
@@ -2421,6 +2825,82 @@ end
 # mode = 2 does all of the above
 # mode = 3 in addition to 2, also uses host minimum (0) and Phi minimum (10)
 
+# Name of the function that a reduction function applies to its two operands, or nothing if it is not a single call.
+function reduction_op_name(reductionFunc::DelayedFunc)
+    stmts = reductionFunc.args[1]
+    if length(stmts) != 1 || !isa(stmts[1], Expr) || stmts[1].head != :(=) || !isa(stmts[1].args[2], Expr)
+        return nothing
+    end
+    call = stmts[1].args[2]
+    if call.head == :call && call.args[1] == GlobalRef(Core.Intrinsics, :box)
+        call = call.args[3]
+    end
+    if !isa(call, Expr) || call.head != :call || !isa(call.args[1], GlobalRef)
+        return nothing
+    end
+    return call.args[1].name
+end
+
+reduction_op_name(reductionFunc::GlobalRef) = reductionFunc.name
+reduction_op_name(reductionFunc::ANY) = nothing
+
+# The predefined MPI operator of a reduction of scalars of type typ with reductionFunc, or "".  Floating-point
+# maxima and minima are left to the generated code, which handles NaNs as Julia does.
+function mpi_reduce_op(reductionFunc, typ)
+    if !in(typ, [Float32, Float64, Int8, Int16, Int32, Int64, UInt8, UInt16, UInt32, UInt64])
+        return ""
+    end
+    name = reduction_op_name(reductionFunc)
+    if in(name, [:+, :add_float, :add_int])
+        return "MPI_SUM"
+    elseif in(name, [:*, :mul_float, :mul_int])
+        return "MPI_PROD"
+    elseif name == :max && typ <: Integer
+        return "MPI_MAX"
+    elseif name == :min && typ <: Integer
+        return "MPI_MIN"
+    end
+    return ""
+end
+
+"""
+Starts combining the reduction variable of an outermost parfor with its values on the other ranks, and records
+the code that finishes it for from_reduction_waits.  Predefined operators on scalars use MPI_Iallreduce.  Other
+reductions gather the values of all ranks and fold them in rank order with the reduction function; array
+reductions are finished where they start.
+"""
+function from_reduction_start(rd, linfo)
+    rdv = rd.reductionVar
+    rdvt = getSymType(rdv, linfo)
+    rdvtyp = toCtype(rdvt)
+    rdvar = from_expr(rdv, linfo)
+    if !isbits(rdvt) && !isArrayOfPrimitiveJuliaType(rdvt)
+        throw(string("CGen Error: cannot combine a reduction of type ", rdvt, " across ranks"))
+    end
+    lstate.reduction_sites += 1
+    site = lstate.reduction_sites
+    op = isbits(rdvt) ? mpi_reduce_op(rd.reductionFunc, rdvt) : ""
+    if op != ""
+        push!(lstate.pending_reductions, (lookupVariableName(rdv, linfo), "cgen_reduction_wait($site);\n"))
+        return "cgen_allreduce_start($site, $rdvar, $op);\n"
+    end
+    rdvar_r = addLocalVariable(gensym(string(rdvar, "_r")), rdvt, 0, linfo)
+    setSymbolType(rdvar_r, rdvt, linfo)
+    rdr = from_expr(rdvar_r, linfo)
+    finish = "{\ncgen_reduction_wait($site);\n$rdvtyp $rdr;\n"
+    finish *= "cgen_reduction_part($site, 0, $rdvar, $rdvar);\n"
+    finish *= "for (int rds_rank = 1; rds_rank < cgen_reduction_ranks(); rds_rank++) {\n"
+    finish *= "cgen_reduction_part($site, rds_rank, $rdr, $rdvar);\n"
+    finish *= from_reductionFunc(rd.reductionFunc, rdv, rdvar_r, linfo) * ";\n}\n}\n"
+    # an alias of an array, or a call taking it, can touch the buffer the gather still owns
+    # without naming the variable, so array reductions finish right away
+    if !isbits(rdvt)
+        return "cgen_allgather_start($site, $rdvar);\n" * finish
+    end
+    push!(lstate.pending_reductions, (lookupVariableName(rdv, linfo), finish))
+    return "cgen_allgather_start($site, $rdvar);\n"
+end
+
 function pattern_match_reduce_sum(reductionFunc::DelayedFunc,linfo)
     reduce_box = reductionFunc.args[1][1].args[2]
     if reduce_box.args[1]==GlobalRef(Core.Intrinsics,:box)
@@ -2476,10 +2956,33 @@ function from_parforstart(args, linfo)
     @dprintln(3,"stops ", stops);
     @dprintln(3,"steps ", steps);
 
-    # Generate the actual loop nest
-    loopheaders = from_loopnest(ivs, starts, stops, steps, linfo)
-
+    # A gemm/gemv that from_exprs deferred because this parfor is its epilogue is computed here.  An outermost OpenMP
+    # parfor alternates between the product of a panel of the output and the part of its outermost loop covering that
+    # panel, so the map reads the panel while it is still in cache.  Otherwise the whole product comes first.
     s = ""
+    loop_starts = starts
+    loop_stops = stops
+    fused_panel = false
+    gemm_kernel = parfor.fused_gemm == nothing ? nothing : pop!(lstate.fused_gemm, gemmOutput(parfor.fused_gemm, linfo), nothing)
+    if gemm_kernel != nothing
+        kernel, panel_n, panel_rows, panel_typ, panel_min = gemm_kernel
+        if USE_OMP==1 && lstate.ompdepth == 0 && !isDistributedMode() && lpNests[1].step == 1
+            fused_panel = true
+            s *= "{\nint64_t cgen_panel_n = $panel_n;\n"
+            s *= "int64_t cgen_panel_w = cgen_fused_panel_width($panel_rows, sizeof($panel_typ), $panel_min);\n"
+            s *= "for (int64_t cgen_panel_0 = 0; cgen_panel_0 < cgen_panel_n; cgen_panel_0 += cgen_panel_w) {\n"
+            s *= "int64_t cgen_panel_k = std::min(cgen_panel_w, cgen_panel_n - cgen_panel_0);\n"
+            s *= kernel("cgen_panel_0", "cgen_panel_k") * ";\n"
+            loop_starts = ["std::max<int64_t>($(starts[1]), cgen_panel_0 + 1)"; starts[2:end]]
+            loop_stops = ["std::min<int64_t>($(stops[1]), cgen_panel_0 + cgen_panel_k)"; stops[2:end]]
+        else
+            s *= kernel("0", panel_n) * ";\n"
+        end
+    end
+    push!(lstate.fused_panels, fused_panel)
+
+    # Generate the actual loop nest
+    loopheaders = from_loopnest(ivs, loop_starts, loop_stops, steps, linfo)
 
     # thread count related stuff
     lcountexpr = ""
@@ -2524,7 +3027,31 @@ function from_parforstart(args, linfo)
     # non-symbol reductionFunc is not supported by OpenMP
     rdsextra = rdsprolog = rdsclause = ""
     @dprintln(3,"reductions = ", rds);
+    lstate.parfors += lstate.ompdepth == 0 ? 1 : 0
     lstate.ompdepth += 1
+    # rand/randn in the body are keyed by the iteration they run in rather than by the thread, so an outermost
+    # parfor starts a new stream, the indices of enclosing parfors go into the key and every iteration counts
+    # its draws, which makes draws in a sequential loop in the body differ.  An iteration that calls a
+    # generated function also opens a scope keyed by it for the draws of the callee.  Whether any of this is
+    # needed is only known once the callees are translated, so it is left as markers.
+    randprolog = ""
+    linear_index = "(uint64_t)(($(ivs[1]) - ($(starts[1]))) / ($(steps[1])))"
+    for i in 2:length(lpNests)
+        linear_index = "($linear_index * (uint64_t)((($(stops[i])) - ($(starts[i]))) / ($(steps[i])) + 1) + (uint64_t)(($(ivs[i]) - ($(starts[i]))) / ($(steps[i]))))"
+    end
+    if isempty(lstate.rand_index)
+        lstate.rand_ids += 1
+        rand_stream = "cgen_rand_stream_$(lstate.rand_ids)"
+        randprolog = randMarker("uint64_t $rand_stream = cgen_rand_next_stream();\n")
+    else
+        rand_stream = lstate.rand_index[end][1]
+    end
+    lstate.rand_ids += 1
+    rand_draws = "cgen_rand_draws_$(lstate.rand_ids)"
+    loopheaders *= randMarker("uint64_t $rand_draws = 0; (void)$rand_draws;\n")
+    rand_scope = randMarker()
+    loopheaders *= rand_scope
+    push!(lstate.rand_index, (rand_stream, linear_index, rand_draws, rand_scope))
     # custom reduction only kicks in when omp parallel is produced, i.e., when ompdepth == 1
     parallel_reduction = USE_OMP==1 && lstate.ompdepth == 1 #&& any(Bool[(isa(a->reductionFunc, Function) || isa(a->reductionVarInit, Function)) for a in rds])
     for rd in rds
@@ -2537,17 +3064,38 @@ function from_parforstart(args, linfo)
         setSymbolType(advout, rdvt, linfo)
         rdvar_tmp = from_symbol(rdv_tmp, linfo)
         if parallel_reduction
-            if isPrimitiveJuliaType(rdvt)
-                rdsprolog *= "$rdvtyp *$(rdvar)_vec = ($rdvtyp *)malloc(sizeof($rdvtyp)*$nthreadsvar);\n"
+            # Cache-line padded slots, kept per parfor site and calling thread so they are reused across calls.
+            rdsprolog *= "static thread_local j2c_reduction_slots<$rdvtyp> $(rdvar)_slots;\n"
+            rdsprolog *= "j2c_reduction_slots<$rdvtyp> &$(rdvar)_vec = $(rdvar)_slots;\n"
+            rdsprolog *= "$(rdvar)_vec.reserve($nthreadsvar);\n"
+            rdslot = "$(rdvar)_vec[omp_get_thread_num()]"
+            if rd.scatter && isArrayOfPrimitiveJuliaType(rdvt)
+                # Small targets get a zeroed copy per thread, large ones are updated in place with atomics.
+                push!(lstate.scatter_vars, rdvar)
+                rdsprolog *= "j2c_scatter_mode $(rdvar)_scatter = j2c_scatter_choose($rdvar, $nthreadsvar);\n"
+                rdsprolog *= "if ($(rdvar)_scatter == J2C_SCATTER_PRIVATE) {\n"
+                rdsprolog *= "for (int rds_init_loop_var = 0; rds_init_loop_var  < $nthreadsvar; rds_init_loop_var++) {\n"
+                rdsprolog *= "j2c_scatter_zero($(rdvar)_vec[rds_init_loop_var], $rdvar);\n}\n}\n"
+                rdslot = "$(rdvar)_scatter == J2C_SCATTER_PRIVATE ? $rdslot : $rdvar"
+            elseif isArrayOfPrimitiveJuliaType(rdvt)
+                # Build the neutral array once and copy it into the per-thread arrays left over from the last call.
+                rdsprolog *= from_reductionVarInit(rd.reductionVarInit, rdv_tmp, linfo)
+                rdsprolog *= "for (int rds_init_loop_var = 0; rds_init_loop_var  < $nthreadsvar; rds_init_loop_var++) {\n"
+                rdsprolog *= "j2c_reduction_reset($(rdvar)_vec[rds_init_loop_var], $rdvar_tmp);\n}\n"
             else
-                rdsprolog *= "std::vector<$rdvtyp> $(rdvar)_vec($nthreadsvar);\n"
+                rdsprolog *= "for (int rds_init_loop_var = 0; rds_init_loop_var  < $nthreadsvar; rds_init_loop_var++) {\n"
+                rdsprolog *= "$rdvtyp &$rdvar_tmp = $(rdvar)_vec[rds_init_loop_var];\n"
+                rdsprolog *= from_reductionVarInit(rd.reductionVarInit, rdv_tmp, linfo) * "}\n"
             end
-            rdsprolog *= "for (int rds_init_loop_var = 0; rds_init_loop_var  < $nthreadsvar; rds_init_loop_var++) {\n"
-            rdsprolog *= "$rdvtyp &$rdvar_tmp = $(rdvar)_vec[rds_init_loop_var];\n"
-            rdsprolog *= from_reductionVarInit(rd.reductionVarInit, rdv_tmp, linfo) * "}\n"
             #push!(private_vars, rdv)
-            rdsextra *= "$rdvtyp &shared_$(rdvar) = $(rdvar)_vec[omp_get_thread_num()];\n"
-            rdsextra *= "$rdvtyp $(rdvar) = shared_$(rdvar);\n"
+            rdsextra *= "$rdvtyp &shared_$(rdvar) = $rdslot;\n"
+            if in(rdvar, lstate.scatter_vars)
+                # every thread updates its slot or the shared array itself; a copy and copy back
+                # of the shared array would race on its fields
+                rdsextra *= "$rdvtyp &$(rdvar) = shared_$(rdvar);\n"
+            else
+                rdsextra *= "$rdvtyp $(rdvar) = shared_$(rdvar);\n"
+            end
         else
             if isDistributedMode() && lstate.ompdepth == 1
                 if pattern_match_reduce_sum(rd.reductionFunc, linfo) && !isArrayType(rdvt)
@@ -2567,7 +3115,7 @@ function from_parforstart(args, linfo)
     @dprintln(3, "rdsclause = ", rdsclause)
 
     if isDistributedMode() && lstate.ompdepth == 1 && parfor.force_simd
-        s *= "$rdsprolog #pragma simd $rdsclause\n"
+        s *= "$randprolog $rdsprolog #pragma simd $rdsclause\n"
         s *= loopheaders
         return s
     end
@@ -2575,7 +3123,7 @@ function from_parforstart(args, linfo)
     # Don't put openmp pragmas on nested parfors.
     if USE_OMP==0 || lstate.ompdepth > 1
         # Still need to prepend reduction variable initialization for non-openmp loops.
-        return rdsprolog * loopheaders
+        return s * randprolog * rdsprolog * loopheaders
     end
     private_vars = [ lookupVariableName(x, linfo) for x in private_vars ]
     # Check if there are private vars and emit the |private| clause
@@ -2585,7 +3133,7 @@ function from_parforstart(args, linfo)
     @dprintln(3,"-----")
     privatevars = isempty(private_vars) ? "" : "private(" * mapfoldl(canonicalize, (a,b) -> "$a, $b", private_vars) * ")"
 
-    s *= "{\n$preclause $rdsprolog #pragma omp parallel $nthreadsclause $privatevars\n{\n$rdsextra"
+    s *= "{\n$preclause $randprolog $rdsprolog #pragma omp parallel $nthreadsclause $privatevars\n{\n$rdsextra"
     s *= "#pragma omp for private(" * mapfoldl((a)->a, (a, b)->"$a, $b", ivs) * ") $rdsclause\n"
     s *= loopheaders
     s
@@ -2733,17 +3281,6 @@ function from_expr(ast::Expr, linfo)
 
     elseif head == :body
         @dprintln(3,"Compiling body")
-        if include_rand && (contains(string(ast),"rand") || contains(string(ast),"randn"))
-            s *= "std::random_device cgen_rand_device;\n"
-            s *= "std::uniform_real_distribution<double> cgen_distribution(0.0,1.0);\n"
-            s *= "std::normal_distribution<double> cgen_n_distribution(0.0,1.0);\n"
-            if USE_OMP==1
-                s *= "std::vector<std::default_random_engine> cgen_rand_generator;\n"
-                s *= "for(int i=0; i<omp_get_max_threads(); i++) { cgen_rand_generator.push_back(std::default_random_engine(cgen_rand_device()));}\n"
-            else
-                s *= "std::default_random_engine cgen_rand_generator(cgen_rand_device());\n"
-            end
-        end
         s *= from_exprs(args, linfo)
 
     elseif head == :new
@@ -2813,9 +3350,9 @@ function from_expr(ast::Expr, linfo)
     elseif head == :simdloop
         # Nothing
 
-    # For now, we ignore meta nodes.
+    # Meta nodes only matter for the locations of inlined code.
     elseif head == :meta
-        # Nothing
+        s *= from_meta(args, linfo)
 
     elseif head == :loophead
         s *= from_loophead(args, linfo)
@@ -3026,7 +3563,7 @@ function from_formalargs(params, vararglist, unaliased, linfo)
             typ = lookupSymbolType(params[p], linfo)
             ptyp = toCtype(typ)
             push!(argtypes, ptyp)
-            is_array = isArrayType(typ) || isStringType(typ)
+            is_array = isArrayType(typ) || isStringType(typ) || isSparseMatrixType(typ)
             s *= ptyp * ((is_array && !CGEN_RAW_ARRAY_MODE ? "&" : "")
                 * (is_array ? " $ql " : " ")
                 * canonicalize(params[p]))
@@ -3077,9 +3614,37 @@ function setRecreateConds(val)
     global recreateConds = val
 end
 
+"""
+Returns the x86-64 levels, highest first, that a root function with parfors is
+compiled for according to isa_level.  Fast math already compiles for the host
+CPU, and other compilers and targets only get the baseline.
+"""
+function getIsaLevels()
+    if isa_level == 0 || isa_level == 1 || fastmathlevel > 0 || Sys.ARCH != :x86_64 ||
+       ParallelAccelerator.getBackendCompiler() != ParallelAccelerator.USE_GCC ||
+       ParallelAccelerator.getPseMode() == ParallelAccelerator.OFFLOAD1_MODE ||
+       ParallelAccelerator.getPseMode() == ParallelAccelerator.OFFLOAD2_MODE
+        return Int[]
+    end
+    return isa_level < 0 ? [4, 3, 2] : [isa_level]
+end
+
+# Calls the version of name for the highest of levels that the CPU supports,
+# or the baseline name when it supports none of them.
+function isaDispatch(name, actualParams, levels)
+    if isempty(levels)
+        return "$name($actualParams);"
+    end
+    s = "switch (cgen_isa_level()) {\n"
+    for level in levels
+        s *= "case $level: $(name)_v$level($actualParams); break;\n"
+    end
+    s * "default: $name($actualParams);\n}\n"
+end
+
 # Creates an entrypoint that dispatches onto host or MIC.
 # For now, emit host path only
-function createEntryPointWrapper(functionName, params, args, jtyp, argtypes, alias_check = nothing)
+function createEntryPointWrapper(functionName, params, args, jtyp, argtypes, alias_check = nothing, isa_levels = Int[])
     @dprintln(3,"createEntryPointWrapper params = ", params, ", args = (", args, ") jtyp = ", jtyp, " argtypes = ", argtypes)
     assert(length(params) == length(argtypes))
     if length(params) > 0
@@ -3179,8 +3744,12 @@ function createEntryPointWrapper(functionName, params, args, jtyp, argtypes, ali
        genMain *= "}\n"
     end
 
+    # If we are forcing vectorization then we will not emit the alias check
+    emitaliascheck = (vectorizationlevel == VECDEFAULT ? true : false)
     unaliased_func = functionName * "_unaliased"
-    unaliased_func_call = "$unaliased_func($actualParams);"
+    unaliased_func_call = isaDispatch(unaliased_func, actualParams, isa_levels)
+    # Behind an alias check only the unaliased version has a copy per level.
+    func_call = isaDispatch(functionName, actualParams, emitaliascheck && alias_check != nothing ? Int[] : isa_levels)
 
     # OMP offload only works for unaliased calls
     if ParallelAccelerator.getPseMode() == ParallelAccelerator.OFFLOAD1_MODE ||
@@ -3259,8 +3828,6 @@ function createEntryPointWrapper(functionName, params, args, jtyp, argtypes, ali
          }"
     end
 
-    # If we are forcing vectorization then we will not emit the alias check
-    emitaliascheck = (vectorizationlevel == VECDEFAULT ? true : false)
     s = ""
     if emitaliascheck && alias_check != nothing
         assert(isa(alias_check, AbstractString))
@@ -3270,7 +3837,7 @@ function createEntryPointWrapper(functionName, params, args, jtyp, argtypes, ali
             $genMain
             $allocResult
             if ($alias_check) {
-                $functionName($actualParams);
+                $func_call
             } else {
                 $unaliased_func_call
             }
@@ -3280,7 +3847,7 @@ function createEntryPointWrapper(functionName, params, args, jtyp, argtypes, ali
     "extern \"C\" void _$(functionName)_($wrapperParams $retSlot $genMainParam) {\n
         $genMain
         $allocResult
-        $functionName($actualParams);
+        $func_call
     }\n"
     end
     s
@@ -3291,12 +3858,30 @@ function set_includes(ast)
     if contains(s,"gemm_wrapper!") || contains(s,"gemv!") || contains(s,"transpose!") || contains(s,"vecnorm") || contains(s,"transpose")
         set_include_blas(true)
     end
-    if contains(s,"LinAlg.chol") ||  contains(s,"LAPACK")
+    if contains(s,"LinAlg.chol") ||  contains(s,"LAPACK") || contains(s,".:\\")
         set_include_lapack(true)
     end
     if contains(s,"rand") || contains(s,"randn")
         global include_rand = true
     end
+    if contains(s,"cumsum") || contains(s,"cumprod") || contains(s,"accumulate")
+        global include_scan = true
+    end
+    if contains(s,"sort")
+        global include_sort = true
+    end
+    if contains(s,"batched_")
+        global include_batched = true
+    end
+    if contains(s,"SparseMatrixCSC")
+        global include_sparse = true
+    end
+    if contains(s,"BitArray")
+        global include_bitarray = true
+    end
+    if contains(s,"stencil_halo") && isDistributedMode()
+        global include_halo = true
+    end
     if contains(s,"HDF5")
         global USE_HDF5 = 1
     end
@@ -3324,7 +3909,8 @@ function check_params(emitunaliasedroots, params, linfo)
         else
             assert(typeof(k) == Symbol)
             ptyp = lookupSymbolType(k, linfo)
-            if isArrayType(ptyp)
+            # bit arrays share their chunks with a Julia BitArray, which no other argument can alias
+            if isArrayType(ptyp) && !isPackedBitArrayType(ptyp)
 #                if !isArrayOfPrimitiveJuliaType(ptyp)
 #                    canAliasCheck = false
 #                end
@@ -3362,7 +3948,8 @@ end
 
 
 # This is the entry point to CGen from the PSE driver
-function from_root_entry(ast, functionName::AbstractString, argtyps, array_types_in_sig :: Dict{DataType,Int64} = Dict{DataType,Int64}())
+function from_root_entry(ast, functionName::AbstractString, argtyps, array_types_in_sig :: Dict{DataType,Int64} = Dict{DataType,Int64}(),
+                         shapes :: Dict{Symbol,Array{Int,1}} = Dict{Symbol,Array{Int,1}}())
     #assert(isfunctionhead(ast))
     global inEntryPoint
     inEntryPoint = true
@@ -3388,9 +3975,12 @@ function from_root_entry(ast, functionName::AbstractString, argtyps, array_types
 
     params = CompilerTools.LambdaHandling.getInputParametersAsExpr(linfo)
     returnType = CompilerTools.LambdaHandling.getReturnType(linfo)
+    # Sizes in shapes are constants in the body, unless it assigns the array to the parameter.
+    lstate.shapes = filter((p, dims) -> CompilerTools.LambdaHandling.getDesc(p, linfo) & CompilerTools.LambdaHandling.ISASSIGNED == 0, shapes)
     # Translate the body
     #bod = from_expr(ast, linfo)
     bod = from_lambda(linfo, body)
+    empty!(lstate.shapes)
 
     if DEBUG_LVL>=3
         dumpSymbolTable(lstate.symboltable)
@@ -3411,9 +4001,16 @@ function from_root_entry(ast, functionName::AbstractString, argtyps, array_types
     else
         returnType = (returnType,)
     end
+    # Bit arrays are returned unpacked, and the proxy in driver.jl packs them into a BitArray.
+    returnType = map(t -> isPackedBitArrayType(t) ? Array{Bool,ndims(t)} : t, returnType)
 
+    # Functions with parfors are compiled for each x86-64 level besides the baseline, and the
+    # entry point runs the highest one the CPU supports; with an alias check only the unaliased
+    # version is, the aliased fallback keeps the baseline.  A forced level is the only version.
+    isa_levels = lstate.parfors > 0 ? getIsaLevels() : Int[]
+    dispatch_levels = isa_level < 0 ? isa_levels : Int[]
     # Create an entry point that will be called by the Julia code.
-    wrapper = (emitunaliasedroots ? createEntryPointWrapper(functionName * "_unaliased", params, argsunal, returnType, argtypes) : "") * createEntryPointWrapper(functionName, params, args, returnType, argtypes, alias_check)
+    wrapper = (emitunaliasedroots ? createEntryPointWrapper(functionName * "_unaliased", params, argsunal, returnType, argtypes, nothing, dispatch_levels) : "") * createEntryPointWrapper(functionName, params, args, returnType, argtypes, alias_check, dispatch_levels)
     rtyp = "void"
     if length(returnType) > 0
         retargs = foldl((a, b) -> "$a, $b",
@@ -3428,22 +4025,63 @@ function from_root_entry(ast, functionName::AbstractString, argtyps, array_types
     argsunal *= comma * retargs
 
     @dprintln(3, "args = (", args, ")")
-    s = "$rtyp $functionName($args)\n{\n$bod\n}\n"
-    s *= emitunaliasedroots ? "$rtyp $(functionName)_unaliased($argsunal)\n{\n$bod\n}\n" : ""
+    s = ""
+    for level in isa_levels
+        suffix = isempty(dispatch_levels) ? "" : "_v$level"
+        target = "__attribute__((target(\"$(isa_targets[level])\")))\n"
+        # the aliased fallback of a dispatched function only runs the baseline
+        if !emitunaliasedroots || isempty(dispatch_levels)
+            s *= "$target$rtyp $functionName$suffix($args)\n{\n$bod\n}\n"
+        end
+        s *= emitunaliasedroots ? "$target$rtyp $(functionName)_unaliased$suffix($argsunal)\n{\n$bod\n}\n" : ""
+    end
+    if isempty(isa_levels) || !isempty(dispatch_levels)
+        s *= "$rtyp $functionName($args)\n{\n$bod\n}\n"
+        s *= emitunaliasedroots ? "$rtyp $(functionName)_unaliased($argsunal)\n{\n$bod\n}\n" : ""
+    end
     setFunctionCompiled(functionName, argtyps)
     forwards, funcs = from_worklist()
     hdr = from_header(true, linfo)
-    c = hdr * forwards * funcs * s * wrapper
+    c = resolveRandMarkers(hdr * forwards * funcs * s * wrapper)
     resetLambdaState(lstate)
 
     gen_j2c_array_new = "extern \"C\"\nvoid *j2c_array_new(int key, void*data, unsigned ndim, int64_t *dims) {\nvoid *a = NULL;\nswitch(key) {\n"
     for (key, value) in array_types_in_sig
+        if isSparseMatrixType(key) || isPackedBitArrayType(key)
+            continue
+        end
         atyp = toCtype(key)
         elemtyp = toCtype(eltype(key))
         gen_j2c_array_new *= "case " * string(value) * ":\na = new " * atyp * "((" * elemtyp * "*)data, ndim, dims);\nbreak;\n"
     end
     gen_j2c_array_new *= "default:\nfprintf(stderr, \"j2c_array_new called with invalid key %d\", key);\nassert(false);\nbreak;\n}\nreturn a;\n}\n"
     c *= gen_j2c_array_new
+    sparse_types_in_sig = filter((k, v) -> isSparseMatrixType(k), array_types_in_sig)
+    if !isempty(sparse_types_in_sig)
+        # the proxy in driver.jl wraps each sparse argument's arrays without copying them
+        gen_j2c_csc_new = "extern \"C\"\nvoid *j2c_csc_new(int key, int64_t m, int64_t n, void *colptr, void *rowval, void *nzval, int64_t nnz) {\nint64_t ncol = n + 1;\nvoid *a = NULL;\nswitch(key) {\n"
+        gen_j2c_csc_delete = "extern \"C\"\nvoid j2c_csc_delete(int key, void *a) {\nswitch(key) {\n"
+        for (key, value) in sparse_types_in_sig
+            styp = toCtype(key)
+            vtyp = toCtype(key.parameters[1])
+            ityp = toCtype(key.parameters[2])
+            gen_j2c_csc_new *= "case " * string(value) * ":\na = new " * styp * "(m, n, j2c_array<$ityp>(($ityp*)colptr, 1, &ncol), j2c_array<$ityp>(($ityp*)rowval, 1, &nnz), j2c_array<$vtyp>(($vtyp*)nzval, 1, &nnz));\nbreak;\n"
+            gen_j2c_csc_delete *= "case " * string(value) * ":\ndelete (" * styp * "*)a;\nbreak;\n"
+        end
+        gen_j2c_csc_new *= "default:\nfprintf(stderr, \"j2c_csc_new called with invalid key %d\", key);\nassert(false);\nbreak;\n}\nreturn a;\n}\n"
+        gen_j2c_csc_delete *= "default:\nfprintf(stderr, \"j2c_csc_delete called with invalid key %d\", key);\nassert(false);\nbreak;\n}\n}\n"
+        c *= gen_j2c_csc_new * gen_j2c_csc_delete
+    end
+    if any(isPackedBitArrayType, argtyps)
+        # the proxy in driver.jl wraps the chunks of each BitArray argument without copying them
+        c *= "extern \"C\"\nvoid *j2c_bits_new(uint64_t *chunks, unsigned ndim, int64_t *dims) {\nreturn new j2c_bitarray(chunks, ndim, dims);\n}\n"
+        c *= "extern \"C\"\nvoid j2c_bits_delete(void *a) {\ndelete (j2c_bitarray*)a;\n}\n"
+    end
+    global entry_uses_rand = include_rand && contains(c, "cgen_rand_key(")
+    if entry_uses_rand
+        # the proxy in driver.jl seeds the generator from Julia's global RNG before each call
+        c *= "extern \"C\"\nvoid cgen_rand_seed(uint64_t seed) {\ncgen_rand_set_seed(seed);\n}\n"
+    end
     flush(STDOUT)
     c
 end
@@ -3587,6 +4225,15 @@ function writec(s, outfile_name=nothing; with_headers=false)
         s = from_header(true) * "extern \"C\" {\n" * s * "\n}"
     end
     cgenOutput = "$generated_file_dir/$outfile_name.cpp"
+    if contains(s, line_reset)
+        lines = split(s, '\n')
+        for i in 1:length(lines)
+            if lines[i] == line_reset
+                lines[i] = "#line $(i + 1) \"$(escape_string(cgenOutput))\""
+            end
+        end
+        s = join(lines, '\n')
+    end
     cf = open(cgenOutput, "w")
     write(cf, s)
     @dprintln(3,"Done committing CGen code")
@@ -3698,6 +4345,61 @@ function getShellBase(flags=[])
   end
 end
 
+function getRuntimeLib()
+    return "$(getPackageRoot())/deps/libj2carray.so.1.0"
+end
+
+# build.sh compiles the non-template runtime into libj2carray with the default
+# code generation flags, so generated code links to it instead of compiling
+# that runtime again only while it is compiled with those same flags.
+function usePrebuiltRuntime()
+    backend = ParallelAccelerator.getBackendCompiler()
+    return (backend == ParallelAccelerator.USE_GCC || backend == ParallelAccelerator.USE_ICC) &&
+           !Compat.is_windows() && fastmathlevel == 0 &&
+           USE_OMP == ParallelAccelerator.openmp_supported &&
+           ParallelAccelerator.getPseMode() != ParallelAccelerator.OFFLOAD1_MODE &&
+           ParallelAccelerator.getPseMode() != ParallelAccelerator.OFFLOAD2_MODE &&
+           isfile(getRuntimeLib())
+end
+
+"""
+Returns the runtime header to pass to g++ with -include, after precompiling it
+for the given compile flags if that has not been done yet.  Precompiled headers
+are kept under deps/generated, one directory per compiler, flags and header
+contents, so that later sessions and other processes reuse them; a directory
+is published by renaming it once the header is built.  Returns "" for other
+compilers or when the header could not be built.
+"""
+function getRuntimePch(flags)
+    if ParallelAccelerator.getBackendCompiler() != ParallelAccelerator.USE_GCC
+        return ""
+    end
+    packageroot = getPackageRoot()
+    pchFlags = vcat(["-x", "c++-header"], flags)
+    pchCommand = getCompileCommand("cgen_runtime.h.gch", "cgen_runtime.h", copy(pchFlags))
+    key = hex(hash(string(getCompilerIdentity(pchCommand.exec[1]), pchCommand, getHeaderDigest())), 16)
+    pchdir = "$packageroot/deps/generated/pch-$key"
+    if !isfile("$pchdir/cgen_runtime.h.gch")
+        tmpdir = "$pchdir.$(getpid()).tmp"
+        try
+            mkpath(tmpdir)
+            write("$tmpdir/cgen_runtime.h", "#include \"$packageroot/deps/include/cgen_runtime.h\"\n")
+            run(getCompileCommand("$tmpdir/cgen_runtime.h.gch", "$tmpdir/cgen_runtime.h", copy(pchFlags)))
+            mv(tmpdir, pchdir)
+            @dprintln(1, "Precompiled runtime header in ", pchdir)
+        catch err
+            # another process may have published the same directory first
+            @dprintln(1, "Runtime header not precompiled in ", pchdir, ": ", err)
+            rm(tmpdir; force=true, recursive=true)
+        end
+    end
+    return isfile("$pchdir/cgen_runtime.h.gch") ? "$pchdir/cgen_runtime.h" : ""
+end
+
+# cgen_simd_math.h needs 64-bit integer vector instructions, and gcc only
+# if-converts its selects, and so vectorizes it, without trapping math
+const gccFastMathFlags = ["-march=native", "-fno-trapping-math", "-fno-math-errno"]
+
 function getCompileCommand(full_outfile_name, cgenOutput, flags=[])
   # return an error if this is not overwritten with a valid compiler
   compileCommand = `echo "invalid backend compiler"`
@@ -3716,6 +4418,9 @@ function getCompileCommand(full_outfile_name, cgenOutput, flags=[])
     DAALROOT=ENV["DAALROOT"]
     push!(Opts,"-I$DAALROOT/include")
   end
+  if usePrebuiltRuntime()
+    push!(Opts,"-DJ2C_PREBUILT_RUNTIME")
+  end
   if ParallelAccelerator.getBackendCompiler() == ParallelAccelerator.USE_ICC
     comp = "icpc"
     if isDistributedMode()
@@ -3737,6 +4442,9 @@ function getCompileCommand(full_outfile_name, cgenOutput, flags=[])
     if USE_OMP == 1 || USE_DAAL==1
         push!(Opts, "-qopenmp")
     end
+    if fastmathlevel > 0
+        append!(Opts, ["-xHost", "-fno-math-errno"])
+    end
     if ParallelAccelerator.getMklLib()!=""
         push!(Opts,"-mkl")
     end
@@ -3755,6 +4463,9 @@ function getCompileCommand(full_outfile_name, cgenOutput, flags=[])
     if USE_OMP == 1
         push!(Opts, "-fopenmp")
     end
+    if fastmathlevel > 0
+        append!(Opts, gccFastMathFlags)
+    end
     push!(Opts, "-std=c++11")
     compileCommand = `$comp $Opts -g -fpic -c -o $full_outfile_name $otherArgs $cgenOutput`
   elseif ParallelAccelerator.getBackendCompiler() == ParallelAccelerator.USE_MINGW
@@ -3775,6 +4486,28 @@ function getCompileCommand(full_outfile_name, cgenOutput, flags=[])
   return compileCommand
 end
 
+# the command that compiles a generated file, with the precompiled runtime
+# header when there is one
+function getOutputCompileCommand(outfile_name, flags=[])
+    full_outfile_name = `$generated_file_dir/$outfile_name.o`
+    cgenOutput = "$generated_file_dir/$outfile_name.cpp"
+    pch = getRuntimePch(flags)
+    # the report file names the generated file, so it stays out of the header's flags
+    return getCompileCommand(full_outfile_name, cgenOutput,
+                             vcat(pch == "" ? [] : ["-include", pch], flags, getVecReportFlags(cgenOutput)))
+end
+
+# flags that write the vectorization report of a generated file
+function getVecReportFlags(cgenOutput)
+    if !vec_report
+        return String[]
+    elseif ParallelAccelerator.getBackendCompiler() == ParallelAccelerator.USE_ICC
+        return ["-qopt-report=2", "-qopt-report-phase=vec", "-qopt-report-file=$(getVecReportFile(cgenOutput))"]
+    else
+        return ["-fopt-info-vec-all=$(getVecReportFile(cgenOutput))"]
+    end
+end
+
 function compile(outfile_name; flags=[])
     packageroot = getPackageRoot()
 
@@ -3800,14 +4533,89 @@ function compile(outfile_name; flags=[])
             run(beautifyCommand)
         end
 
-        full_outfile_name = `$generated_file_dir/$outfile_name.o`
-        compileCommand = getCompileCommand(full_outfile_name, cgenOutput, flags)
-        @dprintln(1,"Compilation command = ", compileCommand)
-        run(compileCommand)
+        compileCommand = getOutputCompileCommand(outfile_name, flags)
+        runCompile(compileCommand, vec_report ? getVecReportFile(cgenOutput) : "")
+    end
+end
+
+# the file that the compiler writes the vectorization report of a generated file to
+getVecReportFile(cgenOutput) = splitext(cgenOutput)[1] * ".vec"
+
+"""
+Runs a compile command and prints the vectorization report that it writes to
+report, unless that is "".  Compilers append to the report, so it is removed
+first.
+"""
+function runCompile(compileCommand, report)
+    if report != ""
+        rm(report, force=true)
+    end
+    @dprintln(1,"Compilation command = ", compileCommand)
+    run(compileCommand)
+    if report != "" && isfile(report)
+        printVecReport(parseVecReport(readlines(report)))
+    end
+end
+
+"""
+Summarizes a vectorization report of g++ (-fopt-info-vec) or icc
+(-qopt-report-phase=vec) by loop, which #line directives place in the Julia
+source.  Returns (file, line, vectorized, reasons) for every loop, sorted,
+with the reasons the compiler gave for not vectorizing it.
+"""
+function parseVecReport(lines)
+    vectorized = Dict{Tuple{String,Int},Bool}()
+    reasons = Dict{Tuple{String,Int},Array{String,1}}()
+    # icc reports nest the remarks of a loop between LOOP BEGIN and LOOP END
+    loops = Tuple{String,Int}[]
+    for l in lines
+        l = rstrip(l)
+        m = match(r"^(.+):(\d+):\d+: \w+: (.*)$", l)
+        if m != nothing
+            loc = (String(m.captures[1]), parse(Int, m.captures[2]))
+            msg = m.captures[3]
+        else
+            m = match(r"LOOP BEGIN at (.+)\((\d+),\d+\)", l)
+            if m != nothing
+                push!(loops, (String(m.captures[1]), parse(Int, m.captures[2])))
+                continue
+            elseif contains(l, "LOOP END") && !isempty(loops)
+                pop!(loops)
+                continue
+            elseif isempty(loops)
+                continue
+            end
+            loc = loops[end]
+            msg = l
+        end
+        if contains(msg, "loop vectorized") || contains(msg, "LOOP WAS VECTORIZED")
+            vectorized[loc] = true
+        elseif contains(msg, "couldn't vectorize loop")
+            get!(reasons, loc, String[])
+        else
+            m = match(r"not vectorized: *([^.]*)", msg)
+            if m != nothing
+                r = get!(reasons, loc, String[])
+                reason = strip(m.captures[1])
+                if reason != "" && !in(reason, r)
+                    push!(r, reason)
+                end
+            end
+        end
+    end
+    return [(loc[1], loc[2], get(vectorized, loc, false), get(reasons, loc, String[]))
+            for loc in sort(collect(union(keys(vectorized), keys(reasons))))]
+end
+
+function printVecReport(summary)
+    println("Vectorization report:")
+    for (file, line, vectorized, reasons) in summary
+        println("  $file:$line: ", vectorized ? "vectorized" :
+                "not vectorized" * (isempty(reasons) ? "" : ": " * join(reasons, "; ")))
     end
 end
 
-function getLinkCommand(outfile_name, lib, flags=[])
+function getLinkCommand(outfile_name, lib, flags=[], obj="$generated_file_dir/$outfile_name.o")
     # return an error if this is not overwritten with a valid compiler
     linkCommand = `echo "invalid backend linker"`
 
@@ -3832,6 +4640,9 @@ function getLinkCommand(outfile_name, lib, flags=[])
             push!(linkLibs,"-mkl")
         end
     end
+    if usePrebuiltRuntime()
+        push!(linkLibs, getRuntimeLib())
+    end
     if USE_HDF5==1
         if haskey(ENV,"HDF5_DIR")
             HDF5_DIR=ENV["HDF5_DIR"]
@@ -3869,7 +4680,7 @@ function getLinkCommand(outfile_name, lib, flags=[])
     if USE_OMP==1 || USE_DAAL==1
         push!(Opts,"-qopenmp")
     end
-    linkCommand = `$comp -g -shared $Opts -o $lib $generated_file_dir/$outfile_name.o $linkLibs -lm`
+    linkCommand = `$comp -g -shared $Opts -o $lib $obj $linkLibs -lm`
   elseif ParallelAccelerator.getBackendCompiler() == ParallelAccelerator.USE_GCC
     comp = getGccName()
     if isDistributedMode()
@@ -3879,7 +4690,7 @@ function getLinkCommand(outfile_name, lib, flags=[])
         push!(Opts,"-fopenmp")
     end
     push!(Opts, "-std=c++11")
-    linkCommand = `$comp -g -shared $Opts -o $lib $generated_file_dir/$outfile_name.o $linkLibs -lm`
+    linkCommand = `$comp -g -shared $Opts -o $lib $obj $linkLibs -lm`
   elseif ParallelAccelerator.getBackendCompiler() == ParallelAccelerator.USE_MINGW
     gpp = Pkg.dir("WinRPM","deps","usr","x86_64-w64-mingw32","sys-root","mingw","bin","g++")
     RPMbindir = Pkg.dir("WinRPM","deps","usr","x86_64-w64-mingw32","sys-root","mingw","bin")
@@ -3891,19 +4702,23 @@ function getLinkCommand(outfile_name, lib, flags=[])
         push!(Opts, "-fopenmp")
     end
     push!(Opts, "-std=c++11")
-    linkCommand = `$gpp -static-libgcc -static-libstdc++ -g -shared $Opts -o $lib $generated_file_dir/$outfile_name.o $linkLibs -lm -Wl,-static -lgomp -Wl,-Bdynamic -lpthread`
+    linkCommand = `$gpp -static-libgcc -static-libstdc++ -g -shared $Opts -o $lib $obj $linkLibs -lm -Wl,-static -lgomp -Wl,-Bdynamic -lpthread`
   end
 
   return linkCommand
 end
 
 
-function link(outfile_name; flags=[])
+function getLibName(outfile_name)
     if Compat.is_windows()
-        lib = "$generated_file_dir/lib$outfile_name.dll"
+        return "$generated_file_dir/lib$outfile_name.dll"
     else
-        lib = "$generated_file_dir/lib$outfile_name.so.1.0"
+        return "$generated_file_dir/lib$outfile_name.so.1.0"
     end
+end
+
+function link(outfile_name; flags=[])
+    lib = getLibName(outfile_name)
 
     if !isDistributedMode() || MPI.Comm_rank(MPI.COMM_WORLD)==0
         linkCommand = getLinkCommand(outfile_name, lib, flags)
@@ -3917,4 +4732,211 @@ function link(outfile_name; flags=[])
     return lib
 end
 
+# --version output of each backend compiler, part of the cache key
+compiler_identities = Dict{String,String}()
+
+function getCompilerIdentity(comp)
+    if !haskey(compiler_identities, comp)
+        try
+            compiler_identities[comp] = readstring(`$comp --version`)
+        catch
+            compiler_identities[comp] = comp
+        end
+    end
+    return compiler_identities[comp]
+end
+
+# target options -march=native resolves to on this host, part of the cache key
+# when fast math compiles for the host CPU
+host_isas = Dict{String,String}()
+
+function getHostIsa(comp)
+    if !haskey(host_isas, comp)
+        try
+            host_isas[comp] = readstring(`$comp -march=native -Q --help=target`)
+        catch
+            host_isas[comp] = Sys.CPU_NAME
+        end
+    end
+    return host_isas[comp]
+end
+
+# hash of every runtime header the generated code may include
+function getHeaderDigest()
+    incdir = "$(getPackageRoot())/deps/include"
+    return join(["$f:$(hex(hash(readstring("$incdir/$f"))))" for f in sort(readdir(incdir))], "\n")
+end
+
+"""
+Returns the text that identifies the shared object built from a generated file:
+the Julia version, the compiler identity, the host ISA under fast math, the
+compile and link commands (with
+the session's file names left out), the runtime headers and the generated
+source itself.
+"""
+function getCacheKeyText(outfile_name, flags)
+    compileCommand = getCompileCommand("cgen_output.o", "cgen_output.cpp", copy(flags))
+    linkCommand = getLinkCommand("cgen_output", "libcgen_output", copy(flags))
+    commands = replace(string(compileCommand, "\n", linkCommand), generated_file_dir, "")
+    cgenOutput = "$generated_file_dir/$outfile_name.cpp"
+    # #line directives name the generated file
+    source = replace(readstring(cgenOutput), escape_string(cgenOutput), "cgen_output.cpp")
+    # -march=native/-xHost objects only run on CPUs like this one
+    isa = fastmathlevel > 0 ? getHostIsa(compileCommand.exec[1]) : ""
+    return string(VERSION, "\n", getCompilerIdentity(compileCommand.exec[1]), "\n", isa, "\n", commands, "\n",
+                  getHeaderDigest(), "\n", source)
+end
+
+# cache entry, as the key file and the library, for a key text
+function getCacheEntry(key_text)
+    key = hex(hash(key_text), 16)
+    return "$cache_dir/$key.key", Compat.is_windows() ? "$cache_dir/lib$key.dll" : "$cache_dir/lib$key.so.1.0"
+end
+
+"""
+Returns the library cached under the key text, or "" when there is none.  A
+hash collision is caught by comparing the stored key text.
+"""
+function getCachedLib(key_text)
+    cached_key, cached_lib = getCacheEntry(key_text)
+    if isfile(cached_lib) && isfile(cached_key) && readstring(cached_key) == key_text
+        @dprintln(1, "Reusing cached ", cached_lib)
+        return cached_lib
+    end
+    return ""
+end
+
+"""
+Copies a library into the cache under the key text.  Entries are published by
+renaming, the key file before the library, so that processes sharing the
+cache never see a partial entry.
+"""
+function putCachedLib(key_text, lib)
+    cached_key, cached_lib = getCacheEntry(key_text)
+    try
+        mkpath(cache_dir)
+        tmp = "$cached_key.$(getpid()).tmp"
+        write(tmp, key_text)
+        mv(tmp, cached_key, remove_destination=true)
+        cp(lib, tmp, remove_destination=true)
+        mv(tmp, cached_lib, remove_destination=true)
+        @dprintln(1, "Cached ", lib, " as ", cached_lib)
+    catch err
+        @dprintln(1, "Could not cache ", lib, " in ", cache_dir, ": ", err)
+    end
+end
+
+"""
+Compiles and links a generated file, reusing the shared object in cache_dir
+that was built from the same key text by this or an earlier session.
+"""
+function compile_and_link(outfile_name; flags=[])
+    # a cached library comes without a vectorization report
+    if cache_dir == "" || isDistributedMode() || vec_report
+        compile(outfile_name, flags=copy(flags))
+        return link(outfile_name, flags=copy(flags))
+    end
+    key_text = getCacheKeyText(outfile_name, flags)
+    cached_lib = getCachedLib(key_text)
+    if cached_lib != ""
+        return cached_lib
+    end
+    compile(outfile_name, flags=copy(flags))
+    lib = link(outfile_name, flags=copy(flags))
+    putCachedLib(key_text, lib)
+    return lib
+end
+
+"""
+Returns a function that compiles and links a generated file, or finds it in
+the cache, and returns the library.  The commands and the cache key are fixed
+here, because they depend on CGen state that the translation of the next
+function changes, so that the returned function can run on a background task.
+Not for distributed mode, where the ranks build together.
+"""
+function deferred_compile_and_link(outfile_name; flags=[])
+    key_text = cache_dir == "" || vec_report ? "" : getCacheKeyText(outfile_name, flags)
+    compileCommand = getOutputCompileCommand(outfile_name, copy(flags))
+    report = vec_report ? getVecReportFile("$generated_file_dir/$outfile_name.cpp") : ""
+    lib = getLibName(outfile_name)
+    linkCommand = getLinkCommand(outfile_name, lib, copy(flags))
+    return () -> begin
+        cached_lib = key_text == "" ? "" : getCachedLib(key_text)
+        if cached_lib != ""
+            return cached_lib
+        end
+        runCompile(compileCommand, report)
+        @dprintln(1, "Link command = ", linkCommand)
+        run(linkCommand)
+        if key_text != ""
+            putCachedLib(key_text, lib)
+        end
+        return lib
+    end
+end
+
+function usePgo()
+    return pgo_mode && ParallelAccelerator.getBackendCompiler() == ParallelAccelerator.USE_GCC && !isDistributedMode()
+end
+
+# profiles are kept next to the compile cache, so that later sessions use them
+function getProfileDir()
+    return cache_dir != "" ? "$cache_dir/profiles" : "$generated_file_dir/profiles"
+end
+
+# name of the profile of a generated file, from its cache key text so that the
+# same code in a later session finds it
+function getProfileKey(outfile_name)
+    return "cgen_" * hex(hash(getCacheKeyText(outfile_name, [])), 16)
+end
+
+"""
+Returns true if a profile was recorded under the key.  g++ names profiles
+after the full path of the object file, under the profile directory, which
+is why PGO builds put their objects there under the key.
+"""
+function hasProfile(key)
+    dir = getProfileDir()
+    if !isdir(dir)
+        return false
+    end
+    for (root, dirs, files) in walkdir(dir)
+        if any(f -> endswith(f, "$key.gcda"), files)
+            return true
+        end
+    end
+    return false
+end
+
+"""
+Like deferred_compile_and_link, for a PGO build of a generated file.  With
+instrument, the library records a profile and exports cgen_profile_dump to
+write it; otherwise it is optimized with the recorded profile.  PGO builds
+bypass the compile cache, whose key does not cover the profile.
+"""
+function deferred_pgo_compile_and_link(outfile_name, key, instrument::Bool)
+    dir = getProfileDir()
+    obj = "$dir/$key.o"
+    if instrument
+        # OpenMP threads update the counters concurrently
+        pgoFlags = ["-fprofile-generate", "-fprofile-update=atomic", "-DCGEN_PROFILE_GENERATE"]
+        lib = getLibName("$(outfile_name)_prof")
+    else
+        pgoFlags = ["-fprofile-use", "-fprofile-correction", "-Wno-missing-profile"]
+        lib = getLibName("$(outfile_name)_pgo")
+    end
+    push!(pgoFlags, "-fprofile-dir=$dir")
+    cgenOutput = "$generated_file_dir/$outfile_name.cpp"
+    compileCommand = getCompileCommand(obj, cgenOutput, vcat(pgoFlags, getVecReportFlags(cgenOutput)))
+    report = vec_report ? getVecReportFile(cgenOutput) : ""
+    linkCommand = getLinkCommand(outfile_name, lib, instrument ? ["-fprofile-generate"] : [], obj)
+    return () -> begin
+        mkpath(dir)
+        runCompile(compileCommand, report)
+        @dprintln(1, "Link command = ", linkCommand)
+        run(linkCommand)
+        return lib
+    end
+end
+
 end # CGen module
@@ -555,6 +555,8 @@ const pointWiseOps = setdiff(Set{Symbol}(mapOpr), Set{Symbol}([:pa_api_mul, :pa_
 
 const compareOpSet = Set{Symbol}(API.comparison_map_operators)
 const mapOps = Dict{Symbol,Symbol}(zip(mapOpr, mapVal))
+# BitArray operators that API leaves as calls, and the maps they fall back to
+const bits_mapops = Dict{Symbol,Symbol}(:& => :pa_api_ampersand, :| => :pa_api_pipe, :xor => :pa_api_dollar)
 # legacy v0.3
 # symbols that when lifted up to array level should be changed.
 # const liftOps = Dict{Symbol,Symbol}(zip(Symbol[:<=, :>=, :<, :(==), :>, :+,:-,:*,:/], Symbol[:.<=, :.>=, :.<, :.==, :.>, :.+, :.-, :.*, :./]))
@@ -2664,6 +2666,18 @@ function translate_call_globalref(state, env, typ, head, oldfun::ANY, oldargs, f
         oldfun = Base.resolve(GlobalRef(Base, fun.name))
         dprintln(env,"Translate function from API.Lib back to Base: ", oldfun)
         oldargs = normalize_args(state, env_, oldargs)
+        # word-at-a-time kernels only pay off on packed BitArray arguments; masks
+        # computed in the function are byte arrays and stay fusable maps/reductions
+        packed = all(a -> typeOfOpr(state, a) <: BitArray, oldargs)
+        if haskey(bits_mapops, fun.name) && !packed
+            return translate_call_mapop(state, env_, typ, bits_mapops[fun.name], oldargs)
+        elseif fun.name === :sum && packed
+            oldfun = GlobalRef(Base, :count)
+        elseif fun.name === :sum
+            ityp = Array{Int, ndims(typeOfOpr(state, oldargs[1]))}
+            mul = translate_call_mapop(state, env_, ityp, :pa_api_elem_mul, Any[1, oldargs[1]])
+            return translate_call_reduceop(state, env_, typ, :sum, Any[mul])
+        end
         expr = mk_expr(typ, head, oldfun, oldargs...)
     elseif isdefined(fun.mod, fun.name)
         gf = getfield(fun.mod, fun.name)
@@ -25,7 +25,7 @@ THE POSSIBILITY OF SUCH DAMAGE.
 
 module Driver
 
-export accelerate, toDomainIR, toParallelIR, toFlatParfors, toJulia, toCGen, toCartesianArray, runStencilMacro, captureOperators, expandParMacro, extractCallGraph
+export accelerate, asyncCompile, shapeSpecialize, awaitCompiles, prewarm, optimizeProfiled, toDomainIR, toParallelIR, toFlatParfors, toJulia, toCGen, toCartesianArray, runStencilMacro, captureOperators, expandParMacro, extractCallGraph
 
 using CompilerTools
 using CompilerTools.AstWalker
@@ -48,13 +48,19 @@ isArrayOrStringType(x) = isArrayType(x) || isStringType(x)
 function convert_to_ccall_typ(typ)
   @dprintln(3,"convert_to_ccall_typ typ = ", typ, " typeof(typ) = ", typeof(typ))
   # if there a better way to check for typ being an array DataType?
-  if isArrayType(typ)
+  if CGen.isPackedBitArrayType(typ)
+    # BitArrays are passed as a pointer to a j2c_bitarray.
+    return (Ptr{Void},0)
+  elseif isArrayType(typ)
     # If it is an Array type then convert to Ptr type.
     return (Ptr{Void},ndims(typ))
   elseif (typ === ())
     return (Void, 0)
   elseif isStringType(typ)
       return (Ptr{UInt8},1)
+  elseif CGen.isSparseMatrixType(typ)
+    # Sparse matrices are passed as a pointer to a j2c_csc.
+    return (Ptr{Void},0)
   else
     # Else no conversion needed.
     return (typ,0)
@@ -107,6 +113,38 @@ end
 
 alreadyOptimized = Dict{Tuple{Function,Tuple},Any}()
 
+# With async_compile, the generated code is compiled on a background task and
+# calls made meanwhile run the original Julia method.
+async_compile = haskey(ENV, "CGEN_ASYNC_COMPILE") && ENV["CGEN_ASYNC_COMPILE"] == "1"
+function asyncCompile(x)
+  global async_compile = x
+end
+
+# With shape_specialize, a function called repeatedly with the same small array
+# dimensions is translated again with those dimensions as constants.
+shape_specialize = haskey(ENV, "CGEN_SHAPE_SPECIALIZE") && ENV["CGEN_SHAPE_SPECIALIZE"] == "1"
+function shapeSpecialize(x)
+  global shape_specialize = x
+end
+
+# largest dimension that a version is specialized for
+const shape_specialize_max = 16
+# calls with the same small dimensions before a version is specialized for them
+const shape_specialize_calls = 4
+# most shapes that each function decides on, specialized or not
+const shape_specialize_variants = 8
+
+# proxies made by toCGen, so that a signature translated by prewarm is not
+# translated again when it is first called
+cgen_proxies = Dict{Tuple{GlobalRef,Tuple},Function}()
+
+# background compilations that have not finished yet
+pending_compiles = Set{Task}()
+
+# instrumented PGO builds waiting for optimizeProfiled: the function, its
+# library, the proxy's current target and the build that uses the profile
+pgo_pending = Any[]
+
 # ParallelAccelerator doesn't really function well on callsites anymore so we would like to give an
 # error if somebody tries to use it in that way.  This is a little difficult with @acc because where at callsite
 # or on a function declaration, what the optimization pass will see is still a Function Expr.
@@ -212,11 +250,167 @@ function toJulia(func :: GlobalRef, ast, signature :: Tuple)
   return (LambdaVarInfo, body)
 end
 
+"""
+Returns the original Julia method of an accelerated function, which async
+proxies call until the generated code is compiled, or nothing if it cannot be
+found.
+"""
+function getFallbackFunc(func :: GlobalRef)
+  if CGen.isDistributedMode()
+    return nothing
+  end
+  try
+    return eval(CompilerTools.OptFramework.findTargetFunc(func.mod, func.name))
+  catch err
+    @dprintln(1, "No fallback for ", func, ", compiling it now: ", err)
+    return nothing
+  end
+end
+
+"""
+Returns a proxy that runs fallback until build, which is started on a
+background task, returns the native proxy, and from then on calls that.  If
+the build fails, the proxy keeps running fallback.
+"""
+function asyncProxy(func :: GlobalRef, fallback :: Function, build :: Function)
+  native = Ref{Any}(nothing)
+  task = @schedule begin
+    try
+      native[] = build()
+      @dprintln(1, "Background compilation of ", func, " done")
+    catch err
+      println("ParallelAccelerator could not compile ", func, " in the background and keeps running it in Julia: ", err)
+    finally
+      delete!(pending_compiles, current_task())
+    end
+  end
+  push!(pending_compiles, task)
+  proxy_sym = gensym(string("_", CGen.canonicalize(string(func.name)), "_async_proxy"))
+  return @eval function ($proxy_sym)(args...)
+    proxy = $(native)[]
+    # the native proxy is defined after this one, so it is called in the latest world
+    return proxy === nothing ? $(fallback)(args...) : Base.invokelatest(proxy, args...)
+  end
+end
+
+"""
+Returns a proxy for PGO mode.  When a profile of the generated code was
+recorded before, the code is built with it right away.  Otherwise the proxy
+runs an instrumented build until optimizeProfiled rebuilds it.
+"""
+function pgoProxy(func :: GlobalRef, outfile_name, build_proxy :: Function)
+  key = CGen.getProfileKey(outfile_name)
+  optimized = CGen.deferred_pgo_compile_and_link(outfile_name, key, false)
+  if CGen.hasProfile(key)
+    return build_proxy(optimized())
+  end
+  lib = CGen.deferred_pgo_compile_and_link(outfile_name, key, true)()
+  native = Ref{Any}(build_proxy(lib))
+  push!(pgo_pending, (func, lib, native, () -> build_proxy(optimized())))
+  proxy_sym = gensym(string("_", CGen.canonicalize(string(func.name)), "_pgo_proxy"))
+  return @eval function ($proxy_sym)(args...)
+    return Base.invokelatest($(native)[], args...)
+  end
+end
+
+# sizes of the array arguments, with the dimensions too large to specialize for as 0
+function shapeGuard(args, array_args)
+  return [Int[d <= shape_specialize_max ? d : 0 for d in size(args[i])] for i in array_args]
+end
+
+# the version of func for shape: the one specialize builds, or generic when the
+# shape has no small dimension or the build fails
+function specializeShape(func :: GlobalRef, generic :: Function, specialize :: Function, shape)
+  if all(dims -> all(d -> d == 0, dims), shape)
+    return generic
+  end
+  try
+    return specialize(shape)
+  catch err
+    println("ParallelAccelerator could not specialize ", func, " for array sizes ", shape, " and keeps the generic code: ", err)
+    return generic
+  end
+end
+
+"""
+Returns a proxy for shape specialization mode.  It counts the calls of generic
+by the small dimensions of the array arguments, and after
+shape_specialize_calls calls with the same ones it has specialize build a
+version with those dimensions as constants.  Calls whose small dimensions match
+a version run it, and the others run generic.
+"""
+function shapeProxy(func :: GlobalRef, generic :: Function, array_args, specialize :: Function)
+  counts = Dict{Any,Int}()
+  versions = Dict{Any,Function}()
+  proxy_sym = gensym(string("_", CGen.canonicalize(string(func.name)), "_shape_proxy"))
+  return @eval function ($proxy_sym)(args...)
+    shape = $(shapeGuard)(args, $array_args)
+    version = get($versions, shape, nothing)
+    # versions are defined after this proxy, possibly during the current call
+    if version !== nothing
+      return Base.invokelatest(version, args...)
+    end
+    if length($versions) >= $shape_specialize_variants
+      return $(generic)(args...)
+    end
+    n = get($counts, shape, 0) + 1
+    if n < $shape_specialize_calls
+      $(counts)[shape] = n
+      return $(generic)(args...)
+    end
+    delete!($counts, shape)
+    version = $(versions)[shape] = $(specializeShape)($func, $generic, $specialize, shape)
+    return Base.invokelatest(version, args...)
+  end
+end
+
+"""
+Writes the profiles recorded by the instrumented builds of PGO mode, rebuilds
+those functions with their profiles and switches their proxies to the new
+code.  Call it after running a representative workload.
+"""
+function optimizeProfiled()
+  for (func, lib, native, rebuild) in pgo_pending
+    try
+      ccall(Base.Libdl.dlsym(Base.Libdl.dlopen(lib), :cgen_profile_dump), Void, ())
+      native[] = rebuild()
+    catch err
+      println("ParallelAccelerator could not rebuild ", func, " with its profile and keeps the instrumented code: ", err)
+    end
+  end
+  empty!(pgo_pending)
+end
+
+"""
+Waits until every background compilation started so far has finished, so that
+the accelerated functions run their generated code from then on.
+"""
+function awaitCompiles()
+  while !isempty(pending_compiles)
+    wait(first(pending_compiles))
+  end
+end
+
+"""
+Translates func for each of the given signatures (tuples of argument types)
+ahead of its first call.  With async_compile the generated code is then
+compiled in the background; use awaitCompiles to wait for it.
+"""
+function prewarm(func :: Function, signatures)
+  for signature in signatures
+    accelerate(func, signature)
+  end
+end
+
 function toCGen(func :: GlobalRef, code, signature :: Tuple)
   # In threads mode, we have already converted back to standard Julia AST so we skip this phase.
   if ParallelAccelerator.getPseMode() == ParallelAccelerator.THREADS_MODE
     return code
   end
+  # a signature translated by prewarm is already done, or compiling
+  if haskey(cgen_proxies, (func, signature))
+    return cgen_proxies[(func, signature)]
+  end
   
   off_time_start = time_ns()
 
@@ -229,6 +423,11 @@ function toCGen(func :: GlobalRef, code, signature :: Tuple)
       if isStringType(t)
           array_types_in_sig[Array{UInt8, 1}] = atiskey
           atiskey += 1
+      elseif CGen.isSparseMatrixType(t)
+          array_types_in_sig[t] = atiskey
+          atiskey += 1
+      elseif CGen.isPackedBitArrayType(t)
+          # passed by j2c_bits_new, which needs no key
       else
           while isArrayType(t)
               array_types_in_sig[t] = atiskey;
@@ -264,146 +463,213 @@ function toCGen(func :: GlobalRef, code, signature :: Tuple)
   end
   @dprintln(3, "array_types_in_sig including returns = ", array_types_in_sig)
  
+  # shape specialization translates the code again, which translation may change
+  shape_code = shape_specialize ? deepcopy(code) : nothing
+  param_names = copy(CompilerTools.LambdaHandling.getInputParameters(LambdaVarInfo))
   outfile_name = CGen.writec(CGen.from_root_entry(code, function_name_string, signature, array_types_in_sig))
-  CGen.compile(outfile_name)
-  dyn_lib = CGen.link(outfile_name)
-  full_outfile_name = "$package_root/deps/generated/$outfile_name.cpp"
-  full_outfile_base = "$package_root/deps/generated/$outfile_name"
- 
-  # The proxy function name is the original function name with "_j2c_proxy" appended.
-  proxy_name = string("_",function_name_string,"_j2c_proxy")
-  proxy_sym = gensym(proxy_name)
-  @dprintln(2, "toCGen for ", proxy_name)
-  @dprintln(2, "C File  = ", full_outfile_name)
-  @dprintln(2, "dyn_lib = ", dyn_lib)
-  
-  # This is the name of the function that j2c generates.
-  j2c_name = string("_",function_name_string,"_")
-  
+  # read now, as translating the next function resets it
+  entry_uses_rand = CGen.entry_uses_rand
+
+  # Builds the Julia proxy that calls the generated code in dyn_lib.
+  function build_proxy(dyn_lib)
+    full_outfile_name = "$package_root/deps/generated/$outfile_name.cpp"
+    full_outfile_base = "$package_root/deps/generated/$outfile_name"
+
+    # The proxy function name is the original function name with "_j2c_proxy" appended.
+    proxy_name = string("_",function_name_string,"_j2c_proxy")
+    proxy_sym = gensym(proxy_name)
+    @dprintln(2, "toCGen for ", proxy_name)
+    @dprintln(2, "C File  = ", full_outfile_name)
+    @dprintln(2, "dyn_lib = ", dyn_lib)
+
+    # This is the name of the function that j2c generates.
+    j2c_name = string("_",function_name_string,"_")
+
+
+    # Convert Arrays in signature to Ptr and add extra arguments for array dimensions
+    (modified_sig, sig_dims) = convert_sig(signature)
+    @dprintln(2, "modified_sig = ", modified_sig)
+    @dprintln(2, "sig_dims = ", sig_dims)
+    original_args = CompilerTools.LambdaHandling.getInputParameters(LambdaVarInfo)
+    @dprintln(3, "len? ", length(original_args), length(sig_dims))
+
+    map!(s -> gensym(string(s)), original_args, original_args)
+    assert(length(original_args) == length(sig_dims))
+    modified_args = Array{Any}(length(sig_dims))
+    extra_inits = Array{Any}(0)
+    j2c_array = gensym("j2c_arr")
+    csc_inits = Array{Any}(0)
+    csc_keys = Array{Int}(0)
+    j2c_csc = gensym("j2c_csc")
+    bits_inits = Array{Any}(0)
+    j2c_bits = gensym("j2c_bits")
+
+    j2c_array_new = 
+      # Create a new j2c array object with element size in bytes and given dimension.
+      # It will share the data pointer of the given inp array, and if inp is nothing,
+      # the j2c array will allocate fresh memory to hold data.
+      # NOTE: when elem_bytes is 0, it means the elements must be j2c array type
+      @eval (elem_bytes::Int, inp::Union{Array, Void}, ndim::Int, dims::Tuple) -> begin
+        # note that C interface mandates Int64 for dimension data
+        _dims = Int64[ convert(Int64, x) for x in dims ]
+        _inp = (inp === nothing) ? C_NULL : convert(Ptr{Void}, pointer(inp))
+
+        #ccall((:j2c_array_new, $dyn_lib), Ptr{Void}, (Cint, Ptr{Void}, Cuint, Ptr{UInt64}),
+        #      convert(Cint, elem_bytes), _inp, convert(Cuint, ndim), pointer(_dims))
+        ccall((:j2c_array_new, $dyn_lib), Ptr{Void}, (Cint, Ptr{Void}, Cuint, Ptr{UInt64}),
+              convert(Cint, elem_bytes), _inp, convert(Cuint, ndim), pointer(_dims))
+      end
 
-  # Convert Arrays in signature to Ptr and add extra arguments for array dimensions
-  (modified_sig, sig_dims) = convert_sig(signature)
-  @dprintln(2, "modified_sig = ", modified_sig)
-  @dprintln(2, "sig_dims = ", sig_dims)
-  original_args = CompilerTools.LambdaHandling.getInputParameters(LambdaVarInfo)
-  @dprintln(3, "len? ", length(original_args), length(sig_dims))
- 
-  map!(s -> gensym(string(s)), original_args, original_args)
-  assert(length(original_args) == length(sig_dims))
-  modified_args = Array{Any}(length(sig_dims))
-  extra_inits = Array{Any}(0)
-  j2c_array = gensym("j2c_arr")
-
-  j2c_array_new = 
-    # Create a new j2c array object with element size in bytes and given dimension.
-    # It will share the data pointer of the given inp array, and if inp is nothing,
-    # the j2c array will allocate fresh memory to hold data.
-    # NOTE: when elem_bytes is 0, it means the elements must be j2c array type
-    @eval (elem_bytes::Int, inp::Union{Array, Void}, ndim::Int, dims::Tuple) -> begin
-      # note that C interface mandates Int64 for dimension data
-      _dims = Int64[ convert(Int64, x) for x in dims ]
-      _inp = (inp === nothing) ? C_NULL : convert(Ptr{Void}, pointer(inp))
-
-      #ccall((:j2c_array_new, $dyn_lib), Ptr{Void}, (Cint, Ptr{Void}, Cuint, Ptr{UInt64}),
-      #      convert(Cint, elem_bytes), _inp, convert(Cuint, ndim), pointer(_dims))
-      ccall((:j2c_array_new, $dyn_lib), Ptr{Void}, (Cint, Ptr{Void}, Cuint, Ptr{UInt64}),
-            convert(Cint, elem_bytes), _inp, convert(Cuint, ndim), pointer(_dims))
+    for i = 1:length(sig_dims)
+      arg = original_args[i]
+      if sig_dims[i] > 0 
+        j = length(extra_inits) + 1
+        push!(extra_inits, :(to_j2c_array($arg, ptr_array_dict, $array_types_in_sig, $j2c_array_new)))
+        modified_args[i] = :($(j2c_array)[$j])
+      elseif CGen.isSparseMatrixType(signature[i])
+        # the C++ j2c_csc shares colptr, rowval and nzval with the Julia matrix
+        j = length(csc_inits) + 1
+        key = array_types_in_sig[signature[i]]
+        push!(csc_inits, :(ccall((:j2c_csc_new, $dyn_lib), Ptr{Void}, (Cint, Int64, Int64, Ptr{Void}, Ptr{Void}, Ptr{Void}, Int64),
+                                 $key, $arg.m, $arg.n, pointer($arg.colptr), pointer($arg.rowval), pointer($arg.nzval), length($arg.rowval))))
+        push!(csc_keys, key)
+        modified_args[i] = :($(j2c_csc)[$j])
+      elseif CGen.isPackedBitArrayType(signature[i])
+        # the C++ j2c_bitarray shares the chunks of the Julia BitArray
+        j = length(bits_inits) + 1
+        push!(bits_inits, :(ccall((:j2c_bits_new, $dyn_lib), Ptr{Void}, (Ptr{UInt64}, Cuint, Ptr{Int64}),
+                                  pointer($arg.chunks), $(ndims(signature[i])), Int64[size($arg)...])))
+        modified_args[i] = :($(j2c_bits)[$j])
+      else
+        modified_args[i] = arg
+      end
     end
 
-  for i = 1:length(sig_dims)
-    arg = original_args[i]
-    if sig_dims[i] > 0 
-      j = length(extra_inits) + 1
-      push!(extra_inits, :(to_j2c_array($arg, ptr_array_dict, $array_types_in_sig, $j2c_array_new)))
-      modified_args[i] = :($(j2c_array)[$j])
+    # Create a set of expressions to pass as arguments to specify the array dimension sizes.
+    if ParallelAccelerator.getPseMode() == ParallelAccelerator.HOST_MODE
+        run_where = -1
+    elseif ParallelAccelerator.getPseMode() == ParallelAccelerator.OFFLOAD1_MODE
+        run_where = 0
+    elseif ParallelAccelerator.getPseMode() == ParallelAccelerator.OFFLOAD2_MODE
+        run_where = 1
+  #  elseif ParallelAccelerator.getPseMode() == ParallelAccelerator.TASK_MODE
+  #      pert_init(package_root, false)
     else
-      modified_args[i] = arg
+        throw("PSE mode error")
     end
-  end
-  
-  # Create a set of expressions to pass as arguments to specify the array dimension sizes.
-  if ParallelAccelerator.getPseMode() == ParallelAccelerator.HOST_MODE
-      run_where = -1
-  elseif ParallelAccelerator.getPseMode() == ParallelAccelerator.OFFLOAD1_MODE
-      run_where = 0
-  elseif ParallelAccelerator.getPseMode() == ParallelAccelerator.OFFLOAD2_MODE
-      run_where = 1
-#  elseif ParallelAccelerator.getPseMode() == ParallelAccelerator.TASK_MODE
-#      pert_init(package_root, false)
-  else
-      throw("PSE mode error")
-  end
-  
-  num_rets = length(ret_typs)
-  ret_arg_exps = Array{Any}(0)
-  extra_sig = Array{Type}(0)
-  # We special-case functions that return Void/nothing since it is common.
-  Void_return = (num_rets == 1 && ret_typs[1][1] == Void)
-  if !Void_return
-      for i = 1:num_rets
-          (typ, is_array) = ret_typs[i]
-          push!(extra_sig, is_array ? Ptr{Ptr{Void}} : Ptr{typ})
-          push!(ret_arg_exps, Expr(:call, GlobalRef(Base, :pointer), Expr(:call, GlobalRef(Base, :arrayref), :ret_args, i)))
-          #push!(ret_arg_exps, Expr(:call, TopNode(:pointer), Expr(:call, TopNode(:arrayref), toRHSVar(:ret_args, Array{Any,1}, LambdaVarInfo), i)))
-      end
-  end
-  
-  @dprintln(2,"signature = ", signature, " -> ", ret_typs)
-  @dprintln(2,"modified_args = ", typeof(modified_args), " ", modified_args)
-  @dprintln(2,"extra_sig = ", extra_sig)
-  @dprintln(2,"ret_arg_exps = ", ret_arg_exps)
-  tuple_sig_expr = Expr(:tuple,Cint,modified_sig...,extra_sig...)
-  @dprintln(2,"tuple_sig_expr = ", tuple_sig_expr)
-  proxy_func = @eval function ($proxy_sym)($(original_args...))
-      # As we convert arrays into pointers that are stored in j2c_array objects, we remember in this
-      # dictionary a mapping between an array's data pointer and the array object itself.  Later,
-      # when processing arrays returned by the function, we see if some data pointer returned is
-      # equal to one of the pointers in the ptr_array_dict.  If so, then the C code has returned an
-      # array we passed to it as input and so from_j2c_array will get the original array from
-      # ptr_array_dict and will alias to the returned array.
-      ptr_array_dict = Dict{Ptr{Void},Array}()
-      #@dprintln(2,"Running proxy function.")
-      ret_args = Array{Any}($num_rets)
-      for i = 1:$num_rets
-        (t, is_array) = $(ret_typs)[i]
-        if is_array
-          t = Ptr{Void}
+
+    num_rets = length(ret_typs)
+    ret_arg_exps = Array{Any}(0)
+    extra_sig = Array{Type}(0)
+    # We special-case functions that return Void/nothing since it is common.
+    Void_return = (num_rets == 1 && ret_typs[1][1] == Void)
+    if !Void_return
+        for i = 1:num_rets
+            (typ, is_array) = ret_typs[i]
+            push!(extra_sig, is_array ? Ptr{Ptr{Void}} : Ptr{typ})
+            push!(ret_arg_exps, Expr(:call, GlobalRef(Base, :pointer), Expr(:call, GlobalRef(Base, :arrayref), :ret_args, i)))
+            #push!(ret_arg_exps, Expr(:call, TopNode(:pointer), Expr(:call, TopNode(:arrayref), toRHSVar(:ret_args, Array{Any,1}, LambdaVarInfo), i)))
         end
-        ret_args[i] = Array{t}(1) # hold return result
-      end
-      $(j2c_array) = [ $(extra_inits...) ]
-      #j2c_array_typs = Any[ typeof(x) for x in $(extra_inits...) ]
-      #@dprintln(3, "before ccall: ret_args = ", Any[$(ret_arg_exps...)])
-      #@dprintln(3, "before ccall: modified_args = ", Any[$(modified_args...)])
-      ccall(($j2c_name, $dyn_lib), Void, $tuple_sig_expr, $run_where, $(modified_args...), $(ret_arg_exps...))
-      result = Array{Any}($num_rets)
-      for i = 1:$num_rets
-        (t, is_array) = $(ret_typs)[i]
-        dprintln(3, "ret=", ret_args[i][1], "t=", t, " is_array=", is_array)
-        if is_array
-          if isStringType(t)
-             result[i] = convert(t, from_ascii_string(ret_args[i][1], ptr_array_dict))
+    end
+
+    @dprintln(2,"signature = ", signature, " -> ", ret_typs)
+    @dprintln(2,"modified_args = ", typeof(modified_args), " ", modified_args)
+    @dprintln(2,"extra_sig = ", extra_sig)
+    @dprintln(2,"ret_arg_exps = ", ret_arg_exps)
+    tuple_sig_expr = Expr(:tuple,Cint,modified_sig...,extra_sig...)
+    @dprintln(2,"tuple_sig_expr = ", tuple_sig_expr)
+    # Generated rand/randn are seeded from Julia's global RNG so that srand() makes them reproducible.
+    seed_rand = entry_uses_rand ? :(ccall((:cgen_rand_seed, $dyn_lib), Void, (UInt64,), Base.Random.rand(Base.Random.GLOBAL_RNG, UInt64))) : nothing
+    proxy_func = @eval function ($proxy_sym)($(original_args...))
+        # As we convert arrays into pointers that are stored in j2c_array objects, we remember in this
+        # dictionary a mapping between an array's data pointer and the array object itself.  Later,
+        # when processing arrays returned by the function, we see if some data pointer returned is
+        # equal to one of the pointers in the ptr_array_dict.  If so, then the C code has returned an
+        # array we passed to it as input and so from_j2c_array will get the original array from
+        # ptr_array_dict and will alias to the returned array.
+        ptr_array_dict = Dict{Ptr{Void},Array}()
+        #@dprintln(2,"Running proxy function.")
+        ret_args = Array{Any}($num_rets)
+        for i = 1:$num_rets
+          (t, is_array) = $(ret_typs)[i]
+          if is_array
+            t = Ptr{Void}
+          end
+          ret_args[i] = Array{t}(1) # hold return result
+        end
+        $(j2c_array) = [ $(extra_inits...) ]
+        $(j2c_csc) = Ptr{Void}[ $(csc_inits...) ]
+        $(j2c_bits) = Ptr{Void}[ $(bits_inits...) ]
+        #j2c_array_typs = Any[ typeof(x) for x in $(extra_inits...) ]
+        #@dprintln(3, "before ccall: ret_args = ", Any[$(ret_arg_exps...)])
+        #@dprintln(3, "before ccall: modified_args = ", Any[$(modified_args...)])
+        $seed_rand
+        ccall(($j2c_name, $dyn_lib), Void, $tuple_sig_expr, $run_where, $(modified_args...), $(ret_arg_exps...))
+        result = Array{Any}($num_rets)
+        for i = 1:$num_rets
+          (t, is_array) = $(ret_typs)[i]
+          dprintln(3, "ret=", ret_args[i][1], "t=", t, " is_array=", is_array)
+          if is_array
+            if isStringType(t)
+               result[i] = convert(t, from_ascii_string(ret_args[i][1], ptr_array_dict))
+            else
+               result[i] = from_j2c_array(ret_args[i][1], eltype(t), ndims(t), ptr_array_dict)
+               if isBitArrayType(t)
+                   result[i] = convert(BitArray, result[i])
+               end
+            end
           else
-             result[i] = from_j2c_array(ret_args[i][1], eltype(t), ndims(t), ptr_array_dict)
-             if isBitArrayType(t)
-                 result[i] = convert(BitArray, result[i])
-             end
+            result[i] = convert(t, (ret_args[i][1]))
           end
-        else
-          result[i] = convert(t, (ret_args[i][1]))
         end
+        # free j2c arrays FIXME: needs a better delete for nested arrays
+        for i = 1:length($(j2c_array))
+          j2c_array_delete($(j2c_array)[i])
+        end
+        for i = 1:length($(j2c_csc))
+          ccall((:j2c_csc_delete, $dyn_lib), Void, (Cint, Ptr{Void}), $(csc_keys)[i], $(j2c_csc)[i])
+        end
+        for i = 1:length($(j2c_bits))
+          ccall((:j2c_bits_delete, $dyn_lib), Void, (Ptr{Void},), $(j2c_bits)[i])
+        end
+        # If the function returns nothing then just force it here since cgen code can't return it.
+        return ($num_rets == 1 ? ($Void_return ? nothing : result[1]) : tuple(result...))
+    end
+
+    return proxy_func
+  end
+
+  fallback = async_compile ? getFallbackFunc(func) : nothing
+  if CGen.usePgo()
+    proxy = pgoProxy(func, outfile_name, build_proxy)
+  elseif fallback != nothing
+    build = CGen.deferred_compile_and_link(outfile_name)
+    proxy = asyncProxy(func, fallback, () -> build_proxy(build()))
+  else
+    proxy = build_proxy(CGen.compile_and_link(outfile_name))
+  end
+
+  array_args = find(t -> isa(t, DataType) && t <: Array, signature)
+  if shape_specialize && !CGen.usePgo() && !CGen.isDistributedMode() && !isempty(array_args)
+    generic = proxy
+    # Builds the proxy of a version of the code with the given sizes of the array arguments.
+    function specialize(shape)
+      shapes = Dict{Symbol,Array{Int,1}}(param_names[array_args[k]] => shape[k] for k in 1:length(array_args))
+      shape_name = CGen.writec(CGen.from_root_entry(deepcopy(shape_code), function_name_string, signature, array_types_in_sig, shapes))
+      @dprintln(1, "Specialized ", func, " for array sizes ", shape, " in ", shape_name)
+      if fallback != nothing
+        shape_build = CGen.deferred_compile_and_link(shape_name)
+        return asyncProxy(func, generic, () -> build_proxy(shape_build()))
       end
-      # free j2c arrays FIXME: needs a better delete for nested arrays
-      for i = 1:length($(j2c_array))
-        j2c_array_delete($(j2c_array)[i])
-      end
-      # If the function returns nothing then just force it here since cgen code can't return it.
-      return ($num_rets == 1 ? ($Void_return ? nothing : result[1]) : tuple(result...))
+      return build_proxy(CGen.compile_and_link(shape_name))
+    end
+    proxy = shapeProxy(func, generic, array_args, specialize)
   end
-  
+  cgen_proxies[(func, signature)] = proxy
+
   off_time = time_ns() - off_time_start
   @dprintln(1, "accelerate: accelerate conversion time = ", ns_to_sec(off_time))
-  return proxy_func
+  return proxy
 end
 
 function code_typed(func, signature)
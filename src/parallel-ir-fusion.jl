@@ -542,6 +542,90 @@ function fuse(body, body_index, cur::Expr, state)
     false
 end
 
+"""
+If "node" is a gemm_wrapper! or gemv! call, either as a statement or as the right-hand side of an assignment,
+return the call.  Otherwise, return nothing.
+"""
+function getGemmCall(node :: Expr)
+    call = isAssignmentNode(node) ? getRhsFromAssignment(node) : node
+    if isa(call, Expr) && (isCall(call) || isInvoke(call))
+        fun = getCallFunction(call)
+        if isBaseFunc(fun, :gemm_wrapper!) || isBaseFunc(fun, :gemv!)
+            return call
+        end
+    end
+    return nothing
+end
+
+function getGemmCall(node)
+    return nothing
+end
+
+"""
+Test whether the parfor "cur_parfor" is an elementwise epilogue of the gemm/gemv statement "gemm_node", i.e., whether
+it can be run on each panel of the product right after that panel is computed.  The parfor has to iterate over the
+output of the product, touch that output only at its own loop indices and not write any input of the product.
+"""
+function isGemmEpilogue(gemm_node, cur_parfor, state)
+    call = getGemmCall(gemm_node)
+    if call == nothing
+        return false
+    end
+    args = getCallArguments(call)
+    if !isa(args[1], RHSVar)
+        return false
+    end
+    out = toLHSVar(args[1])
+    outs = Set{LHSVar}([out])
+    if isAssignmentNode(gemm_node)
+        push!(outs, toLHSVar(getLhsFromAssignment(gemm_node)))
+    end
+    inputs = Set{LHSVar}([toLHSVar(x) for x in args[2:end] if isa(x, RHSVar)])
+    out_typ = CompilerTools.LambdaHandling.getType(out, state.LambdaVarInfo)
+
+    if !(out_typ <: AbstractArray) || length(cur_parfor.loopNests) != ndims(out_typ)
+        @dprintln(3, "Not a gemm epilogue because the parfor has a different number of dimensions.")
+        return false
+    end
+    # Reductions would be restarted for every panel.
+    if !isempty(cur_parfor.reductions)
+        @dprintln(3, "Not a gemm epilogue because the parfor has reductions.")
+        return false
+    end
+    in_correlation = getParforCorrelation(cur_parfor, state)
+    if in_correlation == nothing || in_correlation != getOrAddArrayCorrelation(out, state)
+        @dprintln(3, "Not a gemm epilogue because the parfor doesn't iterate over the product.")
+        return false
+    end
+    if !isempty(intersect(cur_parfor.arrays_read_past_index, outs)) || !isempty(intersect(cur_parfor.arrays_written_past_index, outs))
+        @dprintln(3, "Not a gemm epilogue because the parfor accesses the product in a non-simple way.")
+        return false
+    end
+
+    cur_rws = CompilerTools.ReadWriteSet.from_exprs(cur_parfor.body, pir_rws_cb, state.LambdaVarInfo, state.LambdaVarInfo)
+    if !isempty(intersect(Set{LHSVar}(keys(cur_rws.writeSet.arrays)), inputs))
+        @dprintln(3, "Not a gemm epilogue because the parfor writes an input of the product.")
+        return false
+    end
+    num_dims = length(cur_parfor.loopNests)
+    for rw in [cur_rws.readSet.arrays, cur_rws.writeSet.arrays]
+        for o in intersect(Set{LHSVar}(keys(rw)), outs)
+            for index_expr in rw[o]
+                if length(index_expr) != num_dims
+                    return false
+                end
+                for index = 1:num_dims
+                    if !compareIndex(cur_parfor.loopNests[num_dims + 1 - index].indexVariable, index_expr[index])
+                        @dprintln(3, "Not a gemm epilogue because the product is indexed with ", index_expr)
+                        return false
+                    end
+                end
+            end
+        end
+    end
+    return true
+end
+
 """
 Performs the mmap to mmap! phase.
 If the arguments of a mmap dies aftewards, and is not aliased, then
@@ -1089,6 +1089,153 @@ function create_mmap!_post_statements(input_arrays, dl, state)
     return post_statements
 end
 
+type ScatterUseState
+    uses   :: Dict{LHSVar,Int}
+    opaque :: Bool   # body has nested lambdas whose uses are not counted
+end
+
+function count_scatter_uses(x :: RHSVar, state :: ScatterUseState, top_level_number, is_top_level, read)
+    if read
+        v = toLHSVar(x)
+        state.uses[v] = get(state.uses, v, 0) + 1
+    end
+    return CompilerTools.AstWalker.ASTWALK_RECURSE
+end
+
+function count_scatter_uses(x :: DomainLambda, state :: ScatterUseState, top_level_number, is_top_level, read)
+    state.opaque = true
+    return x
+end
+
+function count_scatter_uses(x :: ANY, state :: ScatterUseState, top_level_number, is_top_level, read)
+    return CompilerTools.AstWalker.ASTWALK_RECURSE
+end
+
+function isScatterAddFunc(f)
+    isBaseFunc(f, :+) || isBaseFunc(f, :add_int) || isBaseFunc(f, :add_float) ||
+        (isa(f, GlobalRef) && f.mod == Core.Intrinsics && (f.name == :add_int || f.name == :add_float))
+end
+
+"""
+The value a lambda body returns, looked up through the temporaries the body assigns.
+"""
+function scatterResult(body :: Array{Any,1})
+    ret = isempty(body) ? nothing : body[end]
+    if isa(ret, Expr) && (ret.head == :tuple || ret.head == :return) && length(ret.args) == 1
+        ret = ret.args[1]
+    end
+    while isa(ret, RHSVar)
+        v = toLHSVar(ret)
+        i = findlast(s -> isAssignmentNode(s) && isa(s.args[1], RHSVar) && toLHSVar(s.args[1]) == v, body)
+        if i == 0
+            break
+        end
+        ret = body[i].args[2]
+    end
+    return ret
+end
+
+"""
+Does a reduction function combine its operands by addition?
+Only the operator producing the result counts (or, for an element-wise combine, the one producing the
+result of the nested lambda), so additions in index arithmetic elsewhere in the function do not.
+"""
+function hasScatterAddOp(x :: DomainLambda)
+    ret = scatterResult(x.body.args)
+    if isa(ret, Expr) && (ret.head == :mmap || ret.head == :mmap!) && length(ret.args) >= 2
+        return hasScatterAddOp(ret.args[2])
+    end
+    return isa(ret, Expr) && isCall(ret) && (isScatterAddFunc(getCallFunction(ret)) || isBaseFunc(getCallFunction(ret), :.+))
+end
+
+hasScatterAddOp(x :: ANY) = false
+
+"""
+Look through a single-use temporary to the expression that defines it.
+Returns the expression and the index of its defining statement in the body (0 if x is already an expression).
+"""
+function scatterOperand(x :: RHSVar, defs, uses)
+    v = toLHSVar(x)
+    if haskey(defs, v) && get(uses, v, 0) == 1
+        (i, rhs) = defs[v]
+        return rhs, i
+    end
+    return nothing, 0
+end
+
+scatterOperand(x :: Expr, defs, uses) = (x, 0)
+scatterOperand(x :: ANY, defs, uses) = (nothing, 0)
+
+sameScatterIndex(a :: RHSVar, b :: RHSVar) = toLHSVar(a) == toLHSVar(b)
+sameScatterIndex(a :: ANY, b :: ANY) = a == b
+
+"""
+Recognize an array reduction of a parallel_for whose body only ever updates the array as
+acc[j...] = acc[j...] + e, i.e., a scatter-accumulate such as a histogram or a bincount.
+Each such read-add-write is replaced by a single call to scatter_add! and true is returned;
+otherwise the body is left untouched and false is returned.
+"""
+function convertScatterReduction!(body :: Array{Any,1}, redvar :: RHSVar, redfunc, state)
+    redtyp = CompilerTools.LambdaHandling.getType(redvar, state.LambdaVarInfo)
+    if !(redtyp <: Array) || !(eltype(redtyp) <: Real) || eltype(redtyp) == Bool || !hasScatterAddOp(redfunc)
+        return false
+    end
+    acc = toLHSVar(redvar)
+    sus = ScatterUseState(Dict{LHSVar,Int}(), false)
+    for stmt in body
+        AstWalk(stmt, count_scatter_uses, sus)
+    end
+    if sus.opaque
+        return false
+    end
+    defs = Dict{LHSVar,Tuple{Int,Any}}()
+    for i = 1:length(body)
+        if isAssignmentNode(body[i]) && isa(body[i].args[1], RHSVar)
+            defs[toLHSVar(body[i].args[1])] = (i, body[i].args[2])
+        end
+    end
+    updates = Tuple{Int,Any}[]
+    dead = Int[]
+    for i = 1:length(body)
+        stmt = body[i]
+        if !isArraysetCall(stmt) || !isa(stmt.args[2], RHSVar) || toLHSVar(stmt.args[2]) != acc
+            continue
+        end
+        idx = stmt.args[4:end]
+        (addexpr, add_def) = scatterOperand(stmt.args[3], defs, sus.uses)
+        if !isCall(addexpr) || !isScatterAddFunc(getCallFunction(addexpr)) || length(getCallArguments(addexpr)) != 2
+            return false
+        end
+        found = false
+        for (k, opnd) in enumerate(getCallArguments(addexpr))
+            (readexpr, read_def) = scatterOperand(opnd, defs, sus.uses)
+            if isArrayrefCall(readexpr) && isa(readexpr.args[2], RHSVar) && toLHSVar(readexpr.args[2]) == acc &&
+               length(readexpr.args) == length(stmt.args) - 1 && all(map(sameScatterIndex, readexpr.args[3:end], idx)) &&
+               read_def < i && add_def < i
+                delta = getCallArguments(addexpr)[3 - k]
+                push!(updates, (i, TypedExpr(Void, :call, GlobalRef(ParallelAccelerator.ParallelIR, :scatter_add!), stmt.args[2], delta, idx...)))
+                read_def > 0 && push!(dead, read_def)
+                add_def > 0 && push!(dead, add_def)
+                found = true
+                break
+            end
+        end
+        if !found
+            return false
+        end
+    end
+    # The accumulator must not be read or written anywhere but in the updates found above.
+    if isempty(updates) || get(sus.uses, acc, 0) != 2 * length(updates)
+        return false
+    end
+    @dprintln(3, "convertScatterReduction! found ", length(updates), " scatter updates of ", acc)
+    for (i, upd) in updates
+        body[i] = upd
+    end
+    deleteat!(body, sort(unique(dead)))
+    return true
+end
+
 function mk_parfor_args_from_parallel_for(args :: Array{Any,1}, state)
     @assert length(args[1]) == length(args[2])
     # Create empty arrays to hold pre and post statements.
@@ -1134,6 +1281,9 @@ function mk_parfor_args_from_parallel_for(args :: Array{Any,1}, state)
     if isa(out_body[end], Expr) && (out_body[end].head == :tuple)
         pop!(out_body)
     end
+    for i = 1:length(reductions)
+        reductions[i].scatter = convertScatterReduction!(out_body, reductions[i].reductionVar, args[i+3][3], state)
+    end
     loopNests = Array{PIRLoopNest}(n_loops)
     rearray = RangeExprs[]
     # Insert a statement to assign the length of the input arrays to a var
@@ -25,6 +25,15 @@ THE POSSIBILITY OF SUCH DAMAGE.
 
 import ..DomainIR
 
+stencil_block_steps = 0
+"""
+If set to an odd number greater than one, iterated two-buffer stencils advance that many iterations at a time
+on overlapping tiles of the outermost dimension, so that a tile stays in cache across the iterations.
+"""
+function PIRStencilBlocking(x :: Int)
+    global stencil_block_steps = x
+end
+
 function relabel(exprs::Array{Any}, irState)
   labelDict = Dict{Int, Int}()
   for i = 1:length(exprs)
@@ -76,20 +85,488 @@ function simplifyBodyExpr(kernelF, state)
     return LambdaVarInfo, body
 end
 
+min_int_expr(x, y) = TypedExpr(Int, :call, GlobalRef(Base, :select_value),
+                        DomainIR.box_ty(Bool, Expr(:call, GlobalRef(Base, :sle_int), x, y)), deepcopy(x), deepcopy(y))
+max_int_expr(x, y) = min_int_expr(y, x)
+
+"""
+Returns the tests that an index into a stencil buffer of the given sizes is not on its border,
+i.e., that the stencil kernel centered there only reads within the buffer.
+"""
+function mk_stencil_interior_tests(stat, idxNodes, sizeNodes)
+  n = stat.dimension
+  lowerExprs = [ DomainIR.box_ty(Bool, Expr(:call, GlobalRef(Base, :sle_int), 1-stat.shapeMin[i], deepcopy(idxNodes[i])))
+                 for i in 1:n ]
+  upperExprs = [ DomainIR.box_ty(Bool, Expr(:call, GlobalRef(Base, :sle_int), deepcopy(idxNodes[i]),
+                      DomainIR.sub_expr(sizeNodes[i], stat.shapeMax[i])))
+                 for i in 1:n ]
+  return vcat(lowerExprs, upperExprs)
+end
+
+"""
+Returns the loop nests of the border of an array whose sizes are in sizeNodes, i.e., where the stencil would
+read out of bounds, as one box per dimension d and side that does not overlap the others: its index d is within
+the band at that side, the indices of the dimensions after d are within the interior and the others are not
+constrained.  Only the border has to pay for the bounds handling, the interior loop nest needs none.
+If outerNest is given, it replaces the interior range of the outermost dimension, which then has no band.
+"""
+function mk_stencil_border_nests(stat, idxNodes, sizeNodes, outerNest = nothing)
+  local n = stat.dimension
+  local nests = Array{PIRLoopNest,1}[]
+  for d = (outerNest == nothing ? n : n - 1):-1:1
+    for high in (false, true)
+      if (high ? stat.shapeMax[d] : -stat.shapeMin[d]) == 0
+        continue
+      end
+      # the upper band starts after the lower band, should they overlap in a small array
+      band = high ? PIRLoopNest(idxNodes[d],
+                                DomainIR.add_expr(max_int_expr(DomainIR.sub_expr(sizeNodes[d], stat.shapeMax[d]), -stat.shapeMin[d]), 1),
+                                sizeNodes[d], 1) :
+                    PIRLoopNest(idxNodes[d], 1, min_int_expr(-stat.shapeMin[d], sizeNodes[d]), 1)
+      push!(nests, PIRLoopNest[ i == n && outerNest != nothing ? deepcopy(outerNest) :
+                                i > d ? PIRLoopNest(idxNodes[i], 1-stat.shapeMin[i], DomainIR.sub_expr(sizeNodes[i], stat.shapeMax[i]), 1) :
+                                i == d ? band : PIRLoopNest(idxNodes[i], 1, sizeNodes[i], 1)
+                                for i = n:-1:1 ])
+    end
+  end
+  return nests
+end
+
+"""
+Returns the parfors that handle the border of one stencil sweep over bufs, whose sizes are in sizeNodes,
+given the kernel body and the loop nests of the border, see mk_stencil_border_nests.  :oob_skip has no
+border parfor.
+"""
+function mk_stencil_border(stat, head, bodyExpr, borderNests, sizeNodes, bufs, linfo, irState)
+  local n = stat.dimension
+  local oob_skip = (stat.borderSty === :oob_skip)
+  local oob_dst_zero = (stat.borderSty === :oob_dst_zero)
+  local oob_src_zero = (stat.borderSty === :oob_src_zero)
+  local oob_wraparound = (stat.borderSty === :oob_wraparound)
+  borderExpr = Any[]
+  if oob_dst_zero
+    for expr in bodyExpr
+      expr = deepcopy(expr)
+      if (expr.head === :call) && isBaseFunc(expr.args[1], :unsafe_arrayset)
+        zero = Base.convert(DomainIR.elmTypOf(getType(expr.args[2], linfo)), 0)
+        push!(borderExpr, TypedExpr(expr.typ, :call, expr.args[1], expr.args[2], zero, expr.args[4:end]...))
+      end
+    end
+  elseif oob_src_zero
+    for expr in bodyExpr
+      expr = deepcopy(expr)
+      if isa(expr, Expr) && (expr.head === :(=))
+        lhs = expr.args[1]
+        rhs = expr.args[2]
+        if isa(rhs, Expr) && (rhs.head === :call) && isBaseFunc(rhs.args[1], :unsafe_arrayref)
+          zero = Base.convert(rhs.typ, 0)
+          expr = TypedExpr(expr.typ, :(=), lhs,
+                  TypedExpr(rhs.typ, :call, GlobalRef(Base, :safe_arrayref),
+                      rhs.args[2], zero, rhs.args[3:end]...))
+        end
+      end
+      push!(borderExpr, expr)
+    end
+  elseif oob_wraparound
+    for expr in bodyExpr
+      expr = deepcopy(expr)
+      if isa(expr, Expr) && (expr.head === :(=))
+        lhs = expr.args[1]
+        rhs = expr.args[2]
+        if isa(rhs, Expr) && (rhs.head === :call) && isBaseFunc(rhs.args[1], :unsafe_arrayref)
+          indices = Expr[ TypedExpr(Int, :call, GlobalRef(Base, :select_value),
+                            DomainIR.box_ty(Bool, Expr(:call, GlobalRef(Base, :sle_int), deepcopy(rhs.args[2+i]), 0)),
+                            DomainIR.add_expr(deepcopy(rhs.args[2+i]), sizeNodes[i]),
+                            TypedExpr(Int, :call, GlobalRef(Base, :select_value),
+                              DomainIR.box_ty(Bool, Expr(:call, GlobalRef(Base, :sle_int),
+                                DomainIR.add_expr(sizeNodes[i], 1), deepcopy(rhs.args[2+i]))),
+                              DomainIR.sub_expr(deepcopy(rhs.args[2+i]), sizeNodes[i]),
+                              deepcopy(rhs.args[2+i]))) for i = 1:n ]
+          expr = TypedExpr(expr.typ, :(=), lhs,
+                  TypedExpr(rhs.typ, :call, GlobalRef(Base, :unsafe_arrayref),
+                      rhs.args[2], indices...))
+        end
+      end
+      push!(borderExpr, expr)
+    end
+  else #FIXME: the following is to make a dummy node to avoid an IR bug
+#    push!(borderExpr, TypedExpr(Int, :(=), idxNodes[1].name, idxNodes[1]))
+  end
+  borderCond = oob_skip ? Any[] : Any[TypedExpr(Void, head,
+        PIRParForAst(InputInfo(toLHSVar(bufs[1])),
+            relabel(deepcopy(borderExpr), irState),
+            [],
+            [],
+            nests,
+            PIRReduction[],
+            [], [], irState.top_level_number, get_unique_num(), Set{LHSVar}(), Set{LHSVar}([toLHSVar(x) for x in bufs])))
+        for nests in borderNests ]
+  return borderCond
+end
+
+"""
+Whether the kernel body, instantiated for bufs and idxNodes, can be temporally blocked: it only writes
+the first buffer, and only at the cursor, and only reads the second buffer, of the same type.
+"""
+function stencil_blockable(stat, bodyExpr, bufs, idxNodes, linfo)
+  if length(bufs) != 2 || stat.dimension > 3 || stat.borderSty === :oob_wraparound ||
+     getType(bufs[1], linfo) != getType(bufs[2], linfo) ||
+     ParallelAccelerator.getPseMode() == ParallelAccelerator.THREADS_MODE
+    return false
+  end
+  dst = toLHSVar(bufs[1])
+  for expr in bodyExpr
+    if !stencil_blockable_expr(expr, dst, idxNodes)
+      return false
+    end
+  end
+  return true
+end
+
+function stencil_blockable_expr(expr :: Expr, dst, idxNodes)
+  if (expr.head === :call) && (isBaseFunc(expr.args[1], :unsafe_arrayref) || isBaseFunc(expr.args[1], :safe_arrayref)) &&
+     isa(expr.args[2], RHSVar) && toLHSVar(expr.args[2]) == dst
+    return false
+  end
+  if (expr.head === :call) && isBaseFunc(expr.args[1], :unsafe_arrayset) && isa(expr.args[2], RHSVar) && toLHSVar(expr.args[2]) == dst
+    if length(expr.args) != 3 + length(idxNodes)
+      return false
+    end
+    for i = 1:length(idxNodes)
+      if !isa(expr.args[3+i], RHSVar) || toLHSVar(expr.args[3+i]) != toLHSVar(idxNodes[i])
+        return false
+      end
+    end
+  end
+  for arg in expr.args
+    if !stencil_blockable_expr(arg, dst, idxNodes)
+      return false
+    end
+  end
+  return true
+end
+
+stencil_blockable_expr(expr, dst, idxNodes) = true
+
+"""
+Temporal blocking of an iterated stencil whose kernel writes bufs[1] from bufs[2] and then swaps them.
+The outermost dimension is cut into tiles.  For each tile, a parfor iteration copies the tile plus a halo
+wide enough for the given number of steps into two private slabs, runs the steps on the slabs, writes
+the tile back into bufs[1] and the buffers are swapped once (the step count is odd).  The halo is
+recomputed by neighbouring tiles, but cells that a wrong value near the cut of a slab can reach in that
+many steps are outside the tile.  Returns the statements for the blocked iterations and the number of
+iterations, at least one, left for the regular sweeps so that both buffers end up as without blocking.
+"""
+function mk_stencil_blocks(stat, head, iterations, bufs, sizeNodes, strideNodes, rotateExpr, bodyLinfo, kernelBody, linfo, irState)
+  local steps = iseven(stencil_block_steps) ? stencil_block_steps - 1 : stencil_block_steps
+  if steps <= 1 || (isa(iterations, Number) && iterations <= steps)
+    return Any[], iterations
+  end
+  local n = stat.dimension
+  local oob_skip = (stat.borderSty === :oob_skip)
+  local dst = bufs[1]
+  local src = bufs[2]
+  local elmTyp = DomainIR.elmTypOf(getType(dst, linfo))
+  local arrTyp = Array{elmTyp, n}
+  local haloLo = -stat.shapeMin[n] * steps
+  local haloHi = stat.shapeMax[n] * steps
+  local width = max(8, 4 * (haloLo + haloHi))
+  local iterNode = addTempVariable(Int, linfo)
+  local blocksNode = addTempVariable(Int, linfo)
+  local tailNode = addTempVariable(Int, linfo)
+  local tilesNode = addTempVariable(Int, linfo)
+  local blockNode = DomainIR.addFreshLocalVariable("block", Int, ISASSIGNED | ISASSIGNEDONCE, linfo)
+  local tileNode = DomainIR.addFreshLocalVariable("tile", Int, ISASSIGNED | ISASSIGNEDONCE, linfo)
+  local idxNodes = Any[ DomainIR.addFreshLocalVariable(string("j",s.id), Int, ISASSIGNED | ISASSIGNEDONCE, linfo) for s in stat.idxSym ]
+  # the tile is planes [lo, hi] of the outermost dimension, its slab is planes [lo - haloLo, hi + haloHi] within the
+  # array, and off is the offset from slab to array index
+  local loNode = addTempVariable(Int, linfo)
+  local hiNode = addTempVariable(Int, linfo)
+  local slabLoNode = addTempVariable(Int, linfo)
+  local slabHiNode = addTempVariable(Int, linfo)
+  local lenNode = addTempVariable(Int, linfo)
+  local offNode = addTempVariable(Int, linfo)
+  local slabs = [ DomainIR.addFreshLocalVariable("slab", arrTyp, ISASSIGNED | getLoopPrivateFlags(), linfo) for i = 1:2 ]
+  local slabSizes = Any[ sizeNodes[1:n-1]..., lenNode ]
+  tileBody = Any[
+    TypedExpr(Int, :(=), loNode, DomainIR.add_expr(DomainIR.mul_expr(DomainIR.sub_expr(tileNode, 1), width), 1)),
+    TypedExpr(Int, :(=), hiNode, min_int_expr(DomainIR.mul_expr(tileNode, width), sizeNodes[n])),
+    TypedExpr(Int, :(=), slabLoNode, max_int_expr(DomainIR.sub_expr(loNode, haloLo), 1)),
+    TypedExpr(Int, :(=), slabHiNode, min_int_expr(DomainIR.add_expr(hiNode, haloHi), sizeNodes[n])),
+    TypedExpr(Int, :(=), lenNode, DomainIR.add_expr(DomainIR.sub_expr(slabHiNode, slabLoNode), 1)),
+    TypedExpr(Int, :(=), offNode, DomainIR.sub_expr(slabLoNode, 1)),
+    TypedExpr(arrTyp, :(=), toLHSVar(slabs[1]), mk_alloc_array_expr(elmTyp, arrTyp, slabSizes...)),
+    TypedExpr(arrTyp, :(=), toLHSVar(slabs[2]), mk_alloc_array_expr(elmTyp, arrTyp, slabSizes...)),
+  ]
+  # copy the slab of the source into the first slab, and for :oob_skip, the border cells of the destination,
+  # which no iteration writes, into the second slab
+  globalNode = addTempVariable(Int, linfo)
+  srcElem = addTempVariable(elmTyp, linfo)
+  outer = Any[ idxNodes[1:n-1]..., globalNode ]
+  copyBody = Any[
+    TypedExpr(Int, :(=), globalNode, DomainIR.add_expr(idxNodes[n], offNode)),
+    TypedExpr(elmTyp, :(=), srcElem, TypedExpr(elmTyp, :call, GlobalRef(Base, :unsafe_arrayref), src, outer...)),
+    TypedExpr(arrTyp, :call, GlobalRef(Base, :unsafe_arrayset), slabs[1], srcElem, idxNodes...),
+  ]
+  if oob_skip
+    borderLabel = next_label(irState)
+    afterBorderLabel = next_label(irState)
+    dstElem = addTempVariable(elmTyp, linfo)
+    append!(copyBody, [ Expr(:gotoifnot, e, borderLabel) for e in mk_stencil_interior_tests(stat, outer, sizeNodes) ])
+    append!(copyBody, Any[
+      GotoNode(afterBorderLabel),
+      LabelNode(borderLabel),
+      TypedExpr(elmTyp, :(=), dstElem, TypedExpr(elmTyp, :call, GlobalRef(Base, :unsafe_arrayref), dst, deepcopy(outer)...)),
+      TypedExpr(arrTyp, :call, GlobalRef(Base, :unsafe_arrayset), slabs[2], dstElem, idxNodes...),
+      LabelNode(afterBorderLabel),
+    ])
+  end
+  push!(tileBody, TypedExpr(Void, head,
+        PIRParForAst(InputInfo(toLHSVar(slabs[1])),
+            copyBody, [], [],
+            [ PIRLoopNest(idxNodes[i], 1, slabSizes[i], 1) for i = n:-1:1 ],
+            PIRReduction[],
+            [], [], irState.top_level_number, get_unique_num(), Set{LHSVar}(), Set{LHSVar}([toLHSVar(src)]))))
+  # the steps alternate between the slabs, ending in the second one
+  for step = 1:steps
+    slabBufs = isodd(step) ? Any[ slabs[2], slabs[1] ] : Any[ slabs[1], slabs[2] ]
+    slabExpr = relabel(DomainIR.stencilGenBody(stat, bodyLinfo, kernelBody, idxNodes, strideNodes, slabBufs, linfo, getLoopPrivateFlags()), irState)
+    slabExpr = slabExpr[1:end-1]
+    append!(tileBody, mk_stencil_border(stat, head, slabExpr, mk_stencil_border_nests(stat, idxNodes, slabSizes),
+                                        slabSizes, slabBufs, linfo, irState))
+    push!(tileBody, TypedExpr(Void, head,
+          PIRParForAst(InputInfo(toLHSVar(slabBufs[1])),
+              slabExpr, [], [],
+              [ PIRLoopNest(idxNodes[i], 1-stat.shapeMin[i], DomainIR.sub_expr(slabSizes[i], stat.shapeMax[i]), 1) for i = n:-1:1 ],
+              PIRReduction[],
+              [], [], irState.top_level_number, get_unique_num(), Set{LHSVar}(), Set{LHSVar}([toLHSVar(slabBufs[2])]))))
+  end
+  # write the tile back, for :oob_skip without the border cells
+  writeLoNode = addTempVariable(Int, linfo)
+  writeHiNode = addTempVariable(Int, linfo)
+  slabNode = addTempVariable(Int, linfo)
+  slabElem = addTempVariable(elmTyp, linfo)
+  append!(tileBody, Any[
+    TypedExpr(Int, :(=), writeLoNode, oob_skip ? max_int_expr(loNode, 1-stat.shapeMin[n]) : loNode),
+    TypedExpr(Int, :(=), writeHiNode, oob_skip ? min_int_expr(hiNode, DomainIR.sub_expr(sizeNodes[n], stat.shapeMax[n])) : hiNode),
+  ])
+  writeBody = Any[
+    TypedExpr(Int, :(=), slabNode, DomainIR.sub_expr(idxNodes[n], offNode)),
+    TypedExpr(elmTyp, :(=), slabElem, TypedExpr(elmTyp, :call, GlobalRef(Base, :unsafe_arrayref), slabs[2], idxNodes[1:n-1]..., slabNode)),
+    TypedExpr(arrTyp, :call, GlobalRef(Base, :unsafe_arrayset), dst, slabElem, idxNodes...),
+  ]
+  writeNest = PIRLoopNest[ PIRLoopNest(idxNodes[i],
+                            oob_skip ? 1-stat.shapeMin[i] : 1,
+                            oob_skip ? DomainIR.sub_expr(sizeNodes[i], stat.shapeMax[i]) : sizeNodes[i],
+                            1)
+                for i = n-1:-1:1 ]
+  push!(tileBody, TypedExpr(Void, head,
+        PIRParForAst(InputInfo(toLHSVar(dst)),
+            writeBody, [], [],
+            vcat(PIRLoopNest(idxNodes[n], writeLoNode, writeHiNode, 1), writeNest),
+            PIRReduction[],
+            [], [], irState.top_level_number, get_unique_num(), Set{LHSVar}(), Set{LHSVar}([toLHSVar(slabs[2])]))))
+
+  tileInput = InputInfo()
+  tileInput.range = DimensionSelector[ RangeData(RangeExprs(1, 1, tilesNode)) ]
+  tileParfor = PIRParForAst(tileInput,
+            tileBody, [], [],
+            [ PIRLoopNest(tileNode, 1, tilesNode, 1) ],
+            PIRReduction[],
+            [], [], irState.top_level_number, get_unique_num(),
+            Set{LHSVar}([toLHSVar(dst)]), Set{LHSVar}([toLHSVar(x) for x in bufs]))
+  blockExpr = Any[
+    TypedExpr(Int, :(=), iterNode, iterations),
+    TypedExpr(Int, :(=), blocksNode, DomainIR.sdiv_int_expr(DomainIR.sub_expr(iterNode, 1), steps)),
+    TypedExpr(Int, :(=), tailNode, DomainIR.sub_expr(iterNode, DomainIR.mul_expr(blocksNode, steps))),
+    TypedExpr(Int, :(=), tilesNode, DomainIR.sdiv_int_expr(DomainIR.add_expr(sizeNodes[n], width - 1), width)),
+    Expr(:loophead, blockNode, 1, blocksNode),
+    TypedExpr(Void, head, tileParfor),
+    deepcopy(rotateExpr)...,
+    Expr(:loopend, blockNode) ]
+  return blockExpr, tailNode
+end
+
+"""
+Ghost plane exchange of a distributed stencil buffer, see mk_stencil_distributed.  CGen compiles calls to these
+into the MPI runtime, they are never run in Julia.
+"""
+stencil_halo_start(a, lo, hi, periodic) = error("stencil_halo_start is only supported in distributed mode")
+stencil_halo_finish() = error("stencil_halo_finish is only supported in distributed mode")
+stencil_halo_lower_edge() = error("stencil_halo_lower_edge is only supported in distributed mode")
+stencil_halo_upper_edge() = error("stencil_halo_upper_edge is only supported in distributed mode")
+
+stencil_reads_buf(expr :: Expr, buf) = ((expr.head === :call) && isBaseFunc(expr.args[1], :unsafe_arrayref) &&
+                                        isa(expr.args[2], RHSVar) && toLHSVar(expr.args[2]) == buf) ||
+                                       any(a -> stencil_reads_buf(a, buf), expr.args)
+stencil_reads_buf(expr, buf) = false
+
+"""
+Whether the stencil is lowered for distributed mode: its kernel reads across the outermost dimension and the
+buffers are only rotated among themselves.
+"""
+function stencil_distributed(stat, bufs, rets)
+  local n = stat.dimension
+  if !ParallelAccelerator.CGen.isDistributedMode() || n > 3 || (stat.shapeMin[n] == 0 && stat.shapeMax[n] == 0)
+    return false
+  end
+  local bufVars = [ toLHSVar(x) for x in bufs ]
+  return all(r -> isa(r, RHSVar) && in(toLHSVar(r), bufVars), rets)
+end
+
+"""
+runStencil in distributed mode, where every rank holds a block of the outermost dimension of the global buffers,
+the blocks in rank order.  The buffers are copied into ones extended by as many ghost planes before and after
+as the kernel reaches back and forth in that dimension.  Every iteration starts the exchange of the ghost planes
+of the buffers the kernel reads with the neighbouring ranks, runs the planes that need no ghost meanwhile, waits
+and runs the rest.  At the outer border of the first and the last rank, :oob_wraparound exchanges with the other
+one and :oob_src_zero has ghosts of zero, so that the ghost planes handle that border, whereas :oob_skip and
+:oob_dst_zero leave those ranks' border planes out of the sweep as without distribution.
+"""
+function mk_stencil_distributed(typ, head, args, iterations, bufs, rets, idxNodes, sizeNodes, rotateExpr,
+                                bodyLinfo, kernelBody, linfo, irState)
+  local stat = args[1]
+  local n = stat.dimension
+  local nbufs = length(bufs)
+  local haloLo = -stat.shapeMin[n]
+  local haloHi = stat.shapeMax[n]
+  local oob_dst_zero = (stat.borderSty === :oob_dst_zero)
+  local ghostBorder = (stat.borderSty === :oob_src_zero) || (stat.borderSty === :oob_wraparound)
+  local extSizes = Any[ sizeNodes[1:n-1]..., addTempVariable(Int, linfo) ]
+  local extStrides = [ addTempVariable(Int, linfo) for i = 1:n ]
+  local elmTyps = [ DomainIR.elmTypOf(getType(x, linfo)) for x in bufs ]
+  local exts = [ DomainIR.addFreshLocalVariable("ext", Array{elmTyps[i], n}, ISASSIGNED, linfo) for i = 1:nbufs ]
+  local extTmps = [ DomainIR.addFreshLocalVariable("tmp", Array{elmTyps[i], n}, ISASSIGNED, linfo) for i = 1:nbufs ]
+  preExpr = Any[
+    TypedExpr(Int, :(=), extSizes[n], DomainIR.add_expr(sizeNodes[n], haloLo + haloHi)),
+    TypedExpr(Int, :(=), extStrides[1], 1),
+  ]
+  for i = 2:n
+    push!(preExpr, TypedExpr(Int, :(=), extStrides[i], DomainIR.mul_expr(extStrides[i-1], extSizes[i-1])))
+  end
+  for i = 1:nbufs
+    push!(preExpr, TypedExpr(Array{elmTyps[i], n}, :(=), toLHSVar(exts[i]), mk_alloc_array_expr(elmTyps[i], Array{elmTyps[i], n}, extSizes...)))
+  end
+  # copy the buffers into the own planes of the extended ones, and back at the end
+  planeNode = addTempVariable(Int, linfo)
+  inBody = Any[ TypedExpr(Int, :(=), planeNode, DomainIR.add_expr(idxNodes[n], haloLo)) ]
+  outBody = Any[ deepcopy(inBody[1]) ]
+  for i = 1:nbufs
+    elem = addTempVariable(elmTyps[i], linfo)
+    append!(inBody, Any[
+      TypedExpr(elmTyps[i], :(=), elem, TypedExpr(elmTyps[i], :call, GlobalRef(Base, :unsafe_arrayref), bufs[i], idxNodes...)),
+      TypedExpr(Array{elmTyps[i], n}, :call, GlobalRef(Base, :unsafe_arrayset), exts[i], elem, idxNodes[1:n-1]..., planeNode) ])
+    elem = addTempVariable(elmTyps[i], linfo)
+    append!(outBody, Any[
+      TypedExpr(elmTyps[i], :(=), elem, TypedExpr(elmTyps[i], :call, GlobalRef(Base, :unsafe_arrayref), exts[i], idxNodes[1:n-1]..., planeNode)),
+      TypedExpr(Array{elmTyps[i], n}, :call, GlobalRef(Base, :unsafe_arrayset), bufs[i], elem, idxNodes...) ])
+  end
+  copyNest = [ PIRLoopNest(idxNodes[i], 1, sizeNodes[i], 1) for i = n:-1:1 ]
+  push!(preExpr, TypedExpr(Void, head,
+        PIRParForAst(InputInfo(toLHSVar(bufs[1])),
+            inBody, [], [], deepcopy(copyNest),
+            PIRReduction[],
+            [], [], irState.top_level_number, get_unique_num(), Set{LHSVar}(), Set{LHSVar}([toLHSVar(x) for x in bufs]))))
+  copyOut = TypedExpr(Void, head,
+        PIRParForAst(InputInfo(toLHSVar(bufs[1])),
+            outBody, [], [], copyNest,
+            PIRReduction[],
+            [], [], irState.top_level_number, get_unique_num(), Set{LHSVar}(), Set{LHSVar}([toLHSVar(x) for x in exts])))
+
+  # the planes of the outermost dimension that the sweep computes, those of them that need no ghost plane, and
+  # the rims before and after the latter
+  local computeLo = addTempVariable(Int, linfo)
+  local computeHi = addTempVariable(Int, linfo)
+  local innerHi = addTempVariable(Int, linfo)
+  local rimLoEnd = addTempVariable(Int, linfo)
+  local rimHiStart = addTempVariable(Int, linfo)
+  local innerLo = 2 * haloLo + 1
+  local ownHi = addTempVariable(Int, linfo)
+  push!(preExpr, TypedExpr(Int, :(=), ownHi, DomainIR.add_expr(sizeNodes[n], haloLo)))
+  if ghostBorder
+    append!(preExpr, Any[
+      TypedExpr(Int, :(=), computeLo, haloLo + 1),
+      TypedExpr(Int, :(=), computeHi, ownHi) ])
+  else
+    lowerEdge = addTempVariable(Bool, linfo)
+    upperEdge = addTempVariable(Bool, linfo)
+    append!(preExpr, Any[
+      TypedExpr(Bool, :(=), lowerEdge, TypedExpr(Bool, :call, GlobalRef(ParallelAccelerator.ParallelIR, :stencil_halo_lower_edge))),
+      TypedExpr(Bool, :(=), upperEdge, TypedExpr(Bool, :call, GlobalRef(ParallelAccelerator.ParallelIR, :stencil_halo_upper_edge))),
+      TypedExpr(Int, :(=), computeLo, DomainIR.add_expr(haloLo + 1,
+                  TypedExpr(Int, :call, GlobalRef(Base, :select_value), lowerEdge, haloLo, 0))),
+      TypedExpr(Int, :(=), computeHi, DomainIR.sub_expr(ownHi,
+                  TypedExpr(Int, :call, GlobalRef(Base, :select_value), upperEdge, haloHi, 0))) ])
+  end
+  append!(preExpr, Any[
+    TypedExpr(Int, :(=), innerHi, DomainIR.sub_expr(ownHi, haloHi)),
+    TypedExpr(Int, :(=), rimLoEnd, min_int_expr(innerLo - 1, computeHi)),
+    TypedExpr(Int, :(=), rimHiStart, max_int_expr(DomainIR.add_expr(innerHi, 1), DomainIR.add_expr(rimLoEnd, 1))) ])
+
+  bodyExpr = relabel(DomainIR.stencilGenBody(stat, bodyLinfo, kernelBody, idxNodes, extStrides, exts, linfo, getLoopPrivateFlags()), irState)
+  bodyExpr = bodyExpr[1:end-1]
+  innerNests = [ PIRLoopNest(idxNodes[i], 1-stat.shapeMin[i], DomainIR.sub_expr(extSizes[i], stat.shapeMax[i]), 1) for i = n-1:-1:1 ]
+  sweep(outerNest) = TypedExpr(Void, head,
+        PIRParForAst(InputInfo(toLHSVar(exts[1])),
+            relabel(deepcopy(bodyExpr), irState), [], [],
+            vcat(outerNest, deepcopy(innerNests)),
+            PIRReduction[],
+            [], [], irState.top_level_number, get_unique_num(), Set{LHSVar}(), Set{LHSVar}([toLHSVar(x) for x in exts])))
+  stepPre = Any[ TypedExpr(Void, :call, GlobalRef(ParallelAccelerator.ParallelIR, :stencil_halo_start), exts[i], haloLo, haloHi,
+                           stat.borderSty === :oob_wraparound)
+                 for i = 1:nbufs if any(e -> stencil_reads_buf(e, toLHSVar(exts[i])), bodyExpr) ]
+  stepPost = Any[
+    TypedExpr(Void, :call, GlobalRef(ParallelAccelerator.ParallelIR, :stencil_halo_finish)),
+    sweep(PIRLoopNest(idxNodes[n], computeLo, rimLoEnd, 1)),
+    sweep(PIRLoopNest(idxNodes[n], rimHiStart, computeHi, 1)) ]
+  append!(stepPost, mk_stencil_border(stat, head, bodyExpr,
+                                      mk_stencil_border_nests(stat, idxNodes, extSizes, PIRLoopNest(idxNodes[n], computeLo, computeHi, 1)),
+                                      extSizes, exts, linfo, irState))
+  if oob_dst_zero
+    # the border planes of the first and the last rank
+    edgeNests = [ PIRLoopNest[ i == n ? band : PIRLoopNest(idxNodes[i], 1, extSizes[i], 1) for i = n:-1:1 ]
+                  for band in (PIRLoopNest(idxNodes[n], haloLo + 1, min_int_expr(DomainIR.sub_expr(computeLo, 1), ownHi), 1),
+                               PIRLoopNest(idxNodes[n], max_int_expr(DomainIR.add_expr(computeHi, 1), computeLo), ownHi, 1)) ]
+    append!(stepPost, mk_stencil_border(stat, head, bodyExpr, edgeNests, extSizes, exts, linfo, irState))
+  end
+
+  # the extended buffers rotate as the buffers do
+  extRotate = Any[]
+  if !isempty(rets)
+    bufVars = [ toLHSVar(x) for x in bufs ]
+    for i = 1:nbufs
+      j = findfirst(bufVars, toLHSVar(rets[i]))
+      push!(extRotate, TypedExpr(Array{elmTyps[j], n}, :(=), toLHSVar(extTmps[i]), exts[j]))
+    end
+    for i = 1:nbufs
+      push!(extRotate, TypedExpr(Array{elmTyps[i], n}, :(=), toLHSVar(exts[i]), extTmps[i]))
+    end
+  end
+  stepNode = DomainIR.addFreshLocalVariable("step", Int, ISASSIGNED | ISASSIGNEDONCE, linfo)
+  once = isa(iterations, Number) && iterations == 1
+  iterPre  = once ? Any[] : Any[ Expr(:loophead, stepNode, 1, iterations) ]
+  iterPost = once ? Any[] : vcat(rotateExpr, extRotate, Expr(:loopend, stepNode))
+  expr = PIRParForAst(
+    InputInfo(toLHSVar(exts[1])),
+    bodyExpr,
+    [],
+    [],
+    vcat(PIRLoopNest(idxNodes[n], innerLo, innerHi, 1), innerNests),
+    PIRReduction[],
+    Any[ length(bufs) > 2 ? tuple(bufs...) : bufs[1] ],
+    DomainOperation[ DomainOperation(:stencil!, args) ],
+    irState.top_level_number,
+    get_unique_num(),
+    Set{LHSVar}(),
+    Set{LHSVar}([toLHSVar(x) for x in exts]))
+  return vcat(preExpr, iterPre, stepPre, TypedExpr(typ, head, expr), stepPost, iterPost, copyOut)
+end
+
 function mk_parfor_args_from_stencil(typ, head, args, irState)
   assert(length(args) == 4)
   local stat = args[1]
-  local border = stat.borderSty
   local border_inloop = false
-  local oob_skip = false
-  local oob_dst_zero = false
-  local oob_src_zero = false
-  local oob_wraparound = false
-  assert(isa(border, Symbol))
-  oob_skip = (border === :oob_skip)
-  oob_dst_zero = (border === :oob_dst_zero)
-  oob_src_zero = (border === :oob_src_zero)
-  oob_wraparound = (border === :oob_wraparound)
+  assert(isa(stat.borderSty, Symbol))
   local iterations = args[2]
   # convert all TypedVar in bufs to just Symbol
   local bufs = args[3]
@@ -132,15 +609,17 @@ function mk_parfor_args_from_stencil(typ, head, args, irState)
     end
   end
   @dprintln(3, "before simplifyBodyExpr body=", kernelF.body)
-  bodyLinfo, bodyExpr = simplifyBodyExpr(kernelF, irState)
-  @dprintln(3, "before simplifyBodyExpr body=", bodyExpr)
-  bodyExpr = relabel(DomainIR.stencilGenBody(stat, bodyLinfo, bodyExpr, idxNodes, strideNodes, bufs, linfo, getLoopPrivateFlags()), irState)
+  bodyLinfo, kernelBody = simplifyBodyExpr(kernelF, irState)
+  @dprintln(3, "before simplifyBodyExpr body=", kernelBody)
+  bodyExpr = relabel(DomainIR.stencilGenBody(stat, bodyLinfo, kernelBody, idxNodes, strideNodes, bufs, linfo, getLoopPrivateFlags()), irState)
   # rotate
   assert((bodyExpr[end].head === :tuple))
   @dprintln(3,"bodyExpr = ")
   printBody(3, bodyExpr)
   local rotateExpr = Array{Any}(0)
   local revertExpr = Array{Any}(0)
+  local swapped = false
+  local rets = Any[]
   # warn(string("last return=", bodyExpr[end]))
   if bodyExpr[end].args[1] != nothing
     rets = bodyExpr[end].args
@@ -154,90 +633,29 @@ function mk_parfor_args_from_stencil(typ, head, args, irState)
       push!(rotateExpr, TypedExpr(CompilerTools.LambdaHandling.getType(tmpBufs[i], linfo), :(=), toLHSVar(bufs[i]), tmpBufs[i]))
       push!(revertExpr, TypedExpr(CompilerTools.LambdaHandling.getType(tmpBufs[i], linfo), :(=), toLHSVar(rets[i]), tmpBufs[i]))
     end
+    swapped = nbufs == 2 && toLHSVar(rets[1]) == toLHSVar(bufs[2]) && toLHSVar(rets[2]) == toLHSVar(bufs[1])
   end
   bodyExpr = bodyExpr[1:end-1]
-  # border handling
-  borderLabel = next_label(irState)
-  afterBorderLabel = next_label(irState)
-  lowerExprs = [ DomainIR.box_ty(Bool, Expr(:call, GlobalRef(Base, :sle_int), 1-stat.shapeMin[i], idxNodes[i]))
-                 for i in 1:n ]
-  upperExprs = [ DomainIR.box_ty(Bool, Expr(:call, GlobalRef(Base, :sle_int), idxNodes[i],
-                      DomainIR.sub_expr(sizeNodes[i], stat.shapeMax[i])))
-                 for i in 1:n ]
-  lowerGotos = [ Expr(:gotoifnot, e, borderLabel) for e in lowerExprs ]
-  upperGotos = [ Expr(:gotoifnot, e, borderLabel) for e in upperExprs ]
-  borderHead = Any[ TypedExpr(Int, :(=), toLHSVar(idxNodes[1]),
-                      DomainIR.sub_expr(sizeNodes[1], stat.shapeMax[1])),
-                    GotoNode(afterBorderLabel),
-                    LabelNode(borderLabel),
-                  ]
-  borderExpr = Any[]
-  if oob_dst_zero
-    for expr in bodyExpr
-      expr = deepcopy(expr)
-      if (expr.head === :call) && isBaseFunc(expr.args[1], :unsafe_arrayset)
-        zero = Base.convert(DomainIR.elmTypOf(getType(expr.args[2], linfo)), 0)
-        push!(borderExpr, TypedExpr(expr.typ, :call, expr.args[1], expr.args[2], zero, expr.args[4:end]...))
-      end
-    end
-  elseif oob_src_zero
-    for expr in bodyExpr
-      expr = deepcopy(expr)
-      if isa(expr, Expr) && (expr.head === :(=))
-        lhs = expr.args[1]
-        rhs = expr.args[2]
-        if isa(rhs, Expr) && (rhs.head === :call) && isBaseFunc(rhs.args[1], :unsafe_arrayref)
-          zero = Base.convert(rhs.typ, 0)
-          expr = TypedExpr(expr.typ, :(=), lhs,
-                  TypedExpr(rhs.typ, :call, GlobalRef(Base, :safe_arrayref),
-                      rhs.args[2], zero, rhs.args[3:end]...))
-        end
-      end
-      push!(borderExpr, expr)
-    end
-  elseif oob_wraparound
-    for expr in bodyExpr
-      expr = deepcopy(expr)
-      if isa(expr, Expr) && (expr.head === :(=))
-        lhs = expr.args[1]
-        rhs = expr.args[2]
-        if isa(rhs, Expr) && (rhs.head === :call) && isBaseFunc(rhs.args[1], :unsafe_arrayref)
-          indices = Expr[ TypedExpr(Int, :call, GlobalRef(Base, :select_value),
-                            DomainIR.box_ty(Bool, Expr(:call, GlobalRef(Base, :sle_int), deepcopy(rhs.args[2+i]), 0)),
-                            DomainIR.add_expr(deepcopy(rhs.args[2+i]), sizeNodes[i]),
-                            TypedExpr(Int, :call, GlobalRef(Base, :select_value),
-                              DomainIR.box_ty(Bool, Expr(:call, GlobalRef(Base, :sle_int),
-                                DomainIR.add_expr(sizeNodes[i], 1), deepcopy(rhs.args[2+i]))),
-                              DomainIR.sub_expr(deepcopy(rhs.args[2+i]), sizeNodes[i]),
-                              deepcopy(rhs.args[2+i]))) for i = 1:n ]
-          expr = TypedExpr(expr.typ, :(=), lhs,
-                  TypedExpr(rhs.typ, :call, GlobalRef(Base, :unsafe_arrayref),
-                      rhs.args[2], indices...))
-        end
-      end
-      push!(borderExpr, expr)
-    end
-  else #FIXME: the following is to make a dummy node to avoid an IR bug
-#    push!(borderExpr, TypedExpr(Int, :(=), idxNodes[1].name, idxNodes[1]))
+  if stencil_distributed(stat, bufs, rets)
+    return vcat(sizeInitExpr, mk_stencil_distributed(typ, head, args, iterations, bufs, rets, idxNodes, sizeNodes,
+                                                     rotateExpr, bodyLinfo, kernelBody, linfo, irState))
   end
-  borderExpr = vcat(borderHead, relabel(borderExpr, irState), LabelNode(afterBorderLabel))
-  # borderCond = [ borderHead, lowerGotos, upperGotos, borderExpr, borderTail ]
-  borderCond = oob_skip ? Any[] : Any[TypedExpr(Void, head,
-        PIRParForAst(InputInfo(toLHSVar(buf)),
-            vcat(lowerGotos, upperGotos, borderExpr),
-            [],
-            [],
-            [ PIRLoopNest(idxNodes[i], 1, sizeNodes[i], 1) for i = n:-1:1 ],
-            PIRReduction[],
-            [], [], irState.top_level_number, get_unique_num(), Set{LHSVar}(), Set{LHSVar}([toLHSVar(x) for x in bufs])))]
+  borderCond = mk_stencil_border(stat, head, bodyExpr, mk_stencil_border_nests(stat, idxNodes, sizeNodes),
+                                 sizeNodes, bufs, linfo, irState)
 
   stepNode = DomainIR.addFreshLocalVariable("step", Int, ISASSIGNED | ISASSIGNEDONCE, linfo)
+  # Temporally blocked sweeps for all but the last few iterations
+  blockExpr = Any[]
+  if !(isa(iterations, Number) && iterations == 1) && swapped && stencil_blockable(stat, bodyExpr, bufs, idxNodes, linfo)
+    blockExpr, iterations = mk_stencil_blocks(stat, head, iterations, bufs, sizeNodes, strideNodes, rotateExpr,
+                                              bodyLinfo, kernelBody, linfo, irState)
+  end
   # Sequential loop for multi-iterations
   iterPre  = (isa(iterations, Number) && iterations == 1) ?
             Any[] : Any[ Expr(:loophead, stepNode, 1, iterations) ]
   iterPost = (isa(iterations, Number) && iterations == 1) ?
             Any[] : vcat(rotateExpr, Expr(:loopend, stepNode))
-  preExpr = vcat(sizeInitExpr, strideInitExpr, iterPre, borderCond)
+  preExpr = vcat(sizeInitExpr, strideInitExpr, blockExpr, iterPre, borderCond)
   postExpr = vcat(iterPost)
   expr = PIRParForAst(
     InputInfo(buf),
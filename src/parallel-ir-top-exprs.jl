@@ -78,12 +78,28 @@ function fusion_pass(ast::Array{Any,1}, depth, state)
             is_new_parfor  = isParforAssignmentNode(ast[i])    || isBareParfor(ast[i])
             @dprintln(3,"is_new_parfor = ", is_new_parfor, " is_last_parfor = ", is_last_parfor)
 
+            # A map over the result of a gemm/gemv is marked as its epilogue so that code generation can compute
+            # the product panel by panel and run the map on each panel while it is still in cache.
+            if is_new_parfor && !is_last_parfor && getGemmCall(last_node) != nothing
+                new_parfor = getParforNode(ast[i])
+                if isGemmEpilogue(last_node, new_parfor, state)
+                    @dprintln(3,"Parfor is an epilogue of ", last_node)
+                    new_parfor.fused_gemm = last_node
+                end
+            end
+
             # If both are parfors then try to fuse them.
             if is_new_parfor && is_last_parfor
+                # The fused parfor has to remain an epilogue of the product the previous one was marked with.
+                last_parfor = getParforNode(last_node)
+                keep_gemm = last_parfor.fused_gemm == nothing || isGemmEpilogue(last_parfor.fused_gemm, getParforNode(ast[i]), state)
                 @dprintln(3,"Starting fusion ", fuse_number)
                 fuse_number = fuse_number + 1
                 fuse_ret = fuse(body, length(body), ast[i], state)
                 if fuse_ret>0
+                    if !keep_gemm
+                        last_parfor.fused_gemm = nothing
+                    end
                     # 2 means combination of old and new parfors has no output and both are dead
                     if fuse_ret==2
                         # remove last parfor and don't add anything new
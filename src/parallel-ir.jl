@@ -112,6 +112,18 @@ type PIRReduction
     reductionVar  :: RHSVar
     reductionVarInit
     reductionFunc
+    scatter       :: Bool  # array reduction updated only through scatter_add! calls in the parfor body
+end
+
+PIRReduction(reductionVar, reductionVarInit, reductionFunc) = PIRReduction(reductionVar, reductionVarInit, reductionFunc, false)
+
+"""
+The update acc[idx...] += v of a scatter reduction (e.g., a histogram) in a parfor body.
+The backend chooses per invocation between thread-private copies of acc and atomic updates.
+"""
+function scatter_add!(acc, v, idx...)
+    acc[idx...] += v
+    return nothing
 end
 
 """
@@ -384,8 +396,9 @@ type PIRParForAst
     arrays_read_past_index :: Set{LHSVar}
 
     force_simd::Bool # generate pragma simd in backend
+    fused_gemm       # gemm/gemv statement right before the parfor that the parfor is an elementwise epilogue of, or nothing
     function PIRParForAst(fi, b, pre, hoisted, nests, red, post, orig, t, unique, wrote_past_index, read_past_index)
-        new(fi, b, pre, hoisted, nests, red, post, orig, [t], unique, Dict{Symbol,Symbol}(), nothing, wrote_past_index, read_past_index, false)
+        new(fi, b, pre, hoisted, nests, red, post, orig, [t], unique, Dict{Symbol,Symbol}(), nothing, wrote_past_index, read_past_index, false, nothing)
     end
 end
 
@@ -429,8 +442,12 @@ type PIRParForStartEnd
     instruction_count_expr
     private_vars :: Array{RHSVar,1}
     force_simd::Bool
+    fused_gemm
 end
 
+PIRParForStartEnd(loopNests, reductions, instruction_count_expr, private_vars, force_simd) =
+    PIRParForStartEnd(loopNests, reductions, instruction_count_expr, private_vars, force_simd, nothing)
+
 """
 State passed around while converting an AST from domain to parallel IR.
 """
@@ -535,7 +552,8 @@ end
 export PIRLoopNest, PIRReduction, from_exprs, PIRParForAst, AstWalk, PIRSetFuseLimit,
        PIRNumSimplify, PIRInplace, PIRRunAsTasks, PIRLimitTask, PIRReduceTasks,
        PIRStencilTasks, PIRFlatParfor, PIRNumThreadsMode, PIRShortcutArrayAssignment,
-       PIRTaskGraphMode, PIRPolyhedral, PIRHoistParfors, PIRLateSimplify
+       PIRTaskGraphMode, PIRPolyhedral, PIRHoistParfors, PIRLateSimplify,
+       PIRStencilBlocking
 
 late_simplify = true
 """
@@ -2266,6 +2284,15 @@ function pir_rws_cb(ast :: Expr, cbdata :: ANY)
             tcopy.args[1] = GlobalRef(Base, :arrayset)
             push!(expr_to_process, tcopy)
             return expr_to_process
+        elseif cfun == GlobalRef(ParallelAccelerator.ParallelIR, :scatter_add!)
+            @dprintln(3,"pir_rws_cb for :scatter_add! call")
+            @dprintln(3,"ast = ", ast)
+
+            tcopy = deepcopy(ast)
+            tcopy.args[1] = GlobalRef(Base, :arrayset)
+            push!(expr_to_process, tcopy)
+            push!(expr_to_process, Expr(:call, GlobalRef(Base, :arrayref), deepcopy(cargs[1]), deepcopy(cargs[3:end])...))
+            return expr_to_process
         elseif cfun == GlobalRef(ParallelAccelerator.API, :SubArrayLastDimRead)
             @dprintln(3,"pir_rws_cb for :SubArrayLastDimRead call")
             @dprintln(3,"ast = ", ast)
@@ -2447,6 +2474,9 @@ function isSideEffectFreeAPI(node :: GlobalRef)
       return true
     end
   end
+  if node.mod == ParallelAccelerator.API.Batched
+    return in(node.name, ParallelAccelerator.API.Batched.batched_operators)
+  end
   return false
 end
 
@@ -2545,6 +2575,20 @@ function hasNoSideEffects(node :: Expr)
             isBaseFunc(func, :select_value) ||
             isBaseFunc(func, :powi_llvm) ||
             isBaseFunc(func, :svec) ||
+            isBaseFunc(func, :cumsum) ||
+            isBaseFunc(func, :cumprod) ||
+            isBaseFunc(func, :accumulate) ||
+            isBaseFunc(func, :sort) ||
+            isBaseFunc(func, :sortperm) ||
+            isBaseFunc(func, :\) ||
+            isBaseFunc(func, :*) ||
+            isBaseFunc(func, :Ac_mul_B) ||
+            isBaseFunc(func, :count) ||
+            isBaseFunc(func, :find) ||
+            isBaseFunc(func, :&) ||
+            isBaseFunc(func, :|) ||
+            isBaseFunc(func, :xor) ||
+            isBaseFunc(func, :~) ||
             isSideEffectFreeAPI(func)
             @dprintln(3,"hasNoSideEffects returning true")
             return all(Bool[hasNoSideEffects(a) for a in args])
@@ -3195,6 +3239,20 @@ function __init__()
   push!(wellknown_all_unmodified, Base.resolve(GlobalRef(ParallelAccelerator.API,:(<)),  force = true))
   push!(wellknown_all_unmodified, Base.resolve(GlobalRef(ParallelAccelerator.API,:(>=)), force = true))
   push!(wellknown_all_unmodified, Base.resolve(GlobalRef(ParallelAccelerator.API,:(>)),  force = true))
+  push!(wellknown_all_unmodified, GlobalRef(Base,:cumsum))
+  push!(wellknown_all_unmodified, GlobalRef(Base,:cumprod))
+  push!(wellknown_all_unmodified, GlobalRef(Base,:accumulate))
+  push!(wellknown_all_unmodified, GlobalRef(Base,:sort))
+  push!(wellknown_all_unmodified, GlobalRef(Base,:sortperm))
+  push!(wellknown_all_unmodified, GlobalRef(Base,:\))
+  push!(wellknown_all_unmodified, GlobalRef(Base,:*))
+  push!(wellknown_all_unmodified, GlobalRef(Base,:Ac_mul_B))
+  for opr in [:count, :find, :sum, :&, :|, :xor, :~]
+    push!(wellknown_all_unmodified, GlobalRef(Base, opr))
+  end
+  for opr in ParallelAccelerator.API.Batched.batched_operators
+    push!(wellknown_all_unmodified, GlobalRef(ParallelAccelerator.API.Batched, opr))
+  end
 end
 
 function no_mod_impl(func :: GlobalRef, arg_type_tuple :: Array{DataType,1})
@@ -3749,6 +3807,24 @@ function from_expr(ast::ANY, depth, state :: expr_state, top_level)
     end
 end
 
+"""
+Returns true if the arguments of a dangling :select are a vector of numbers and
+a 1-D Bool or bit mask, which CGen compacts with its word-at-a-time kernel.
+"""
+function isBitsSelect(args, state :: expr_state)
+    if length(args) != 2 || !isa(args[1], RHSVar) || !isa(args[2], Expr) || args[2].head != :tomask
+        return false
+    end
+    m = args[2].args[1]
+    if !isa(m, RHSVar)
+        return false
+    end
+    atyp = getType(args[1], state.LambdaVarInfo)
+    mtyp = getType(m, state.LambdaVarInfo)
+    return atyp <: Vector && eltype(atyp) <: Number &&
+           ((mtyp <: Array && eltype(mtyp) == Bool) || mtyp <: BitArray) && ndims(mtyp) == 1
+end
+
 """
 The main ParallelIR function for processing some node in the AST.
 """
@@ -3796,6 +3872,11 @@ function from_expr(ast ::Expr, depth, state :: expr_state, top_level)
         # remove line numbers
         return []
         # skip
+    elseif head == :select && isBitsSelect(args, state)
+        # a vector selected by a 1-D mask is left as a getindex call for CGen's
+        # word-at-a-time compaction kernel
+        args = Any[GlobalRef(Base, :getindex), args[1], args[2].args[1]]
+        head = :call
     elseif head == :select
         # translate dangling :select (because most other :select would have been inlined and then removed when no longer live) as an mmap into parfor
         head = :parfor
@@ -0,0 +1,34 @@
+module TestAsyncCompile
+using ParallelAccelerator
+
+@acc function axpy(a, x, y)
+    return a .* x .+ y
+end
+
+@acc function dot2(x, y)
+    return sum(x .* y)
+end
+
+function test()
+    x = rand(1000)
+    y = rand(1000)
+    ParallelAccelerator.asyncCompile(true)
+    try
+        # calls made while the compiler runs get the original method's result
+        ok = isapprox(axpy(2.0, x, y), 2.0 .* x .+ y)
+        ParallelAccelerator.prewarm(dot2, [(Array{Float64,1}, Array{Float64,1})])
+        ok = ok && isapprox(dot2(x, y), sum(x .* y))
+        ParallelAccelerator.awaitCompiles()
+        return ok && isapprox(axpy(2.0, x, y), 2.0 .* x .+ y) &&
+               isapprox(dot2(x, y), sum(x .* y))
+    finally
+        ParallelAccelerator.asyncCompile(false)
+    end
+end
+
+end
+
+using Base.Test
+println("testing background compilation...")
+@test TestAsyncCompile.test()
+println("Done testing background compilation.")
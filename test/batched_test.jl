@@ -0,0 +1,87 @@
+module TestBatched
+using ParallelAccelerator
+
+@acc function bmul(A, B)
+    C = batched_mul(A, B)
+    return C
+end
+
+@acc function bmv(A, x)
+    y = batched_mul(A, x)
+    return y
+end
+
+@acc function bsolve(A, b)
+    x = batched_solve(A, b)
+    return x
+end
+
+@acc function bdet(A)
+    d = batched_det(A)
+    return d
+end
+
+@acc function binv(A)
+    X = batched_inv(A)
+    return X
+end
+
+# diagonally dominant, so every matrix of the batch is well conditioned
+function batch(T, nb, n)
+    A = rand(T, nb, n, n)
+    for i = 1:n
+        A[:, i, i] += T(n)
+    end
+    return A
+end
+
+# n = 2, 3, 4 take the unrolled kernels, n = 5 the run-time sized ones
+function test(T, nb, n)
+    A = batch(T, nb, n)
+    B = rand(T, nb, n, n)
+    b = rand(T, nb, n)
+    C = bmul(A, B)
+    y = bmv(A, b)
+    x = bsolve(A, b)
+    d = bdet(A)
+    X = binv(A)
+    ok = true
+    for k = 1:nb
+        Ak = A[k, :, :]
+        ok &= isapprox(C[k, :, :], Ak * B[k, :, :])
+        ok &= isapprox(y[k, :], Ak * b[k, :])
+        ok &= isapprox(x[k, :], Ak \ b[k, :])
+        ok &= isapprox(d[k], det(Ak))
+        ok &= isapprox(X[k, :, :], inv(Ak))
+    end
+    return ok
+end
+
+# operands whose batch or inner sizes disagree with A are rejected
+function mismatch(f)
+    try
+        f()
+        return false
+    catch e
+        return isa(e, DimensionMismatch)
+    end
+end
+
+function test_mismatch()
+    A = batch(Float64, 10, 3)
+    return mismatch(() -> @noacc bmul(A, rand(10, 4, 3))) &&
+           mismatch(() -> @noacc bmv(A, rand(9, 3))) &&
+           mismatch(() -> @noacc bsolve(A, rand(10, 2)))
+end
+
+end
+
+using Base.Test
+println("testing batched small-matrix kernels...")
+@test TestBatched.test(Float64, 1000, 2)
+@test TestBatched.test(Float64, 1000, 3)
+@test TestBatched.test(Float64, 130, 4)
+@test TestBatched.test(Float64, 70, 5)
+@test TestBatched.test(Float32, 1000, 3)
+@test TestBatched.test_mismatch()
+println("Done testing batched small-matrix kernels.")
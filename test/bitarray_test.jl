@@ -0,0 +1,44 @@
+module TestBitArrays
+using ParallelAccelerator
+
+@acc function bits_count(m)
+    return count(m), sum(m)
+end
+
+@acc function bits_find(m)
+    return find(m)
+end
+
+@acc function bits_logic(m1, m2)
+    return ~((m1 & m2) | (m1 $ m2))
+end
+
+@acc function bits_select(A, m)
+    return sum(A[m])
+end
+
+# a mask computed in the function stays a fusable map
+@acc function bits_computed(A, B)
+    return sum((A .> 0.5) & (B .< 0.5))
+end
+
+function test(n)
+    m1 = rand(n) .< 0.3
+    m2 = rand(n) .< 0.6
+    A = rand(n)
+    B = rand(n)
+    return bits_count(m1) == (count(m1), count(m1)) &&
+           bits_find(m1) == find(m1) &&
+           bits_logic(m1, m2) == ~((m1 & m2) | (m1 $ m2)) &&
+           isapprox(bits_select(A, m2), sum(A[m2])) &&
+           bits_computed(A, B) == sum((A .> 0.5) & (B .< 0.5))
+end
+
+end
+
+using Base.Test
+println("testing packed bit arrays...")
+@test TestBitArrays.test(100)
+@test TestBitArrays.test(64 * 1000)
+@test TestBitArrays.test(100003)
+println("Done testing packed bit arrays.")
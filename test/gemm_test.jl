@@ -0,0 +1,45 @@
+module TestGemm
+using ParallelAccelerator
+
+@acc gemm_nn(A,B) = A*B
+@acc gemm_tn(A,B) = A'*B
+@acc gemm_nt(A,B) = A*B'
+@acc gemm_tt(A,B) = A'*B'
+# elementwise maps over the product are computed panel by panel with it
+@acc gemm_bias(A,B,c) = A*B .+ c
+@acc gemm_sigmoid(A,B) = 1.0 ./ (1.0 .+ exp(-(A*B')))
+
+# sizes on both sides of the small-product cutoff, with partial register tiles
+function test(m, n, k)
+    A = rand(m, k)
+    B = rand(k, n)
+    At = A'
+    Bt = B'
+    return isapprox(gemm_nn(A, B), A*B) && isapprox(gemm_tn(At, B), A*B) &&
+           isapprox(gemm_nt(A, Bt), A*B) && isapprox(gemm_tt(At, Bt), A*B)
+end
+
+function test_float32(m, n, k)
+    A = rand(Float32, m, k)
+    B = rand(Float32, k, n)
+    return isapprox(gemm_nn(A, B), A*B) && isapprox(gemm_tt(A', B'), A*B)
+end
+
+function test_epilogue(m, n, k)
+    A = rand(m, k)
+    B = rand(k, n)
+    Bt = B'
+    return isapprox(gemm_bias(A, B, 0.5), A*B .+ 0.5) &&
+           isapprox(gemm_sigmoid(A, Bt), 1.0 ./ (1.0 .+ exp(-(A*B))))
+end
+
+end
+
+using Base.Test
+println("testing gemm...")
+@test TestGemm.test(3, 5, 7)
+@test TestGemm.test(131, 67, 301)
+@test TestGemm.test(517, 260, 129)
+@test TestGemm.test_float32(131, 67, 301)
+@test TestGemm.test_epilogue(300, 1000, 50)
+println("Done testing gemm.")
@@ -3,6 +3,7 @@ using ParallelAccelerator
 
 @acc gemv_t(A,y) = A*y
 @acc gemv_t2(A,y) = A'*y
+@acc gemv_logistic(A,y) = 1.0 ./ (1.0 .+ exp(-(A*y)))
 
 function test()
     A = [1. 2. 3.; 4. 5. 6.]
@@ -19,12 +20,29 @@ function test2()
     return z
 end
 
+# large enough for the blocked, threaded fallback
+function test3()
+    A = rand(1000, 700)
+    x = rand(700)
+    x2 = rand(1000)
+    return isapprox(gemv_t(A, x), A*x) && isapprox(gemv_t2(A, x2), A'*x2)
+end
+
+# the map is fused into the product
+function test4()
+    A = rand(20000, 30)
+    x = rand(30) .- 0.5
+    return isapprox(gemv_logistic(A, x), 1.0 ./ (1.0 .+ exp(-(A*x))))
+end
+
 end
 
 using Base.Test
 println("testing gemv...")
 @test_approx_eq TestGemv.test() [14.0,32.0]
 @test_approx_eq TestGemv.test2() [9.0,12.0,15.0]
+@test TestGemv.test3()
+@test TestGemv.test4()
 println("Done testing gemv.")
 
 
@@ -0,0 +1,32 @@
+module TestISA
+using ParallelAccelerator
+
+@acc function axpy_dispatch(a, x, y)
+    return a .* x .+ y
+end
+
+@acc function axpy_forced(a, x, y)
+    return a .* x .+ y
+end
+
+function test()
+    x = rand(10000)
+    y = rand(10000)
+    ok = isapprox(axpy_dispatch(2.0, x, y), 2.0 .* x .+ y)
+    # aliased arguments take the baseline fallback
+    ok = ok && isapprox(axpy_dispatch(2.0, x, x), 3.0 .* x)
+    # every x86-64 CPU of the last decade supports level 2
+    ParallelAccelerator.CGen.setisalevel(Sys.ARCH == :x86_64 ? 2 : 0)
+    try
+        return ok && isapprox(axpy_forced(2.0, x, y), 2.0 .* x .+ y)
+    finally
+        ParallelAccelerator.CGen.setisalevel(-1)
+    end
+end
+
+end
+
+using Base.Test
+println("testing ISA-targeted builds...")
+@test TestISA.test()
+println("Done testing ISA-targeted builds.")
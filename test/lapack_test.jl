@@ -0,0 +1,44 @@
+module TestLapack
+using ParallelAccelerator
+
+@acc function solve(A, b)
+    x = A \ b
+    return x
+end
+
+@acc function trsolve(U, B)
+    Base.LinAlg.LAPACK.trtrs!('U', 'N', 'N', U, B)
+    return B
+end
+
+# sizes on both sides of the 128-column blocking
+function test(T, n, nrhs)
+    A = rand(T, n, n) + T(n) * eye(T, n)
+    b = rand(T, n)
+    B = rand(T, n, nrhs)
+    return isapprox(solve(A, b), A \ b) && isapprox(solve(A, B), A \ B)
+end
+
+function test_trtrs(n)
+    U = triu(rand(n, n)) + n * eye(n)
+    B = rand(n, 3)
+    return isapprox(trsolve(U, copy(B)), U \ B)
+end
+
+# an overdetermined system gets the least-squares solution
+function test_lsq(m, n)
+    A = rand(m, n)
+    b = rand(m)
+    return isapprox(solve(A, b), A \ b)
+end
+
+end
+
+using Base.Test
+println("testing LAPACK fallbacks...")
+@test TestLapack.test(Float64, 5, 2)
+@test TestLapack.test(Float64, 300, 7)
+@test TestLapack.test(Float32, 130, 3)
+@test TestLapack.test_trtrs(200)
+@test TestLapack.test_lsq(8, 5)
+println("Done testing LAPACK fallbacks.")
@@ -0,0 +1,54 @@
+# Also run by hand on several processes:
+#   CGEN_MPI_COMPILE=1 mpirun -np 4 julia mpi_reduce_test.jl
+module TestMPIReduce
+using ParallelAccelerator
+
+if ParallelAccelerator.CGen.isDistributedMode()
+    using MPI
+end
+
+@acc function total(x, y)
+    a = sum(x)
+    b = sum(y .* y)
+    return a + b
+end
+
+@acc function largest(x)
+    return maximum(x)
+end
+
+@acc function column_sums(x)
+    s::Array{Float64,1} = zeros(size(x, 1))
+    @par s(.+) for i in 1:size(x, 2)
+        s = s .+ x[:,i]
+    end
+    return s
+end
+
+# Every rank passes its block of columns, of different widths, and gets the result for the whole arrays.
+function test()
+    rank, nranks = 0, 1
+    if ParallelAccelerator.CGen.isDistributedMode()
+        rank, nranks = MPI.Comm_rank(MPI.COMM_WORLD), MPI.Comm_size(MPI.COMM_WORLD)
+    end
+    widths = [ 3 + r % 4 for r = 0:nranks-1 ]
+    cols = sum(widths[1:rank]) + (1:widths[rank+1])
+    srand(23)
+    x = rand(20, sum(widths))
+    y = rand(20, sum(widths))
+    ParallelAccelerator.CGen.set_distributed_reductions(true)
+    try
+        return isapprox(total(x[:, cols], y[:, cols]), sum(x) + sum(y .* y)) &&
+               largest(x[:, cols]) == maximum(x) &&
+               isapprox(column_sums(x[:, cols]), vec(sum(x, 2)))
+    finally
+        ParallelAccelerator.CGen.set_distributed_reductions(false)
+    end
+end
+
+end
+
+using Base.Test
+println("testing distributed reductions...")
+@test TestMPIReduce.test()
+println("Done testing distributed reductions.")
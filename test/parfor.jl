@@ -67,6 +67,22 @@ end
  return s .* m
 end
 
+@acc function parfor4(idx, v, nbins)
+ h::Array{Int,1} = zeros(Int, nbins)
+ @par h(.+) for i in 1:length(idx)
+    h[idx[i]] += v[i]
+ end
+ return h
+end
+
+@acc function parfor5(idx, v, nbins)
+ h::Array{Int,1} = ones(Int, nbins)
+ @par h(.*) for i in 1:length(idx)
+    h[idx[i] + 1] *= v[i]
+ end
+ return h
+end
+
 function test1()
   parfor1(10) == @noacc parfor1(10) 
 end
@@ -79,6 +95,23 @@ function test3()
   parfor3(10) == @noacc parfor3(10) 
 end
 
+# histograms small enough to privatize per thread and large enough to be updated atomically
+function test4()
+  idx = [ mod(i * 7919, 1000) + 1 for i = 1:100000 ]
+  v = [ mod(i, 13) for i = 1:100000 ]
+  small = parfor4(idx, v, 1000) == @noacc parfor4(idx, v, 1000)
+  idx = [ mod(i * 7919, 100000) + 1 for i = 1:100000 ]
+  large = parfor4(idx, v, 100000) == @noacc parfor4(idx, v, 100000)
+  small && large
+end
+
+# a product reduction is not a scatter-accumulate even though its indices add
+function test5()
+  idx = [ mod(i * 7919, 100) for i = 1:1000 ]
+  v = [ mod(i, 3) + 1 for i = 1:1000 ]
+  parfor5(idx, v, 101) == @noacc parfor5(idx, v, 101)
+end
+
 end
 
 using Base.Test
@@ -86,4 +119,6 @@ println("Testing parfor support via @par macro...")
 @test ParForTest.test1() 
 @test ParForTest.test2()
 @test ParForTest.test3()
+@test ParForTest.test4()
+@test ParForTest.test5()
 println("Done testing parfor.") 
@@ -0,0 +1,26 @@
+module TestPGO
+using ParallelAccelerator
+
+@acc function clamp_sum(x, lo, hi)
+    return sum(map(v -> v < lo ? lo : (v > hi ? hi : v), x))
+end
+
+function test()
+    x = randn(10000)
+    expected = sum(map(v -> v < -1.0 ? -1.0 : (v > 1.0 ? 1.0 : v), x))
+    ParallelAccelerator.CGen.setpgo(true)
+    try
+        ok = isapprox(clamp_sum(x, -1.0, 1.0), expected)
+        ParallelAccelerator.optimizeProfiled()
+        return ok && isapprox(clamp_sum(x, -1.0, 1.0), expected)
+    finally
+        ParallelAccelerator.CGen.setpgo(false)
+    end
+end
+
+end
+
+using Base.Test
+println("testing profile-guided builds...")
+@test TestPGO.test()
+println("Done testing profile-guided builds.")
@@ -55,6 +55,26 @@ end
     return y
 end
 
+@acc function loop_rand(n, m)
+    A = Array{Float64}(m, n)
+    @par for i in 1:n
+        for j = 1:m
+            A[j,i] = rand()
+        end
+    end
+    return A
+end
+
+@noinline draw_pair() = rand() + 2.0 * rand()
+
+@acc function callee_rand(n)
+    A = Array{Float64}(n)
+    @par for i in 1:n
+        A[i] = draw_pair()
+    end
+    return A
+end
+
 function test1()
     return simple_rand(2,3)
 end
@@ -71,6 +91,36 @@ function test4()
     return tuple_randn()
 end
 
+# same seed, same numbers; consecutive calls draw different numbers
+function test5()
+    srand(7)
+    A = simple_rand(300, 300)
+    B = simple_rand(300, 300)
+    srand(7)
+    C = simple_rand(300, 300)
+    return A == C && A != B && abs(mean(A) - 1.0) < 0.01
+end
+
+function test6()
+    srand(7)
+    A = simple_randn(300, 300)
+    srand(7)
+    B = simple_randn(300, 300)
+    return A == B && abs(mean(A)) < 0.03 && abs(std(A) - 2.0) < 0.03
+end
+
+
+# the draws of a sequential loop inside a parfor iteration differ
+function test7()
+    A = loop_rand(50, 20)
+    return length(unique(A)) == length(A)
+end
+
+# a function called from a parfor iteration draws numbers of its own in every iteration
+function test8()
+    A = callee_rand(1000)
+    return length(unique(A)) == length(A)
+end
 
 end
 
@@ -80,5 +130,9 @@ println("Testing rand()...")
 @test size(RandTest.test2())==(2,3)
 @test size(RandTest.test3())==(2,3)
 @test size(RandTest.test4())==(2,3)
+@test RandTest.test5()
+@test RandTest.test6()
+@test RandTest.test7()
+@test RandTest.test8()
 println("Done testing rand()...")
 
@@ -47,8 +47,25 @@ include("strings.jl")
 include("test_lr.jl")
 include("test_kmeans.jl")
 include("gemv_test.jl")
+include("gemm_test.jl")
+include("batched_test.jl")
+include("sparse_test.jl")
+include("bitarray_test.jl")
+include("async_compile_test.jl")
+include("pgo_test.jl")
+include("isa_test.jl")
+include("vec_report_test.jl")
+include("shape_test.jl")
+include("stencil_blocking_test.jl")
+include("stencil_border_test.jl")
+include("stencil_mpi_test.jl")
+include("mpi_reduce_test.jl")
+include("lapack_test.jl")
 include("transpose_test.jl")
 include("vecnorm_test.jl")
+include("scan_test.jl")
+include("sort_test.jl")
+include("simd_math_test.jl")
 include("broadcast.jl")
 
 # Examples.  We're not including them all here, because it would take
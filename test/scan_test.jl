@@ -0,0 +1,84 @@
+#=
+Copyright (c) 2015, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+- Redistributions of source code must retain the above copyright notice, 
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice, 
+  this list of conditions and the following disclaimer in the documentation 
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+THE POSSIBILITY OF SUCH DAMAGE.
+=#
+module TestScan
+using ParallelAccelerator
+
+@acc cumsum_t(A) = cumsum(A)
+@acc cumprod_t(A) = cumprod(A)
+@acc cumsum_dim_t(A) = cumsum(A, 2)
+@acc accumulate_t(A) = accumulate(max, A)
+@acc accumulate_min_t(A) = accumulate(min, A)
+
+@acc function cumsum_map(A)
+    B = cumsum(A .* 2.0)
+    return B .+ 1.0
+end
+
+function test1()
+    A = collect(1.0:100000.0)
+    return cumsum_t(A) == cumsum(A)
+end
+
+function test2()
+    A = Float64[1.0 + 1.0/i for i = 1:20]
+    return cumprod_t(A) ≈ cumprod(A)
+end
+
+function test3()
+    A = reshape(collect(1:24), 4, 6)
+    return cumsum_t(A) == cumsum(A, 1) && cumsum_dim_t(A) == cumsum(A, 2)
+end
+
+function test4()
+    A = [3, 1, 4, 1, 5, 9, 2, 6, 5, 3, 5]
+    return accumulate_t(A) == accumulate(max, A)
+end
+
+function test5()
+    A = rand(1000)
+    return cumsum_map(A) ≈ cumsum(A .* 2.0) .+ 1.0
+end
+
+# a NaN propagates through a running max or min, in both the serial and the parallel scan
+function test6()
+    A = rand(100000)
+    A[50000] = NaN
+    B = A[1:100]
+    B[50] = NaN
+    return isequal(accumulate_t(A), accumulate(max, A)) && isequal(accumulate_min_t(A), accumulate(min, A)) &&
+           isequal(accumulate_t(B), accumulate(max, B)) && isequal(accumulate_min_t(B), accumulate(min, B))
+end
+
+end
+
+using Base.Test
+println("Testing scans...")
+@test TestScan.test1()
+@test TestScan.test2()
+@test TestScan.test3()
+@test TestScan.test4()
+@test TestScan.test5()
+@test TestScan.test6()
+println("Done testing scans.")
@@ -0,0 +1,29 @@
+module TestShapes
+using ParallelAccelerator
+
+@acc function weighted(w, x)
+    return sum(w .* x)
+end
+
+function test()
+    ParallelAccelerator.shapeSpecialize(true)
+    try
+        ok = true
+        # enough calls with 3x3 weights to specialize, then other sizes that must not use that version
+        for n in [3, 3, 3, 3, 3, 3, 4, 20]
+            w = rand(n, n)
+            x = rand(n, n)
+            ok = ok && isapprox(weighted(w, x), sum(w .* x))
+        end
+        return ok
+    finally
+        ParallelAccelerator.shapeSpecialize(false)
+    end
+end
+
+end
+
+using Base.Test
+println("testing shape specialization...")
+@test TestShapes.test()
+println("Done testing shape specialization.")
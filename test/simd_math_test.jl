@@ -0,0 +1,56 @@
+#=
+Copyright (c) 2015, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+- Redistributions of source code must retain the above copyright notice, 
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice, 
+  this list of conditions and the following disclaimer in the documentation 
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+THE POSSIBILITY OF SUCH DAMAGE.
+=#
+module TestSimdMath
+using ParallelAccelerator
+
+@acc simd_exp_log(A) = exp(-A) .+ log(A .+ 1.0)
+@acc simd_trig(A) = sin(A) .* cos(A) .+ sqrt(A)
+@acc simd_exp32(A) = exp(A .* 0.5f0)
+
+# each function is compiled on its first call, so level 4 gets its own copies
+@acc simd_exp_log4(A) = exp(-A) .+ log(A .+ 1.0)
+@acc simd_trig4(A) = sin(A) .* cos(A) .+ sqrt(A)
+@acc simd_exp32_4(A) = exp(A .* 0.5f0)
+
+function test(level)
+    ParallelAccelerator.CGen.setfastmathlevel(level)
+    A = rand(100000) .* 20.0
+    B = rand(Float32, 100000)
+    exp_log, trig, exp32 = level == 4 ? (simd_exp_log4, simd_trig4, simd_exp32_4) :
+                                        (simd_exp_log, simd_trig, simd_exp32)
+    ok = isapprox(exp_log(A), exp(-A) .+ log(A .+ 1.0)) &&
+         isapprox(trig(A), sin(A) .* cos(A) .+ sqrt(A)) &&
+         isapprox(exp32(B), exp(B .* 0.5f0))
+    ParallelAccelerator.CGen.setfastmathlevel(0)
+    return ok
+end
+
+end
+
+using Base.Test
+println("Testing vectorizable math functions...")
+@test TestSimdMath.test(1)
+@test TestSimdMath.test(4)
+println("Done testing vectorizable math functions.")
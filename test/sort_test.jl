@@ -0,0 +1,76 @@
+#=
+Copyright (c) 2015, Intel Corporation
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without 
+modification, are permitted provided that the following conditions are met:
+- Redistributions of source code must retain the above copyright notice, 
+  this list of conditions and the following disclaimer.
+- Redistributions in binary form must reproduce the above copyright notice, 
+  this list of conditions and the following disclaimer in the documentation 
+  and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF 
+THE POSSIBILITY OF SUCH DAMAGE.
+=#
+module TestSort
+using ParallelAccelerator
+
+@acc sort_t(A) = sort(A)
+@acc sortperm_t(A) = sortperm(A)
+
+@acc function sort_inplace_t(A)
+    sort!(A)
+    return A
+end
+
+@acc function sort_map(A)
+    B = sort(A .* 2.0)
+    return B .+ 1.0
+end
+
+function test1()
+    A = rand(200000)
+    return sort_t(A) == sort(A)
+end
+
+function test2()
+    A = rand(-1000:1000, 200000)
+    return sortperm_t(A) == sortperm(A)
+end
+
+function test3()
+    A = Float64[3.0, -0.0, NaN, 0.0, -Inf, 2.0, Inf]
+    B = sort_inplace_t(copy(A))
+    return isequal(B, sort(A))
+end
+
+function test4()
+    A = rand(Int32, 100000)
+    return sort_t(A) == sort(A) && sortperm_t(A) == sortperm(A)
+end
+
+function test5()
+    A = rand(1000)
+    return sort_map(A) == sort(A .* 2.0) .+ 1.0
+end
+
+end
+
+using Base.Test
+println("Testing sort...")
+@test TestSort.test1()
+@test TestSort.test2()
+@test TestSort.test3()
+@test TestSort.test4()
+@test TestSort.test5()
+println("Done testing sort.")
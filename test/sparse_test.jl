@@ -0,0 +1,50 @@
+module TestSparse
+using ParallelAccelerator
+
+@acc function spmv(A, x)
+    y = A * x
+    return y
+end
+
+@acc function sptmv(A, x)
+    y = A' * x
+    return y
+end
+
+@acc function spmm(A, B)
+    C = A * B
+    return C
+end
+
+@acc function sptmm(A, B)
+    C = A' * B
+    return C
+end
+
+# a few much denser columns, so that load balancing by columns alone would be uneven
+function matrix(T, m, n, density)
+    A = sprand(T, m, n, density)
+    A[:, 1:7:n] = sprand(T, m, length(1:7:n), min(1.0, 20 * density))
+    return A
+end
+
+function test(T, m, n, density)
+    A = matrix(T, m, n, density)
+    x = rand(T, n)
+    z = rand(T, m)
+    B = rand(T, n, 5)
+    Z = rand(T, m, 5)
+    return isapprox(spmv(A, x), A * x) &&
+           isapprox(sptmv(A, z), A' * z) &&
+           isapprox(spmm(A, B), A * B) &&
+           isapprox(sptmm(A, Z), A' * Z)
+end
+
+end
+
+using Base.Test
+println("testing sparse matrix products...")
+@test TestSparse.test(Float64, 300, 200, 0.01)
+@test TestSparse.test(Float64, 4000, 3000, 0.01)
+@test TestSparse.test(Float32, 2000, 2000, 0.005)
+println("Done testing sparse matrix products.")
@@ -0,0 +1,66 @@
+module TestStencilBlocking
+using ParallelAccelerator
+
+@acc function smooth_skip(dst, src, iterations)
+    runStencil(dst, src, iterations, :oob_skip) do b, a
+        b[0,0] = (a[-1,0] + a[1,0] + a[0,-1] + a[0,2] + 2.0 * a[0,0]) / 6.0
+        return a, b
+    end
+    return iterations
+end
+
+@acc function smooth_zero(dst, src, iterations)
+    runStencil(dst, src, iterations, :oob_src_zero) do b, a
+        b[0,0] = (a[-1,0] + a[1,0] + a[0,-1] + a[0,2] + 2.0 * a[0,0]) / 6.0
+        return a, b
+    end
+    return iterations
+end
+
+function smooth_skip_ref(dst, src, iterations)
+    runStencil(dst, src, iterations, :oob_skip) do b, a
+        b[0,0] = (a[-1,0] + a[1,0] + a[0,-1] + a[0,2] + 2.0 * a[0,0]) / 6.0
+        return a, b
+    end
+    return iterations
+end
+
+function smooth_zero_ref(dst, src, iterations)
+    runStencil(dst, src, iterations, :oob_src_zero) do b, a
+        b[0,0] = (a[-1,0] + a[1,0] + a[0,-1] + a[0,2] + 2.0 * a[0,0]) / 6.0
+        return a, b
+    end
+    return iterations
+end
+
+function check(f, f_ref, iterations)
+    src = rand(50, 90)
+    dst = rand(50, 90)
+    src_ref = copy(src)
+    dst_ref = copy(dst)
+    f(dst, src, iterations)
+    f_ref(dst_ref, src_ref, iterations)
+    return isapprox(dst, dst_ref) && isapprox(src, src_ref)
+end
+
+function test()
+    ParallelAccelerator.ParallelIR.PIRStencilBlocking(3)
+    try
+        ok = true
+        # one, two and three iterations left after the blocked ones
+        for iterations in [10, 11, 12]
+            ok = ok && check(smooth_skip, smooth_skip_ref, iterations)
+            ok = ok && check(smooth_zero, smooth_zero_ref, iterations)
+        end
+        return ok
+    finally
+        ParallelAccelerator.ParallelIR.PIRStencilBlocking(0)
+    end
+end
+
+end
+
+using Base.Test
+println("testing stencil temporal blocking...")
+@test TestStencilBlocking.test()
+println("Done testing stencil temporal blocking.")
@@ -0,0 +1,63 @@
+module TestStencilBorder
+using ParallelAccelerator
+
+@acc function border_src_zero(dst, src)
+    runStencil(dst, src, :oob_src_zero) do b, a
+        b[0,0] = a[-1,0] + 2.0 * a[2,0] + 3.0 * a[0,-1] + 4.0 * a[0,1] + a[0,0]
+    end
+    return dst
+end
+
+@acc function border_dst_zero(dst, src)
+    runStencil(dst, src, :oob_dst_zero) do b, a
+        b[0,0] = a[-1,0] + 2.0 * a[2,0] + 3.0 * a[0,-1] + 4.0 * a[0,1] + a[0,0]
+    end
+    return dst
+end
+
+@acc function border_wraparound(dst, src)
+    runStencil(dst, src, :oob_wraparound) do b, a
+        b[0,0] = a[-1,0] + 2.0 * a[2,0] + 3.0 * a[0,-1] + 4.0 * a[0,1] + a[0,0]
+    end
+    return dst
+end
+
+function reference(src, style)
+    m, n = size(src)
+    dst = zeros(m, n)
+    for j = 1:n, i = 1:m
+        offsets = [(-1,0,1.0), (2,0,2.0), (0,-1,3.0), (0,1,4.0), (0,0,1.0)]
+        if style == :oob_dst_zero && any(o -> !(1 <= i+o[1] <= m && 1 <= j+o[2] <= n), offsets)
+            continue
+        end
+        for (di, dj, w) in offsets
+            ii, jj = i + di, j + dj
+            if style == :oob_wraparound
+                ii, jj = mod(ii - 1, m) + 1, mod(jj - 1, n) + 1
+            end
+            if 1 <= ii <= m && 1 <= jj <= n
+                dst[i,j] += w * src[ii,jj]
+            end
+        end
+    end
+    return dst
+end
+
+function test()
+    ok = true
+    # including arrays smaller than the stencil, whose upper and lower border bands meet
+    for (m, n) in [(9, 7), (3, 2)]
+        src = rand(m, n)
+        ok = ok && isapprox(border_src_zero(rand(m, n), src), reference(src, :oob_src_zero))
+        ok = ok && isapprox(border_dst_zero(rand(m, n), src), reference(src, :oob_dst_zero))
+        ok = ok && isapprox(border_wraparound(rand(m, n), src), reference(src, :oob_wraparound))
+    end
+    return ok
+end
+
+end
+
+using Base.Test
+println("testing stencil border handling...")
+@test TestStencilBorder.test()
+println("Done testing stencil border handling.")
@@ -0,0 +1,109 @@
+# Also run by hand on several processes:
+#   CGEN_MPI_COMPILE=1 mpirun -np 4 julia stencil_mpi_test.jl
+module TestStencilMPI
+using ParallelAccelerator
+
+if ParallelAccelerator.CGen.isDistributedMode()
+    using MPI
+end
+
+@acc function smooth_oob_skip(dst, src, iterations)
+    runStencil(dst, src, iterations, :oob_skip) do b, a
+        b[0,0] = (a[-1,0] + a[1,0] + a[0,-1] + a[0,2] + 2.0 * a[0,0]) / 6.0
+        return a, b
+    end
+    return iterations
+end
+
+function smooth_oob_skip_ref(dst, src, iterations)
+    runStencil(dst, src, iterations, :oob_skip) do b, a
+        b[0,0] = (a[-1,0] + a[1,0] + a[0,-1] + a[0,2] + 2.0 * a[0,0]) / 6.0
+        return a, b
+    end
+    return iterations
+end
+
+@acc function smooth_oob_dst_zero(dst, src, iterations)
+    runStencil(dst, src, iterations, :oob_dst_zero) do b, a
+        b[0,0] = (a[-1,0] + a[1,0] + a[0,-1] + a[0,2] + 2.0 * a[0,0]) / 6.0
+        return a, b
+    end
+    return iterations
+end
+
+function smooth_oob_dst_zero_ref(dst, src, iterations)
+    runStencil(dst, src, iterations, :oob_dst_zero) do b, a
+        b[0,0] = (a[-1,0] + a[1,0] + a[0,-1] + a[0,2] + 2.0 * a[0,0]) / 6.0
+        return a, b
+    end
+    return iterations
+end
+
+@acc function smooth_oob_src_zero(dst, src, iterations)
+    runStencil(dst, src, iterations, :oob_src_zero) do b, a
+        b[0,0] = (a[-1,0] + a[1,0] + a[0,-1] + a[0,2] + 2.0 * a[0,0]) / 6.0
+        return a, b
+    end
+    return iterations
+end
+
+function smooth_oob_src_zero_ref(dst, src, iterations)
+    runStencil(dst, src, iterations, :oob_src_zero) do b, a
+        b[0,0] = (a[-1,0] + a[1,0] + a[0,-1] + a[0,2] + 2.0 * a[0,0]) / 6.0
+        return a, b
+    end
+    return iterations
+end
+
+@acc function smooth_oob_wraparound(dst, src, iterations)
+    runStencil(dst, src, iterations, :oob_wraparound) do b, a
+        b[0,0] = (a[-1,0] + a[1,0] + a[0,-1] + a[0,2] + 2.0 * a[0,0]) / 6.0
+        return a, b
+    end
+    return iterations
+end
+
+function smooth_oob_wraparound_ref(dst, src, iterations)
+    runStencil(dst, src, iterations, :oob_wraparound) do b, a
+        b[0,0] = (a[-1,0] + a[1,0] + a[0,-1] + a[0,2] + 2.0 * a[0,0]) / 6.0
+        return a, b
+    end
+    return iterations
+end
+
+# Every rank runs f on its block of columns, of different widths, and compares it with the same columns of
+# the whole arrays run by f_ref.
+function check(f, f_ref, iterations)
+    rank, nranks = 0, 1
+    if ParallelAccelerator.CGen.isDistributedMode()
+        rank, nranks = MPI.Comm_rank(MPI.COMM_WORLD), MPI.Comm_size(MPI.COMM_WORLD)
+    end
+    widths = [ 5 + r % 3 for r = 0:nranks-1 ]
+    cols = sum(widths[1:rank]) + (1:widths[rank+1])
+    srand(17)
+    src = rand(30, sum(widths))
+    dst = rand(30, sum(widths))
+    src_block = src[:, cols]
+    dst_block = dst[:, cols]
+    f(dst_block, src_block, iterations)
+    f_ref(dst, src, iterations)
+    return isapprox(dst_block, dst[:, cols]) && isapprox(src_block, src[:, cols])
+end
+
+function test()
+    ok = true
+    for iterations in [1, 4, 5]
+        ok = ok && check(smooth_oob_skip, smooth_oob_skip_ref, iterations)
+        ok = ok && check(smooth_oob_dst_zero, smooth_oob_dst_zero_ref, iterations)
+        ok = ok && check(smooth_oob_src_zero, smooth_oob_src_zero_ref, iterations)
+        ok = ok && check(smooth_oob_wraparound, smooth_oob_wraparound_ref, iterations)
+    end
+    return ok
+end
+
+end
+
+using Base.Test
+println("testing distributed stencils...")
+@test TestStencilMPI.test()
+println("Done testing distributed stencils.")
@@ -15,6 +15,16 @@ end
     return B
 end
 
+# large enough for several cache blocks, with ragged edges
+@acc function test3(A)
+    B = A'
+    return B
+end
+
+@acc function test4(A)
+    transpose!(A, A)
+    return A
+end
 
 end
 
@@ -22,5 +32,11 @@ using Base.Test
 println("testing transpose...")
 @test_approx_eq TestTranspose.test() [1. 4.; 2. 5.; 3. 6.]
 @test TestTranspose.test2()==[1 4; 2 5; 3 6]
+A3 = rand(301, 517)
+@test TestTranspose.test3(A3) == A3.'
+A4 = rand(Float32, 203, 203)
+@test TestTranspose.test4(copy(A4)) == A4.'
+A5 = reshape(collect(1:130*130), 130, 130)
+@test TestTranspose.test4(copy(A5)) == A5.'
 println("Done testing transpose.")
 
@@ -0,0 +1,38 @@
+module TestVecReport
+using ParallelAccelerator
+
+@acc function scale_shift(x, a, b)
+    return a .* x .+ b
+end
+
+function test_parse()
+    gcc = ["/src/model.jl:12:21: optimized: loop vectorized using 32 byte vectors",
+           "/src/model.jl:15:37: missed: couldn't vectorize loop",
+           "/src/model.jl:15:37: missed: not vectorized: control flow in loop.",
+           "/tmp/cgen_output0.cpp:8:1: note: vectorized 1 loops in function."]
+    icc = ["LOOP BEGIN at /src/model.jl(20,3)",
+           "   remark #15344: loop was not vectorized: vector dependence prevents vectorization. First dependence is shown below.",
+           "LOOP END"]
+    return ParallelAccelerator.CGen.parseVecReport(gcc) ==
+               [("/src/model.jl", 12, true, String[]), ("/src/model.jl", 15, false, ["control flow in loop"])] &&
+           ParallelAccelerator.CGen.parseVecReport(icc) ==
+               [("/src/model.jl", 20, false, ["vector dependence prevents vectorization"])]
+end
+
+function test()
+    x = rand(1000)
+    ParallelAccelerator.CGen.setvecreport(true)
+    try
+        return isapprox(scale_shift(x, 2.0, 1.0), 2.0 .* x .+ 1.0)
+    finally
+        ParallelAccelerator.CGen.setvecreport(false)
+    end
+end
+
+end
+
+using Base.Test
+println("testing vectorization reports...")
+@test TestVecReport.test_parse()
+@test TestVecReport.test()
+println("Done testing vectorization reports.")
@@ -16,12 +16,25 @@ function test2()
     return z
 end
 
+# long enough to be split across threads; signs and magnitudes that break naive loops
+function test3()
+    y = [ (isodd(i) ? -1.0 : 1.0) * i for i = 1:100000 ]
+    return norm_t(y)
+end
+
+function test4()
+    y = fill(1e200, 100000)
+    return norm_t2(y)
+end
+
 end
 
 using Base.Test
 println("testing vecnorm...")
 @test_approx_eq TestVecnorm.test() 6.0
 @test_approx_eq TestVecnorm.test2() 3.7416573867739413 
+@test_approx_eq TestVecnorm.test3() 5000050000.0
+@test_approx_eq TestVecnorm.test4() 1e200 * sqrt(100000)
 println("Done testing vecnorm.")
 
 